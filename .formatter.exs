@@ -2,6 +2,7 @@
   inputs: ~w[
     {mix,.formatter}.exs
     {config,lib,test}/**/*.{ex,exs,zig}
+    bench/**/*.exs
     installer/**/*.{ex,exs}
   ],
   plugins: [Zig.Formatter]
@@ -0,0 +1,37 @@
+# Fails when a cycle cost run regressed against a baseline:
+#
+#     mix run bench/compare.exs baseline.json current.json [--tolerance 10]
+#
+# Compares the p50 and p99 exchange duration of every scenario both files
+# have and exits with status 1 if any grew by more than the tolerance, in
+# percent (default: 10).
+
+{opts, paths, _} = OptionParser.parse(System.argv(), strict: [tolerance: :float])
+tolerance = Keyword.get(opts, :tolerance, 10.0)
+
+[baseline, current] =
+  case paths do
+    [_, _] -> Enum.map(paths, &(&1 |> File.read!() |> Jason.decode!()))
+    _ -> Mix.raise("usage: mix run bench/compare.exs baseline.json current.json")
+  end
+
+by_name = fn %{"scenarios" => scenarios} -> Map.new(scenarios, &{&1["name"], &1}) end
+baseline = by_name.(baseline)
+
+results =
+  for {name, %{"duration_ns" => now}} <- by_name.(current),
+      %{"duration_ns" => before} <- [baseline[name]],
+      key <- ["p50", "p99"],
+      before[key] > 0 do
+    change = (now[key] - before[key]) * 100 / before[key]
+    line = "#{String.pad_trailing(name, 24)} #{key} #{before[key]} -> #{now[key]} ns"
+    IO.puts("#{line} (#{:erlang.float_to_binary(change, decimals: 1)}%)")
+    {name, change}
+  end
+
+regressions = for {name, change} <- results, change > tolerance, uniq: true, do: name
+
+if regressions != [] do
+  IO.puts("Regressed by more than #{tolerance}%: #{Enum.join(regressions, ", ")}")
+  System.halt(1)
+end
@@ -0,0 +1,92 @@
+# Cost of one exchange of the cyclic thread versus slave count and process
+# image size. Runs without hardware on the simulated backend:
+#
+#     ETHERCAT_BACKEND=fake mix run bench/cycle_cost.exs [output.json]
+#
+# Each scenario configures `slaves` slaves with `bytes` of process data
+# each, half inputs and half outputs, and runs the thread on the virtual
+# clock, so cycles follow each other without sleeping. The numbers are the
+# thread's own duration histogram (receive to send, see CycleStats), i.e.
+# native time without any BEAM call in it. The JSON lands in
+# bench/results/cycle_cost.json unless a path is given; compare two runs
+# with bench/compare.exs.
+
+alias EthercatEx.{Nif, Telemetry}
+
+slave_counts = [1, 8, 64]
+bytes_per_slave = [4, 32, 256]
+measure_ms = 1_000
+
+output = List.first(System.argv(), "bench/results/cycle_cost.json")
+
+# 16 bit entries, `bytes / 4` of them per direction.
+sync_managers = fn bytes ->
+  entries = fn index -> for subindex <- 1..div(bytes, 4), do: {index, subindex, 16} end
+
+  [
+    %{index: 2, direction: :output, pdos: [%{index: 0x1600, entries: entries.(0x7000)}]},
+    %{index: 3, direction: :input, pdos: [%{index: 0x1A00, entries: entries.(0x6000)}]}
+  ]
+end
+
+run = fn slaves, bytes ->
+  :ok = EthercatEx.init(interface: "sim")
+
+  try do
+    config = %{vendor_id: 0x2, product_code: 0x0BEC_0000, sync_managers: sync_managers.(bytes)}
+    :ok = EthercatEx.configure_slaves(for(id <- 0..(slaves - 1), do: {id, config}))
+    :ok = EthercatEx.activate(cycle_time: 1000, clock: :virtual)
+    {:ok, master} = EthercatEx.fetch_master()
+
+    # Warm up, then start from empty histograms (reading resets them).
+    Process.sleep(100)
+    {:ok, _} = Nif.cycle_stats(master)
+    Process.sleep(measure_ms)
+    {:ok, stats} = Nif.cycle_stats(master)
+
+    duration = stats.duration
+    count = Enum.reduce(duration, 0, fn {_ns, n}, acc -> acc + n end)
+    total = Enum.reduce(duration, 0, fn {ns, n}, acc -> acc + ns * n end)
+
+    %{
+      name: "#{slaves} slaves x #{bytes} B",
+      slaves: slaves,
+      bytes_per_slave: bytes,
+      cycles: stats.cycles,
+      cycles_per_second: div(stats.cycles * 1000, measure_ms),
+      duration_ns: %{
+        mean: if(count > 0, do: div(total, count), else: 0),
+        p50: Telemetry.percentile(duration, 50),
+        p99: Telemetry.percentile(duration, 99),
+        p999: Telemetry.percentile(duration, 99.9),
+        max: Telemetry.percentile(duration, 100)
+      }
+    }
+  after
+    EthercatEx.shutdown()
+  end
+end
+
+scenarios =
+  for slaves <- slave_counts, bytes <- bytes_per_slave do
+    result = run.(slaves, bytes)
+    %{p50: p50, p99: p99} = result.duration_ns
+    IO.puts("#{String.pad_trailing(result.name, 24)} p50 #{p50} ns  p99 #{p99} ns")
+    result
+  end
+
+File.mkdir_p!(Path.dirname(output))
+
+File.write!(
+  output,
+  Jason.encode_to_iodata!(
+    %{
+      version: Mix.Project.config()[:version],
+      otp: System.otp_release(),
+      scenarios: scenarios
+    },
+    pretty: true
+  )
+)
+
+IO.puts("Wrote #{output}")
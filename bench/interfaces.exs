@@ -0,0 +1,97 @@
+# Compares the `ethercat` CLI fork path (EthercatEx.Cli.run_command/3) with
+# the persistent coprocess and the NIF for the operations they can do. Needs the real master and one CoE
+# slave on the bus:
+#
+#     BENCH_INTERFACE=eth0 BENCH_SLAVE=0 mix run bench/interfaces.exs
+#
+# BENCH_SDO is the object read by the SDO scenarios (default: "0x1000:00",
+# the device type every CoE slave has). Set BENCH_SDO_WRITE to
+# "0xindex:subindex=value" to also benchmark 32 bit SDO downloads; it is
+# written over and over, so pick a harmless object. Results are written as
+# JSON to bench/results/interfaces.json.
+
+alias EthercatEx.{Cli, Nif}
+alias EthercatEx.Cli.Coprocess
+
+interface = System.get_env("BENCH_INTERFACE", "eth0")
+slave = "BENCH_SLAVE" |> System.get_env("0") |> String.to_integer()
+position = to_string(slave)
+sdo = System.get_env("BENCH_SDO", "0x1000:00")
+
+parse_address = fn "0x" <> address ->
+  [index, subindex] = String.split(address, ":")
+  {String.to_integer(index, 16), String.to_integer(subindex, 16)}
+end
+
+# What EthercatEx.Cli's lanes pass, minus the verbose output.
+cli = %{
+  binary_path: Application.get_env(:ethercat_ex, :binary_path, "/usr/bin/ethercat"),
+  master: "0",
+  verbose: false,
+  quiet: true,
+  force: false,
+  base_args: ["-m", "0", "-q"]
+}
+
+# run_command/3 only goes through the coprocess while it is running.
+with_coprocess = fn job ->
+  {job,
+   before_scenario: fn input ->
+     {:ok, _} = Coprocess.start_link(master: "0")
+     input
+   end,
+   after_scenario: fn _ -> GenServer.stop(Coprocess) end}
+end
+
+:ok = EthercatEx.init(interface: interface)
+{:ok, master} = EthercatEx.fetch_master()
+{:ok, slaves} = Nif.slaves(master)
+%{vendor_id: vendor_id, product_code: product_code} = Enum.find(slaves, &(&1.id == slave))
+:ok = EthercatEx.configure_slave(slave, %{vendor_id: vendor_id, product_code: product_code})
+:ok = EthercatEx.activate()
+
+{index, subindex} = parse_address.(sdo)
+%{outputs: outputs} = EthercatEx.read_pdo(slave)
+
+jobs = %{
+  "scan (cli)" => fn -> {:ok, _} = Cli.run_command("slaves", [], cli) end,
+  "scan (coprocess)" => with_coprocess.(fn -> {:ok, _} = Cli.run_command("slaves", [], cli) end),
+  "scan (nif)" => fn -> {:ok, _} = Nif.slaves(master) end,
+  "sdo read (cli)" => fn -> {:ok, _} = Cli.run_command("upload", ["-p", position, sdo], cli) end,
+  "sdo read (nif)" => fn -> {:ok, _} = EthercatEx.sdo_request(slave, index, subindex) end,
+  "pdo read (cli)" => fn -> {:ok, _} = Cli.run_command("data", [], cli) end,
+  "pdo read (nif)" => fn -> %{inputs: _} = EthercatEx.read_pdo(slave) end,
+  "pdo write (nif)" => fn -> :ok = EthercatEx.write_pdo(slave, %{outputs: outputs}) end
+}
+
+jobs =
+  case System.get_env("BENCH_SDO_WRITE") do
+    nil ->
+      jobs
+
+    write ->
+      [address, value] = String.split(write, "=")
+      {index, subindex} = parse_address.(address)
+      args = ["-p", position, address, value]
+      value = String.to_integer(value)
+
+      Map.merge(jobs, %{
+        "sdo write (cli)" => fn -> :ok = Cli.run_command("download", args, cli) end,
+        "sdo write (nif)" => fn ->
+          :ok = EthercatEx.sdo_request(slave, index, subindex, {value, 4})
+        end
+      })
+  end
+
+try do
+  Benchee.run(jobs,
+    time: 5,
+    warmup: 1,
+    formatters: [
+      Benchee.Formatters.Console,
+      {Benchee.Formatters.JSON, file: "bench/results/interfaces.json"}
+    ]
+  )
+after
+  EthercatEx.shutdown()
+end
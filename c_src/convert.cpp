@@ -0,0 +1,154 @@
+#include "convert.hpp"
+
+#include <cstring>
+
+namespace ethercat_ex {
+
+namespace {
+
+// EtherCAT data is little-endian, so values are loaded as they lie.
+static_assert(__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__, "little-endian host required");
+
+constexpr size_t kTypeCount = static_cast<size_t>(ScalarType::F64) + 1;
+
+size_t type_size(ScalarType type) {
+  switch (type) {
+    case ScalarType::Bit:
+    case ScalarType::U8:
+    case ScalarType::I8:
+      return 1;
+    case ScalarType::U16:
+    case ScalarType::I16:
+      return 2;
+    case ScalarType::U32:
+    case ScalarType::I32:
+    case ScalarType::F32:
+      return 4;
+    default:
+      return 8;
+  }
+}
+
+template <typename T>
+inline double load(const uint8_t *p) {
+  T value;
+  std::memcpy(&value, p, sizeof(T));
+  return static_cast<double>(value);
+}
+
+template <typename T>
+void convert_run(const uint8_t *src, double *out, size_t count) {
+  for (size_t i = 0; i < count; ++i) out[i] = load<T>(src + i * sizeof(T));
+}
+
+template <typename T>
+void convert_gather(const uint8_t *image, const uint32_t *src, const uint32_t *dst, size_t count,
+                    double *out) {
+  for (size_t i = 0; i < count; ++i) out[dst[i]] = load<T>(image + src[i]);
+}
+
+// Calls `fn` with a value of the C type of `type`; not used for
+// ScalarType::Bit.
+template <typename Fn>
+void dispatch(ScalarType type, Fn &&fn) {
+  switch (type) {
+    case ScalarType::U8:
+      return fn(uint8_t{});
+    case ScalarType::I8:
+      return fn(int8_t{});
+    case ScalarType::U16:
+      return fn(uint16_t{});
+    case ScalarType::I16:
+      return fn(int16_t{});
+    case ScalarType::U32:
+      return fn(uint32_t{});
+    case ScalarType::I32:
+      return fn(int32_t{});
+    case ScalarType::U64:
+      return fn(uint64_t{});
+    case ScalarType::I64:
+      return fn(int64_t{});
+    case ScalarType::F32:
+      return fn(float{});
+    case ScalarType::F64:
+      return fn(double{});
+    case ScalarType::Bit:
+      return;
+  }
+}
+
+}  // namespace
+
+bool ConvertPlan::build(const std::vector<ConvertEntry> &entries) {
+  count_ = entries.size();
+  image_size_ = 0;
+  runs_.clear();
+  gathers_.assign(kTypeCount, Gather{});
+
+  // Entries are first merged into runs in order; runs of one entry are
+  // moved to the gathers at the end.
+  std::vector<Run> runs;
+  for (uint32_t i = 0; i < entries.size(); ++i) {
+    const ConvertEntry &entry = entries[i];
+    if (static_cast<size_t>(entry.type) >= kTypeCount) return false;
+    if (entry.type == ScalarType::Bit && entry.bit_position > 7) return false;
+
+    const size_t size = type_size(entry.type);
+    if (entry.offset + size > image_size_) image_size_ = entry.offset + size;
+
+    if (entry.type == ScalarType::Bit) {
+      Gather &gather = gathers_[static_cast<size_t>(ScalarType::Bit)];
+      gather.src.push_back(entry.offset);
+      gather.dst.push_back(i);
+      gather.bits.push_back(entry.bit_position);
+      continue;
+    }
+
+    if (!runs.empty()) {
+      Run &last = runs.back();
+      if (last.type == entry.type && last.dst + last.count == i &&
+          last.src + last.count * size == entry.offset) {
+        ++last.count;
+        continue;
+      }
+    }
+    runs.push_back(Run{entry.type, entry.offset, i, 1});
+  }
+
+  for (const Run &run : runs) {
+    if (run.count > 1) {
+      runs_.push_back(run);
+    } else {
+      Gather &gather = gathers_[static_cast<size_t>(run.type)];
+      gather.src.push_back(run.src);
+      gather.dst.push_back(run.dst);
+    }
+  }
+  return true;
+}
+
+void ConvertPlan::run(const uint8_t *image, double *out) const {
+  for (const Run &run : runs_) {
+    dispatch(run.type, [&](auto tag) {
+      convert_run<decltype(tag)>(image + run.src, out + run.dst, run.count);
+    });
+  }
+
+  for (size_t type = 0; type < gathers_.size(); ++type) {
+    const Gather &gather = gathers_[type];
+    if (gather.src.empty()) continue;
+
+    if (static_cast<ScalarType>(type) == ScalarType::Bit) {
+      for (size_t i = 0; i < gather.src.size(); ++i) {
+        out[gather.dst[i]] = (image[gather.src[i]] >> gather.bits[i]) & 1;
+      }
+      continue;
+    }
+    dispatch(static_cast<ScalarType>(type), [&](auto tag) {
+      convert_gather<decltype(tag)>(image, gather.src.data(), gather.dst.data(),
+                                    gather.src.size(), out);
+    });
+  }
+}
+
+}  // namespace ethercat_ex
@@ -0,0 +1,64 @@
+// Conversion of process image entries to float64 in one pass.
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace ethercat_ex {
+
+// Entry types, numbered as EthercatEx.Convert passes them.
+enum class ScalarType : uint8_t { Bit, U8, I8, U16, I16, U32, I32, U64, I64, F32, F64 };
+
+struct ConvertEntry {
+  uint32_t offset;
+  // Only used by ScalarType::Bit.
+  uint8_t bit_position;
+  ScalarType type;
+};
+
+// Turns an image into a packed array of doubles, one per entry, in entry
+// order. The plan is prepared once so that the per-image work is a few
+// tight loops with the type fixed in each, rather than a dispatch per
+// entry:
+//
+//   * Runs of entries of the same type lying back to back in the image
+//     (e.g. the channels of an analog terminal) become a contiguous load
+//     and convert, which the compiler vectorizes.
+//   * The remaining entries are grouped by type into gathers over a
+//     precomputed offset table.
+class ConvertPlan {
+ public:
+  // Returns false for an unknown type or bit position.
+  bool build(const std::vector<ConvertEntry> &entries);
+
+  size_t count() const { return count_; }
+  // Smallest image the plan can be run on.
+  size_t image_size() const { return image_size_; }
+
+  // `image` holds at least image_size() bytes, `out` room for count().
+  void run(const uint8_t *image, double *out) const;
+
+ private:
+  struct Run {
+    ScalarType type;
+    uint32_t src;
+    uint32_t dst;
+    uint32_t count;
+  };
+
+  struct Gather {
+    std::vector<uint32_t> src;
+    std::vector<uint32_t> dst;
+    // Bit positions, for ScalarType::Bit only.
+    std::vector<uint8_t> bits;
+  };
+
+  size_t count_ = 0;
+  size_t image_size_ = 0;
+  std::vector<Run> runs_;
+  // Indexed by ScalarType.
+  std::vector<Gather> gathers_;
+};
+
+}  // namespace ethercat_ex
@@ -0,0 +1,61 @@
+// Conversion of process images to float64 arrays; see ConvertPlan.
+#include <new>
+#include <vector>
+
+#include "nif_util.hpp"
+#include "nifs.hpp"
+#include "resources.hpp"
+
+namespace ethercat_ex {
+
+// argv: [{offset, bit_position, type}], with type a ScalarType number.
+// Returns {:ok, plan}.
+ERL_NIF_TERM convert_prepare(ErlNifEnv *env, int, const ERL_NIF_TERM argv[]) {
+  unsigned length;
+  if (!enif_get_list_length(env, argv[0], &length)) return enif_make_badarg(env);
+
+  std::vector<ConvertEntry> entries;
+  entries.reserve(length);
+  ERL_NIF_TERM list = argv[0], head;
+  while (enif_get_list_cell(env, list, &head, &list)) {
+    const ERL_NIF_TERM *tuple;
+    int arity;
+    unsigned offset, bit_position, type;
+    if (!enif_get_tuple(env, head, &arity, &tuple) || arity != 3 ||
+        !enif_get_uint(env, tuple[0], &offset) || !enif_get_uint(env, tuple[1], &bit_position) ||
+        !enif_get_uint(env, tuple[2], &type) || bit_position > 0xFF || type > 0xFF) {
+      return enif_make_badarg(env);
+    }
+    entries.push_back(ConvertEntry{offset, static_cast<uint8_t>(bit_position),
+                                   static_cast<ScalarType>(type)});
+  }
+
+  auto *res = static_cast<PlanResource *>(enif_alloc_resource(plan_type, sizeof(PlanResource)));
+  new (res) PlanResource();
+  const bool built = res->plan.build(entries);
+  ERL_NIF_TERM plan = enif_make_resource(env, res);
+  enif_release_resource(res);
+  return built ? make_ok(env, plan) : enif_make_badarg(env);
+}
+
+// argv: plan, image. Returns a binary of native-endian doubles, one per
+// entry, or {:error, :size_mismatch} for an image too short for the plan.
+ERL_NIF_TERM convert_f64(ErlNifEnv *env, int, const ERL_NIF_TERM argv[]) {
+  PlanResource *res;
+  ErlNifBinary image;
+  if (!enif_get_resource(env, argv[0], plan_type, reinterpret_cast<void **>(&res)) ||
+      !enif_inspect_binary(env, argv[1], &image)) {
+    return enif_make_badarg(env);
+  }
+
+  const ConvertPlan &plan = res->plan;
+  if (image.size < plan.image_size()) return make_error(env, atoms.size_mismatch);
+
+  ERL_NIF_TERM out;
+  auto *values =
+      reinterpret_cast<double *>(enif_make_new_binary(env, plan.count() * sizeof(double), &out));
+  plan.run(image.data, values);
+  return out;
+}
+
+}  // namespace ethercat_ex
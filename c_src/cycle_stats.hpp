@@ -0,0 +1,95 @@
+// Per-cycle timing and working counter statistics of a cyclic task.
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace ethercat_ex {
+
+// Log-linear histogram of nanosecond values in fixed storage, in the style
+// of HdrHistogram: values below 64 get a bucket each, larger ones 32
+// buckets per power of two, i.e. about 3% relative precision. Values of
+// 2^27 ns (134 ms) and more go to an overflow bucket, which is reported
+// with the largest of them as its highest value.
+//
+// One writer records; one reader drains. Buckets are exchanged to zero on
+// read, so every recorded value is reported exactly once and the reader
+// never blocks the writer.
+class Histogram {
+ public:
+  static constexpr unsigned kSubBits = 5;
+  static constexpr unsigned kSub = 1u << kSubBits;
+  static constexpr unsigned kMaxBits = 27;
+  static constexpr size_t kBuckets = 2 * kSub + (kMaxBits - kSubBits - 1) * kSub;
+  // Index of the overflow bucket, past the regular ones.
+  static constexpr size_t kOverflow = kBuckets;
+  static constexpr uint64_t kOverflowFloor = uint64_t{1} << kMaxBits;
+
+  void record(uint64_t value) {
+    const size_t i = index(value);
+    // Stored before the count, so a drain that gets the count gets this
+    // maximum too, unless the previous drain already took it.
+    if (i == kOverflow && value > overflow_max_.load(std::memory_order_relaxed)) {
+      overflow_max_.store(value, std::memory_order_relaxed);
+    }
+    buckets_[i].fetch_add(1, std::memory_order_relaxed);
+  }
+
+  // Reader side. Calls `fn(highest_value, count)` for every non-empty
+  // bucket in ascending order and empties it; at most kBuckets + 1 calls.
+  template <typename Fn>
+  void drain(Fn fn) {
+    for (size_t i = 0; i < kBuckets; ++i) {
+      const uint32_t count = buckets_[i].exchange(0, std::memory_order_relaxed);
+      if (count != 0) fn(highest(i), count);
+    }
+    const uint32_t count = buckets_[kOverflow].exchange(0, std::memory_order_relaxed);
+    const uint64_t max = overflow_max_.exchange(0, std::memory_order_relaxed);
+    // Reported as the floor when the previous drain took the maximum.
+    if (count != 0) fn(max > kOverflowFloor ? max : kOverflowFloor, count);
+  }
+
+  static size_t index(uint64_t value) {
+    if (value < 2 * kSub) return static_cast<size_t>(value);
+    const unsigned msb = 63 - __builtin_clzll(value);
+    if (msb >= kMaxBits) return kOverflow;
+    const unsigned shift = msb - kSubBits;
+    return 2 * kSub + (shift - 1) * kSub + ((value >> shift) - kSub);
+  }
+
+  // Highest value that maps to regular bucket `i`.
+  static uint64_t highest(size_t i) {
+    if (i < 2 * kSub) return i;
+    const unsigned shift = static_cast<unsigned>((i - 2 * kSub) / kSub) + 1;
+    const uint64_t mantissa = kSub + (i - 2 * kSub) % kSub;
+    return ((mantissa + 1) << shift) - 1;
+  }
+
+ private:
+  std::atomic<uint32_t> buckets_[kBuckets + 1] = {};
+  std::atomic<uint64_t> overflow_max_{0};
+};
+
+// Written by the cyclic thread every cycle without allocating or locking,
+// drained by the BEAM at its own rate. Counters are reset on read like the
+// histograms.
+struct CycleStats {
+  // From the deadline to the moment the thread actually woke up.
+  Histogram latency;
+  // From before ecrt_master_receive() to after ecrt_master_send().
+  Histogram duration;
+
+  std::atomic<uint64_t> cycles{0};
+  // Cycles that ended after the next deadline.
+  std::atomic<uint64_t> deadline_misses{0};
+  // Cycles in which a processed domain's working counter was not complete.
+  std::atomic<uint64_t> wc_incomplete{0};
+  // Working counter of domain 0 in the most recent cycle; not reset.
+  std::atomic<uint32_t> working_counter{0};
+  // Deadline of the most recent cycle on the task's clock, stored after
+  // `cycles` counts it; not reset.
+  std::atomic<int64_t> time{0};
+};
+
+}  // namespace ethercat_ex
@@ -0,0 +1,353 @@
+#include "cyclic_task.hpp"
+
+#include <sched.h>
+#include <sys/mman.h>
+#include <time.h>
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+
+#include "rt_check.hpp"
+
+namespace ethercat_ex {
+
+namespace {
+
+constexpr int64_t kNsecPerSec = 1000000000LL;
+// Seconds from the Unix epoch to the EtherCAT epoch, 2000-01-01.
+constexpr int64_t kEtherCatEpoch = 946684800LL;
+
+// Gains of the drift controller and the largest correction it applies per
+// cycle. The time base itself integrates the correction, so kDcKp already
+// removes a constant offset; kDcKi removes the steady error a constant
+// drift would leave.
+constexpr double kDcKp = 0.1;
+constexpr double kDcKi = 0.002;
+constexpr int64_t kDcMaxStepNs = 1000;
+
+// Stack the loop is given up front; far more than a cycle uses.
+constexpr size_t kStackPrefault = 64 * 1024;
+
+int64_t clock_ns(clockid_t clock) {
+  timespec ts;
+  clock_gettime(clock, &ts);
+  return ts.tv_sec * kNsecPerSec + ts.tv_nsec;
+}
+
+timespec to_timespec(int64_t ns) {
+  timespec ts;
+  ts.tv_sec = ns / kNsecPerSec;
+  ts.tv_nsec = ns % kNsecPerSec;
+  return ts;
+}
+
+// Touches the stack pages the loop will run on, so none of them is first
+// faulted in mid-cycle.
+__attribute__((noinline)) void prefault_stack() {
+  volatile uint8_t stack[kStackPrefault];
+  for (size_t i = 0; i < sizeof(stack); i += 4096) stack[i] = 0;
+}
+
+}  // namespace
+
+CyclicTask::CyclicTask(ec_master_t *master, const CyclicOptions &options)
+    : master_(master), options_(options) {}
+
+CyclicTask::~CyclicTask() { stop(); }
+
+int CyclicTask::start(unsigned master_index) {
+  if (options_.lock_memory && mlockall(MCL_CURRENT | MCL_FUTURE) != 0) return -errno;
+
+  pthread_attr_t attr;
+  pthread_attr_init(&attr);
+
+  if (options_.priority > 0) {
+    sched_param param{};
+    param.sched_priority = options_.priority;
+    pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+    pthread_attr_setschedpolicy(&attr, SCHED_FIFO);
+    pthread_attr_setschedparam(&attr, &param);
+  }
+
+  if (options_.cpu >= 0) {
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    CPU_SET(options_.cpu, &cpus);
+    pthread_attr_setaffinity_np(&attr, sizeof(cpus), &cpus);
+  }
+
+  running_.store(true);
+  const int ret = pthread_create(&thread_, &attr, &CyclicTask::run, this);
+  pthread_attr_destroy(&attr);
+  if (ret != 0) {
+    running_.store(false);
+    return -ret;
+  }
+
+  char name[16];
+  std::snprintf(name, sizeof(name), "ecat-master%u", master_index);
+  pthread_setname_np(thread_, name);
+  started_ = true;
+  return 0;
+}
+
+void CyclicTask::begin(const std::vector<Domain> &domains,
+                       const std::vector<std::vector<ImageRange>> &outputs,
+                       const ExchangeServices &services) {
+  domains_ = domains;
+  output_ranges_ = outputs;
+  services_ = services;
+
+  const Domain &last = domains.back();
+  const size_t size = last.image_offset + last.size;
+  size_t ranges = 0;
+  range_base_.clear();
+  for (const std::vector<ImageRange> &domain_ranges : outputs) {
+    range_base_.push_back(ranges);
+    ranges += domain_ranges.size();
+  }
+  image_size_ = size;
+  inputs_.resize(size);
+  // The output image is followed by one write count per range.
+  outputs_.resize(size + ranges * sizeof(uint32_t));
+  output_shadow_.assign(size + ranges * sizeof(uint32_t), 0);
+  seen_writes_.assign(ranges, 0);
+  held_mask_.assign(size, 0);
+  held_value_.assign(size, 0);
+
+  std::lock_guard<std::mutex> guard(start_lock_);
+  begun_ = true;
+  start_cond_.notify_one();
+}
+
+void CyclicTask::stop() {
+  if (!started_) return;
+
+  {
+    std::lock_guard<std::mutex> guard(start_lock_);
+    running_.store(false);
+    start_cond_.notify_one();
+  }
+  pthread_join(thread_, nullptr);
+  started_ = false;
+}
+
+void CyclicTask::read(unsigned domain, const ImageRange &range, uint8_t *dst) const {
+  inputs_.read(domains_[domain].image_offset + range.offset, range.size, dst);
+}
+
+void CyclicTask::write(unsigned domain, const ImageRange &range, const uint8_t *src) {
+  std::lock_guard<std::mutex> guard(writer_lock_);
+  std::memcpy(output_shadow_.data() + domains_[domain].image_offset + range.offset, src,
+              range.size);
+
+  const std::vector<ImageRange> &ranges = output_ranges_[domain];
+  for (size_t j = 0; j < ranges.size(); ++j) {
+    if (ranges[j].offset != range.offset) continue;
+    const size_t flat = range_base_[domain] + j;
+    uint8_t *count = output_shadow_.data() + image_size_ + flat * sizeof(uint32_t);
+    uint32_t writes;
+    std::memcpy(&writes, count, sizeof(writes));
+    ++writes;
+    std::memcpy(count, &writes, sizeof(writes));
+    break;
+  }
+
+  std::memcpy(outputs_.back(), output_shadow_.data(), output_shadow_.size());
+  outputs_.publish();
+}
+
+void *CyclicTask::run(void *arg) {
+  auto *task = static_cast<CyclicTask *>(arg);
+  if (task->wait_for_begin()) task->loop();
+  return nullptr;
+}
+
+bool CyclicTask::wait_for_begin() {
+  std::unique_lock<std::mutex> guard(start_lock_);
+  start_cond_.wait(guard, [this] { return begun_ || !running_.load(); });
+  return running_.load();
+}
+
+int64_t CyclicTask::now() const {
+  return options_.clock == ClockMode::Virtual ? virtual_ns_ : clock_ns(CLOCK_MONOTONIC);
+}
+
+void CyclicTask::sleep_until(int64_t deadline) {
+  if (options_.clock == ClockMode::Virtual) {
+    virtual_ns_ = deadline;
+    return;
+  }
+  const timespec ts = to_timespec(deadline);
+  clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, nullptr);
+}
+
+void CyclicTask::loop() {
+  // Start the DC system time at wall-clock time; from then on it only
+  // advances with the schedule's clock and the controller's corrections.
+  // Virtual time starts at the EtherCAT epoch.
+  if (options_.clock == ClockMode::Monotonic) {
+    time_base_ns_ = clock_ns(CLOCK_REALTIME) - clock_ns(CLOCK_MONOTONIC) -
+                    kEtherCatEpoch * kNsecPerSec;
+  }
+  int64_t wakeup = now();
+  prefault_stack();
+
+  // Everything the loop touches was allocated by begin() and the services'
+  // configuration; see rt_check.hpp.
+  RtScope rt;
+  while (running_.load(std::memory_order_relaxed)) {
+    wakeup += options_.period_ns;
+    sleep_until(wakeup);
+
+    const int64_t woke = now();
+    // The exchange's duration is always measured in real time, so it stays
+    // meaningful on a virtual clock, where it is what a benchmark is after.
+    const int64_t started = clock_ns(CLOCK_MONOTONIC);
+    exchange();
+    const int64_t duration = clock_ns(CLOCK_MONOTONIC) - started;
+    const int64_t latency = woke > wakeup ? woke - wakeup : 0;
+    const int64_t done = woke + duration;
+
+    stats_.latency.record(latency);
+    stats_.duration.record(duration);
+    stats_.cycles.fetch_add(1, std::memory_order_relaxed);
+    stats_.time.store(wakeup, std::memory_order_release);
+    if (latency + duration > options_.period_ns) {
+      stats_.deadline_misses.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // The schedule is fixed in DC time: moving the time base back because
+    // the master ran ahead of the bus delays the next wake-up as much.
+    if (options_.dc == DcMode::FollowReference) wakeup += sync_correction_;
+
+    // After an overrun, resynchronize instead of firing a burst of late
+    // cycles back to back. Virtual time never falls behind.
+    if (options_.clock == ClockMode::Monotonic && wakeup + options_.period_ns < done) {
+      wakeup = done;
+    }
+  }
+}
+
+void CyclicTask::exchange() {
+  ecrt_master_receive(master_);
+
+  bool incomplete = false;
+  for (unsigned i = 0; i < domains_.size(); ++i) {
+    Domain &domain = domains_[i];
+    if (!domain.queued) continue;
+
+    ecrt_domain_process(domain.handle);
+    domain.queued = false;
+    ec_domain_state_t domain_state;
+    if (ecrt_domain_state(domain.handle, &domain_state) == 0) {
+      if (i == 0) {
+        stats_.working_counter.store(domain_state.working_counter, std::memory_order_relaxed);
+      }
+      incomplete |= domain_state.wc_state != EC_WC_COMPLETE;
+      services_.watch->check_domain(i, domain_state, *services_.notifier);
+    }
+  }
+  if (incomplete) stats_.wc_incomplete.fetch_add(1, std::memory_order_relaxed);
+  Notifier &notifier = *services_.notifier;
+  services_.watch->check(master_, notifier);
+  services_.subscriptions->check(domains_, notifier);
+  services_.reflexes->evaluate(domains_, notifier);
+
+  if (options_.dc != DcMode::Off) sync_correction_ = sync_clocks();
+
+  // Domain memory only changes when the domain is processed, so domains
+  // that were not due are republished unchanged.
+  uint8_t *inputs = inputs_.begin_write();
+  for (const Domain &domain : domains_) {
+    std::memcpy(inputs + domain.image_offset, domain.data, domain.size);
+  }
+  inputs_.end_write();
+
+  services_.sdo->service(notifier);
+  services_.foe->service(notifier);
+  services_.registers->service(notifier);
+
+  const uint8_t *outputs = outputs_.front();
+  for (unsigned i = 0; i < domains_.size(); ++i) {
+    Domain &domain = domains_[i];
+    if (!domain.due(cycle_)) continue;
+
+    const uint8_t *image = outputs + domain.image_offset;
+    uint8_t *held_mask = held_mask_.data() + domain.image_offset;
+    uint8_t *held_value = held_value_.data() + domain.image_offset;
+    const std::vector<ImageRange> &ranges = output_ranges_[i];
+    for (size_t j = 0; j < ranges.size(); ++j) {
+      const ImageRange &range = ranges[j];
+      std::memcpy(domain.data + range.offset, image + range.offset, range.size);
+
+      // Bits forced by a reflex hold until the BEAM writes the range again.
+      const size_t flat = range_base_[i] + j;
+      uint32_t writes;
+      std::memcpy(&writes, outputs + image_size_ + flat * sizeof(uint32_t), sizeof(writes));
+      if (writes != seen_writes_[flat]) {
+        seen_writes_[flat] = writes;
+        std::memset(held_mask + range.offset, 0, range.size);
+      }
+      for (unsigned b = range.offset; b < range.offset + range.size; ++b) {
+        domain.data[b] = static_cast<uint8_t>((domain.data[b] & ~held_mask[b]) |
+                                              (held_value[b] & held_mask[b]));
+      }
+    }
+    services_.reflexes->apply(i, domain, held_mask, held_value);
+    ecrt_domain_queue(domain.handle);
+    domain.queued = true;
+  }
+  ecrt_master_send(master_);
+
+  services_.recorder->record(domains_, cycle_);
+  services_.stream->push(domains_, cycle_, notifier);
+  ++cycle_;
+}
+
+int64_t CyclicTask::sync_clocks() {
+  const uint64_t previous = app_time_ns_;
+  app_time_ns_ = now() + time_base_ns_;
+  ecrt_master_application_time(master_, app_time_ns_);
+
+  if (options_.dc == DcMode::SyncReference) {
+    ecrt_master_sync_reference_clock(master_);
+    ecrt_master_sync_slave_clocks(master_);
+    return 0;
+  }
+
+  // The reference clock time just received was latched by the sync
+  // datagram of the previous frame, which carried `previous`.
+  int64_t correction = 0;
+  uint32_t reference;
+  if (previous != 0 && ecrt_master_reference_clock_time(master_, &reference) == 0) {
+    const int32_t error = static_cast<int32_t>(static_cast<uint32_t>(previous) - reference);
+    dc_error_ns_.store(error, std::memory_order_relaxed);
+
+    if (!dc_locked_) {
+      // Jump once to the bus time, then only slew. The schedule only needs
+      // to keep its phase, not the whole jump.
+      time_base_ns_ -= error;
+      correction = error % static_cast<int64_t>(options_.period_ns);
+      dc_locked_ = true;
+    } else {
+      const double integral = dc_integral_ + error;
+      correction = static_cast<int64_t>(kDcKp * error + kDcKi * integral);
+      // Stop integrating while saturated so the controller does not wind up.
+      if (correction > kDcMaxStepNs) {
+        correction = kDcMaxStepNs;
+      } else if (correction < -kDcMaxStepNs) {
+        correction = -kDcMaxStepNs;
+      } else {
+        dc_integral_ = integral;
+      }
+      time_base_ns_ -= correction;
+    }
+  }
+
+  ecrt_master_sync_slave_clocks(master_);
+  return correction;
+}
+
+}  // namespace ethercat_ex
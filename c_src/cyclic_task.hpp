@@ -0,0 +1,189 @@
+// Real-time thread running the EtherCAT exchange of one master.
+#pragma once
+
+#include <ecrt.h>
+#include <pthread.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+#include "cycle_stats.hpp"
+#include "delta_stream.hpp"
+#include "domain.hpp"
+#include "double_buffer.hpp"
+#include "foe_engine.hpp"
+#include "notifier.hpp"
+#include "recorder.hpp"
+#include "reflexes.hpp"
+#include "register_engine.hpp"
+#include "sdo_engine.hpp"
+#include "state_watch.hpp"
+#include "subscriptions.hpp"
+#include "triple_buffer.hpp"
+
+namespace ethercat_ex {
+
+// How the master keeps its clock and the bus's distributed clocks in step.
+enum class DcMode {
+  Off,
+  // The master's time base, and with it the wake-up schedule, follows the
+  // reference clock through a PI controller. Slave clocks are synced to the
+  // reference clock every cycle.
+  FollowReference,
+  // The reference clock is set to the master's time every cycle, and the
+  // slave clocks to the reference clock. Simpler, but the bus inherits the
+  // host clock's jitter.
+  SyncReference,
+};
+
+// What the exchange schedule runs on.
+enum class ClockMode {
+  // Absolute CLOCK_MONOTONIC deadlines.
+  Monotonic,
+  // A counter that jumps to the next deadline instead of sleeping, so
+  // cycles run back to back as fast as the exchange allows. Meant for the
+  // simulated backend (libfakeethercat), where no bus waits for the frame:
+  // DC time starts at the EtherCAT epoch and advances exactly one period
+  // per cycle, which makes runs reproducible.
+  Virtual,
+};
+
+struct CyclicOptions {
+  uint32_t period_ns = 1000000;
+  // SCHED_FIFO priority; 0 runs the thread under the default policy.
+  int priority = 0;
+  // CPU to pin the thread to, or -1 to leave affinity alone.
+  int cpu = -1;
+  DcMode dc = DcMode::Off;
+  ClockMode clock = ClockMode::Monotonic;
+  // mlockall() the whole process before the thread starts, so that no page
+  // the cycle touches is ever faulted in or swapped out mid-cycle.
+  bool lock_memory = false;
+  // Bytes of acyclic datagrams (EoE, mailbox, register requests) the
+  // master may add to one cycle's frames; 0 allows what fits in the
+  // period.
+  uint32_t acyclic_bytes = 0;
+};
+
+// The per-master machinery a cycle drives besides the process data. Owned
+// by the Master, which keeps it alive for as long as the task runs.
+struct ExchangeServices {
+  SdoEngine *sdo;
+  FoeEngine *foe;
+  RegisterEngine *registers;
+  StateWatch *watch;
+  Subscriptions *subscriptions;
+  Reflexes *reflexes;
+  Recorder *recorder;
+  DeltaStream *stream;
+  Notifier *notifier;
+};
+
+// Wakes on absolute CLOCK_MONOTONIC deadlines (or virtual ones, see
+// ClockMode) and runs receive, process,
+// queue and send every period, for each domain on the cycles it is due.
+// The BEAM never touches the domain memory while the task runs: inputs of
+// all domains are published after each process step through a lock-free
+// double buffer, and outputs written from Elixir go through a triple
+// buffer the thread drains before each queue step. Both hold the domain
+// images back to back, at Domain::image_offset. The
+// thread never takes a lock, so a BEAM writer preempted mid-publish can
+// not make it miss a deadline. Acyclic work (SDO requests, state change
+// detection, PDO change subscriptions, FoE transfers, register batches) is
+// done between process and queue, and its results leave through the
+// Notifier. Reflex rules are applied to
+// the outputs last, so they override whatever Elixir wrote, and the bits
+// they forced are held in held_mask_/held_value_ until Elixir writes that
+// slave's outputs again: each range's write count travels with the image.
+//
+// The thread is created by start() before the master is activated, so that
+// scheduling errors surface while activation can still be skipped, and
+// waits until begin() hands it the mapped domains.
+class CyclicTask {
+ public:
+  CyclicTask(ec_master_t *master, const CyclicOptions &options);
+  ~CyclicTask();
+
+  CyclicTask(const CyclicTask &) = delete;
+  CyclicTask &operator=(const CyclicTask &) = delete;
+
+  // Returns 0 or a negative errno (e.g. -EPERM without CAP_SYS_NICE).
+  int start(unsigned master_index);
+  // `outputs[i]` are the slave output ranges of domain `i`.
+  void begin(const std::vector<Domain> &domains,
+             const std::vector<std::vector<ImageRange>> &outputs,
+             const ExchangeServices &services);
+  void stop();
+
+  // BEAM side. Copies a range of the latest published image of `domain`.
+  void read(unsigned domain, const ImageRange &range, uint8_t *dst) const;
+  // BEAM side, any process. Replaces one slave's outputs in the next frame
+  // that carries `domain`.
+  void write(unsigned domain, const ImageRange &range, const uint8_t *src);
+
+  const CyclicOptions &options() const { return options_; }
+  // Master time minus reference clock time in the last cycle, in ns.
+  int32_t dc_error() const { return dc_error_ns_.load(std::memory_order_relaxed); }
+  // BEAM side; see CycleStats for the reset-on-read semantics.
+  CycleStats &stats() { return stats_; }
+
+ private:
+  static void *run(void *arg);
+  bool wait_for_begin();
+  void loop();
+  void exchange();
+  // Hands the application time to the master and queues the clock sync
+  // datagrams. Returns the correction to apply to the wake-up schedule.
+  int64_t sync_clocks();
+  // The schedule's clock, in ns, and waiting for it to reach `deadline`.
+  int64_t now() const;
+  void sleep_until(int64_t deadline);
+
+  ec_master_t *master_;
+  CyclicOptions options_;
+  std::vector<Domain> domains_;
+  std::vector<std::vector<ImageRange>> output_ranges_;
+  uint64_t cycle_ = 0;
+  ExchangeServices services_{};
+
+  // DC system time is CLOCK_MONOTONIC plus time_base_ns_, in ns since the
+  // EtherCAT epoch (2000-01-01). Only the cyclic thread touches these.
+  int64_t time_base_ns_ = 0;
+  int64_t virtual_ns_ = 0;
+  uint64_t app_time_ns_ = 0;
+  bool dc_locked_ = false;
+  double dc_integral_ = 0;
+  int64_t sync_correction_ = 0;
+  std::atomic<int32_t> dc_error_ns_{0};
+
+  CycleStats stats_;
+
+  pthread_t thread_{};
+  bool started_ = false;
+  std::atomic<bool> running_{false};
+  std::mutex start_lock_;
+  std::condition_variable start_cond_;
+  bool begun_ = false;
+
+  DoubleBuffer inputs_;
+  TripleBuffer outputs_;
+  // Writers from any BEAM process serialize among themselves on
+  // writer_lock_ so the triple buffer sees a single producer. output_shadow_
+  // is the full output image each publish is built from.
+  std::mutex writer_lock_;
+  std::vector<uint8_t> output_shadow_;
+  // Output image size; the write counts of the ranges follow it, numbered
+  // from range_base_[domain] on.
+  size_t image_size_ = 0;
+  std::vector<size_t> range_base_;
+
+  // Only the cyclic thread touches these.
+  std::vector<uint32_t> seen_writes_;
+  std::vector<uint8_t> held_mask_;
+  std::vector<uint8_t> held_value_;
+};
+
+}  // namespace ethercat_ex
@@ -0,0 +1,146 @@
+#include "delta_stream.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <thread>
+
+#include "nif_util.hpp"
+#include "notifier.hpp"
+
+namespace ethercat_ex {
+
+namespace {
+
+constexpr uint8_t kFormatVersion = 1;
+// Zero gaps shorter than this are cheaper to send as part of the run.
+constexpr size_t kMinGap = 3;
+
+void put_varint(std::vector<uint8_t> &out, uint64_t value) {
+  while (value >= 0x80) {
+    out.push_back(static_cast<uint8_t>(value | 0x80));
+    value >>= 7;
+  }
+  out.push_back(static_cast<uint8_t>(value));
+}
+
+}  // namespace
+
+DeltaStream::~DeltaStream() { stop(); }
+
+void DeltaStream::start(const ErlNifPid &pid, unsigned batch, const std::vector<Domain> &domains) {
+  stop();
+
+  std::lock_guard<std::mutex> guard(lock_);
+  const Domain &last = domains.back();
+  image_size_ = last.image_offset + last.size;
+  pid_ = pid;
+  batch_ = batch;
+  frames_.assign(kSlots * image_size_, 0);
+  previous_.assign(image_size_, 0);
+  encoded_.clear();
+  encoded_.reserve(image_size_ * 2);
+  head_.store(0);
+  tail_.store(0);
+  streaming_.store(true);
+}
+
+void DeltaStream::stop() {
+  std::lock_guard<std::mutex> guard(lock_);
+  streaming_.store(false);
+  while (pushing_.load()) std::this_thread::yield();
+}
+
+void DeltaStream::push(const std::vector<Domain> &domains, uint64_t cycle, Notifier &notifier) {
+  pushing_.store(true);
+  if (streaming_.load()) {
+    const uint64_t head = head_.load(std::memory_order_relaxed);
+    const uint64_t pending = head - tail_.load(std::memory_order_acquire);
+    if (pending < kSlots) {
+      uint8_t *frame = frames_.data() + (head % kSlots) * image_size_;
+      for (const Domain &domain : domains) {
+        std::memcpy(frame + domain.image_offset, domain.data, domain.size);
+      }
+      cycles_[head % kSlots] = cycle;
+      head_.store(head + 1, std::memory_order_release);
+
+      // Wake the notifier once per batch rather than every cycle.
+      if (pending + 1 == batch_) notifier.wake();
+    }
+  }
+  pushing_.store(false);
+}
+
+void DeltaStream::drain() {
+  std::lock_guard<std::mutex> guard(lock_);
+  if (!streaming_.load()) return;
+
+  uint64_t tail = tail_.load(std::memory_order_relaxed);
+  while (head_.load(std::memory_order_acquire) - tail >= batch_) {
+    encode_batch(tail);
+    tail += batch_;
+    tail_.store(tail, std::memory_order_release);
+
+    ErlNifEnv *env = message_env();
+    ERL_NIF_TERM binary;
+    std::memcpy(enif_make_new_binary(env, encoded_.size(), &binary), encoded_.data(),
+                encoded_.size());
+    if (!send_message(pid_, enif_make_tuple2(env, atoms.ethercat_stream, binary))) {
+      // Nobody left to stream to.
+      streaming_.store(false);
+      return;
+    }
+  }
+}
+
+void DeltaStream::encode_batch(uint64_t tail) {
+  encoded_.clear();
+  encoded_.push_back(kFormatVersion);
+  put_varint(encoded_, image_size_);
+  put_varint(encoded_, batch_);
+  put_varint(encoded_, cycles_[tail % kSlots]);
+
+  std::fill(previous_.begin(), previous_.end(), 0);
+  uint64_t previous_cycle = cycles_[tail % kSlots];
+
+  for (uint64_t seq = tail; seq < tail + batch_; ++seq) {
+    const uint8_t *frame = frames_.data() + (seq % kSlots) * image_size_;
+    put_varint(encoded_, cycles_[seq % kSlots] - previous_cycle);
+    previous_cycle = cycles_[seq % kSlots];
+
+    // Runs are gathered first since their count precedes them.
+    runs_.clear();
+    size_t i = 0;
+    while (i < image_size_) {
+      if (frame[i] == previous_[i]) {
+        ++i;
+        continue;
+      }
+      size_t end = i + 1;
+      size_t gap = 0;
+      for (size_t j = end; j < image_size_ && gap < kMinGap; ++j) {
+        if (frame[j] != previous_[j]) {
+          end = j + 1;
+          gap = 0;
+        } else {
+          ++gap;
+        }
+      }
+      runs_.emplace_back(i, end - i);
+      i = end;
+    }
+
+    put_varint(encoded_, runs_.size());
+    size_t position = 0;
+    for (const auto &run : runs_) {
+      put_varint(encoded_, run.first - position);
+      put_varint(encoded_, run.second);
+      for (size_t b = run.first; b < run.first + run.second; ++b) {
+        encoded_.push_back(frame[b] ^ previous_[b]);
+      }
+      position = run.first + run.second;
+    }
+    std::memcpy(previous_.data(), frame, image_size_);
+  }
+}
+
+}  // namespace ethercat_ex
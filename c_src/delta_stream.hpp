@@ -0,0 +1,80 @@
+// Delta-compressed streaming of the process image to an Elixir process.
+#pragma once
+
+#include <erl_nif.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include "domain.hpp"
+
+namespace ethercat_ex {
+
+class Notifier;
+
+// The thread running the exchange copies every cycle's domain images into
+// a ring of preallocated frames; the notifier thread encodes them in
+// batches of `batch` frames and sends each batch as a single
+// `{:ethercat_stream, binary}` message, so neither encoding nor the
+// message overhead is paid per cycle.
+//
+// Each frame is XOR'd against the previous one and only the non-zero runs
+// of the XOR are kept, so a frame of an unchanged image shrinks to its
+// cycle delta and a zero run count, two bytes while the delta stays below
+// 128. A batch starts from an all-zero image and is decodable on its own:
+//
+//   batch := 1 image_size frames first_cycle frame*
+//   frame := cycle_delta run_count (zeros length xor_byte*length)*
+//
+// with every number a LEB128 varint; `zeros` counts unchanged bytes since
+// the end of the previous run.
+class DeltaStream {
+ public:
+  static constexpr size_t kSlots = 256;
+
+  DeltaStream() = default;
+  ~DeltaStream();
+
+  DeltaStream(const DeltaStream &) = delete;
+  DeltaStream &operator=(const DeltaStream &) = delete;
+
+  // BEAM side. Replaces any stream in progress. `batch` must be between 1
+  // and kSlots.
+  void start(const ErlNifPid &pid, unsigned batch, const std::vector<Domain> &domains);
+  // BEAM side. Discards frames not sent yet.
+  void stop();
+
+  // Thread running the exchange, after send. A frame that finds the ring
+  // full is dropped; the cycle numbers in the batch show the gap.
+  void push(const std::vector<Domain> &domains, uint64_t cycle, Notifier &notifier);
+
+  // Notifier thread. Sends every complete batch.
+  void drain();
+
+ private:
+  void encode_batch(uint64_t tail);
+
+  // Held by start(), stop() and drain(); never by the exchange.
+  std::mutex lock_;
+  ErlNifPid pid_{};
+  unsigned batch_ = 0;
+  size_t image_size_ = 0;
+  std::vector<uint8_t> frames_;
+  uint64_t cycles_[kSlots] = {};
+  std::vector<uint8_t> previous_;
+  std::vector<uint8_t> encoded_;
+  std::vector<std::pair<size_t, size_t>> runs_;
+
+  // streaming_ and pushing_ are published before each other is read (all
+  // sequentially consistent), so stop() never frees the ring under a push.
+  std::atomic<bool> streaming_{false};
+  std::atomic<bool> pushing_{false};
+  std::atomic<uint64_t> head_{0};
+  std::atomic<uint64_t> tail_{0};
+};
+
+}  // namespace ethercat_ex
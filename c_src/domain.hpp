@@ -0,0 +1,117 @@
+// Process data domains and the per-slave layout registered into them.
+#pragma once
+
+#include <ecrt.h>
+#include <netinet/in.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace ethercat_ex {
+
+// Byte range of a slave's inputs or outputs inside a domain image.
+struct ImageRange {
+  unsigned offset = 0;
+  unsigned size = 0;
+};
+
+// One PDO entry registered with ecrt_slave_config_reg_pdo_entry().
+struct PdoEntry {
+  uint16_t index;
+  uint8_t subindex;
+  uint8_t bit_length;
+  ec_direction_t direction;
+  unsigned offset;
+  unsigned bit_position;
+};
+
+// CoE download the master performs every time it brings the slave up,
+// queued with ecrt_slave_config_sdo() or, for complete access,
+// ecrt_slave_config_complete_sdo().
+struct StartupSdo {
+  uint16_t index;
+  uint8_t subindex;
+  bool complete;
+  std::vector<uint8_t> data;
+};
+
+// Arguments of ecrt_slave_config_dc(); times in ns.
+struct DcConfig {
+  bool enabled = false;
+  uint16_t assign_activate = 0;
+  uint32_t sync0_cycle = 0;
+  int32_t sync0_shift = 0;
+  uint32_t sync1_cycle = 0;
+  int32_t sync1_shift = 0;
+  // Use this slave's clock as the reference clock instead of the first
+  // DC-capable slave.
+  bool reference_clock = false;
+};
+
+// EoE Set IP parameters, sent by the master with the
+// ecrt_slave_config_eoe_*() calls each time it configures the slave, so
+// the slave's network comes up without a call to the tool. Fields that are
+// not set are left out of the request.
+struct EoeConfig {
+  enum Address { Ip, Netmask, Gateway, Dns, AddressCount };
+
+  bool enabled = false;
+  // 6 bytes, or empty.
+  std::vector<uint8_t> mac;
+  bool has_address[AddressCount] = {};
+  in_addr address[AddressCount] = {};
+  std::string hostname;
+};
+
+struct SlaveConfig {
+  // Domain the slave's PDO entries are registered in; `inputs` and
+  // `outputs` are relative to that domain's image.
+  unsigned domain = 0;
+  uint16_t alias = 0;
+  uint16_t position = 0;
+  uint32_t vendor_id = 0;
+  uint32_t product_code = 0;
+  ec_slave_config_t *handle = nullptr;
+  // SDO requests created for the slave and their initial data size.
+  unsigned sdo_requests = 2;
+  size_t sdo_size = 256;
+  // Buffer of the slave's FoE request, the largest file it can transfer;
+  // 0 for no FoE.
+  size_t foe_size = 0;
+  // Data size of the slave's register request, the largest range a
+  // register batch can cover; 0 leaves the slave out of them.
+  size_t reg_size = 32;
+  std::vector<StartupSdo> startup_sdos;
+  DcConfig dc;
+  EoeConfig eoe;
+  std::vector<PdoEntry> entries;
+  ImageRange inputs;
+  ImageRange outputs;
+};
+
+// Domains are exchanged on the cycles where `cycle % every == phase`, so a
+// slow domain only takes up frame space on the cycles it is due.
+struct Domain {
+  ec_domain_t *handle = nullptr;
+  unsigned every = 1;
+  unsigned phase = 0;
+  // Valid only while the master is active; the memory is mapped by
+  // libethercat during ecrt_master_activate().
+  uint8_t *data = nullptr;
+  size_t size = 0;
+  // Where the domain starts in the image a CyclicTask publishes, which is
+  // all domains back to back.
+  size_t image_offset = 0;
+  // Queued in the previous cycle, so its datagrams come back with the next
+  // receive. Owned by whoever runs the exchange.
+  bool queued = false;
+
+  bool due(uint64_t cycle) const { return cycle % every == phase; }
+};
+
+// Grows `range` so that it covers the bytes touched by `entry`.
+void extend_range(ImageRange &range, const PdoEntry &entry);
+
+}  // namespace ethercat_ex
@@ -0,0 +1,441 @@
+// Slave configuration and process data exchange on the master's domains.
+//
+// Reads always return copies, so no binary handed to Elixir points into
+// memory that a later exchange rewrites or that outlives the master. While
+// a CyclicTask owns the domain, the BEAM only exchanges data with it
+// through its buffers: reads copy the requested slice out of the latest
+// published image and writes are queued for the next frame. Without one,
+// reads and writes go to the domain memory mapped by ecrt_domain_data()
+// under `Master::lock`, the same lock cycle/1 holds for the exchange.
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <vector>
+
+#include "nif_util.hpp"
+#include "nifs.hpp"
+#include "resources.hpp"
+
+namespace ethercat_ex {
+
+namespace {
+
+// Backing storage for the ec_sync_info_t array handed to
+// ecrt_slave_config_pdos(); the ec_* structs point into these vectors.
+struct SyncSpec {
+  std::vector<std::vector<ec_pdo_entry_info_t>> entries;
+  std::vector<std::vector<ec_pdo_info_t>> pdos;
+  std::vector<ec_sync_info_t> syncs;
+};
+
+bool get_direction(ERL_NIF_TERM term, ec_direction_t *out) {
+  if (enif_is_identical(term, atoms.input)) {
+    *out = EC_DIR_INPUT;
+  } else if (enif_is_identical(term, atoms.output)) {
+    *out = EC_DIR_OUTPUT;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+// entries: [{index, subindex, bit_length}]
+bool decode_entries(ErlNifEnv *env, ERL_NIF_TERM list, std::vector<ec_pdo_entry_info_t> *out) {
+  ERL_NIF_TERM head;
+  while (enif_get_list_cell(env, list, &head, &list)) {
+    int arity;
+    const ERL_NIF_TERM *tuple;
+    ec_pdo_entry_info_t entry;
+    if (!enif_get_tuple(env, head, &arity, &tuple) || arity != 3 ||
+        !get_u16(env, tuple[0], &entry.index) || !get_u8(env, tuple[1], &entry.subindex) ||
+        !get_u8(env, tuple[2], &entry.bit_length)) {
+      return false;
+    }
+    out->push_back(entry);
+  }
+  return true;
+}
+
+// syncs: [{sm_index, :input | :output, [{pdo_index, entries}]}]
+bool decode_syncs(ErlNifEnv *env, ERL_NIF_TERM list, SyncSpec *spec) {
+  unsigned n_syncs;
+  if (!enif_get_list_length(env, list, &n_syncs)) return false;
+  spec->pdos.resize(n_syncs);
+
+  ERL_NIF_TERM head;
+  for (unsigned s = 0; enif_get_list_cell(env, list, &head, &list); ++s) {
+    int arity;
+    const ERL_NIF_TERM *tuple;
+    ec_sync_info_t sync{};
+    if (!enif_get_tuple(env, head, &arity, &tuple) || arity != 3 ||
+        !get_u8(env, tuple[0], &sync.index) || !get_direction(tuple[1], &sync.dir)) {
+      return false;
+    }
+    sync.watchdog_mode = EC_WD_DEFAULT;
+
+    ERL_NIF_TERM pdos = tuple[2], pdo_head;
+    while (enif_get_list_cell(env, pdos, &pdo_head, &pdos)) {
+      const ERL_NIF_TERM *pdo_tuple;
+      ec_pdo_info_t pdo{};
+      if (!enif_get_tuple(env, pdo_head, &arity, &pdo_tuple) || arity != 2 ||
+          !get_u16(env, pdo_tuple[0], &pdo.index)) {
+        return false;
+      }
+      spec->entries.emplace_back();
+      if (!decode_entries(env, pdo_tuple[1], &spec->entries.back())) return false;
+      spec->pdos[s].push_back(pdo);
+    }
+    spec->syncs.push_back(sync);
+  }
+
+  // Link the pointers only now; the vectors no longer reallocate.
+  size_t next_entries = 0;
+  for (size_t s = 0; s < spec->syncs.size(); ++s) {
+    for (ec_pdo_info_t &pdo : spec->pdos[s]) {
+      std::vector<ec_pdo_entry_info_t> &entries = spec->entries[next_entries++];
+      pdo.n_entries = entries.size();
+      pdo.entries = entries.empty() ? nullptr : entries.data();
+    }
+    spec->syncs[s].n_pdos = spec->pdos[s].size();
+    spec->syncs[s].pdos = spec->pdos[s].empty() ? nullptr : spec->pdos[s].data();
+  }
+  return true;
+}
+
+// sdos: [{index, subindex | :complete, data}]
+bool decode_startup_sdos(ErlNifEnv *env, ERL_NIF_TERM list, std::vector<StartupSdo> *out) {
+  ERL_NIF_TERM head;
+  while (enif_get_list_cell(env, list, &head, &list)) {
+    int arity;
+    const ERL_NIF_TERM *tuple;
+    ErlNifBinary data;
+    StartupSdo sdo{};
+    if (!enif_get_tuple(env, head, &arity, &tuple) || arity != 3 ||
+        !get_u16(env, tuple[0], &sdo.index) || !enif_inspect_binary(env, tuple[2], &data) ||
+        data.size == 0) {
+      return false;
+    }
+    if (enif_is_identical(tuple[1], atoms.complete)) {
+      sdo.complete = true;
+    } else if (!get_u8(env, tuple[1], &sdo.subindex)) {
+      return false;
+    }
+    sdo.data.assign(data.data, data.data + data.size);
+    out->push_back(std::move(sdo));
+  }
+  return true;
+}
+
+// dc: nil | {assign_activate, sync0_cycle, sync0_shift, sync1_cycle,
+//            sync1_shift, reference_clock}
+bool decode_dc(ErlNifEnv *env, ERL_NIF_TERM term, DcConfig *out) {
+  if (enif_is_identical(term, atoms.nil)) return true;
+
+  int arity;
+  const ERL_NIF_TERM *tuple;
+  if (!enif_get_tuple(env, term, &arity, &tuple) || arity != 6 ||
+      !get_u16(env, tuple[0], &out->assign_activate) ||
+      !enif_get_uint(env, tuple[1], &out->sync0_cycle) ||
+      !enif_get_int(env, tuple[2], &out->sync0_shift) ||
+      !enif_get_uint(env, tuple[3], &out->sync1_cycle) ||
+      !enif_get_int(env, tuple[4], &out->sync1_shift)) {
+    return false;
+  }
+  out->reference_clock = enif_is_identical(tuple[5], atoms.true_);
+  out->enabled = true;
+  return true;
+}
+
+// eoe: nil | {mac, ip, netmask, gateway, dns, hostname}, each nil or a
+// binary: 6 bytes for mac, 4 bytes in network order for the addresses.
+bool decode_eoe(ErlNifEnv *env, ERL_NIF_TERM term, EoeConfig *out) {
+  if (enif_is_identical(term, atoms.nil)) return true;
+
+  int arity;
+  const ERL_NIF_TERM *tuple;
+  if (!enif_get_tuple(env, term, &arity, &tuple) || arity != 6) return false;
+
+  ErlNifBinary bin;
+  if (!enif_is_identical(tuple[0], atoms.nil)) {
+    if (!enif_inspect_binary(env, tuple[0], &bin) || bin.size != 6) return false;
+    out->mac.assign(bin.data, bin.data + bin.size);
+  }
+  for (int a = 0; a < EoeConfig::AddressCount; ++a) {
+    if (enif_is_identical(tuple[1 + a], atoms.nil)) continue;
+    if (!enif_inspect_binary(env, tuple[1 + a], &bin) || bin.size != 4) return false;
+    std::memcpy(&out->address[a].s_addr, bin.data, 4);
+    out->has_address[a] = true;
+  }
+  if (!enif_is_identical(tuple[5], atoms.nil)) {
+    if (!enif_inspect_binary(env, tuple[5], &bin) || bin.size == 0) return false;
+    out->hostname.assign(reinterpret_cast<const char *>(bin.data), bin.size);
+  }
+  out->enabled = true;
+  return true;
+}
+
+ERL_NIF_TERM make_range(ErlNifEnv *env, const ImageRange &range) {
+  return enif_make_tuple2(env, enif_make_uint(env, range.offset), enif_make_uint(env, range.size));
+}
+
+ERL_NIF_TERM make_layout(ErlNifEnv *env, const SlaveConfig &config) {
+  static const char *const entry_keys[] = {"index",     "subindex", "bit_length",
+                                           "direction", "offset",   "bit_position"};
+  std::vector<ERL_NIF_TERM> entries;
+  entries.reserve(config.entries.size());
+  for (const PdoEntry &entry : config.entries) {
+    const ERL_NIF_TERM values[] = {
+        enif_make_uint(env, entry.index),
+        enif_make_uint(env, entry.subindex),
+        enif_make_uint(env, entry.bit_length),
+        entry.direction == EC_DIR_INPUT ? atoms.input : atoms.output,
+        enif_make_uint(env, entry.offset),
+        enif_make_uint(env, entry.bit_position),
+    };
+    entries.push_back(make_map(env, entry_keys, values, 6));
+  }
+
+  static const char *const keys[] = {"domain", "inputs", "outputs", "entries"};
+  const ERL_NIF_TERM values[] = {
+      enif_make_uint(env, config.domain),
+      make_range(env, config.inputs),
+      make_range(env, config.outputs),
+      enif_make_list_from_array(env, entries.data(), entries.size()),
+  };
+  return make_map(env, keys, values, 4);
+}
+
+bool get_position_args(ErlNifEnv *env, const ERL_NIF_TERM argv[], MasterResource **res,
+                       uint16_t *position) {
+  return get_master_resource(env, argv[0], res) && get_u16(env, argv[1], position);
+}
+
+// Finds the configuration of an active master's slave. Must be called with
+// the master pinned so that a concurrent close cannot clear it.
+const SlaveConfig *find_active_slave(ErlNifEnv *env, const Master &master, uint16_t position,
+                                     ERL_NIF_TERM *error) {
+  if (!master.is_active()) {
+    *error = make_error(env, atoms.not_active);
+    return nullptr;
+  }
+
+  const SlaveConfig *config = master.find_slave(position);
+  if (config == nullptr) *error = make_error(env, atoms.not_configured);
+  return config;
+}
+
+// Held while a NIF touches the image of an active, pinned master. Without
+// a task it takes `Master::lock`, so that cycle/1 never processes or sends
+// a half-written image; a task's buffers need no lock. Whether there is a
+// task is fixed once the master is active.
+class ImageAccess {
+ public:
+  explicit ImageAccess(Master &master) {
+    if (master.task() == nullptr) lock_ = std::unique_lock<std::mutex>(master.lock);
+  }
+
+ private:
+  std::unique_lock<std::mutex> lock_;
+};
+
+// Returns a copy of `range` of the image of `domain`: of the latest image
+// the task published while one runs, otherwise of the domain memory. The
+// caller holds an ImageAccess.
+ERL_NIF_TERM make_image_binary(ErlNifEnv *env, const Master &master, unsigned domain,
+                               const ImageRange &range) {
+  ERL_NIF_TERM term;
+  uint8_t *out = enif_make_new_binary(env, range.size, &term);
+  if (const CyclicTask *task = master.task()) {
+    task->read(domain, range, out);
+  } else {
+    std::memcpy(out, master.domain(domain).data + range.offset, range.size);
+  }
+  return term;
+}
+
+// spec: %{domain:, alias:, position:, vendor_id:, product_code:,
+//         sync_managers:, startup_sdos:, dc:, eoe:, sdo_requests:, sdo_size:,
+//         foe_size:, reg_size:}
+bool decode_slave_spec(ErlNifEnv *env, ERL_NIF_TERM map, SlaveConfig *spec, SyncSpec *syncs) {
+  ERL_NIF_TERM domain, alias, position, vendor_id, product_code, sync_managers, startup_sdos, dc,
+      eoe, sdo_requests, sdo_size, foe_size, reg_size;
+  if (!enif_is_map(env, map) || !get_map_field(env, map, "domain", &domain) ||
+      !get_map_field(env, map, "alias", &alias) ||
+      !get_map_field(env, map, "position", &position) ||
+      !get_map_field(env, map, "vendor_id", &vendor_id) ||
+      !get_map_field(env, map, "product_code", &product_code) ||
+      !get_map_field(env, map, "sync_managers", &sync_managers) ||
+      !get_map_field(env, map, "startup_sdos", &startup_sdos) ||
+      !get_map_field(env, map, "dc", &dc) || !get_map_field(env, map, "eoe", &eoe) ||
+      !get_map_field(env, map, "sdo_requests", &sdo_requests) ||
+      !get_map_field(env, map, "sdo_size", &sdo_size) ||
+      !get_map_field(env, map, "foe_size", &foe_size) ||
+      !get_map_field(env, map, "reg_size", &reg_size)) {
+    return false;
+  }
+
+  unsigned size, reg;
+  ErlNifUInt64 foe;
+  if (!enif_get_uint(env, domain, &spec->domain) || !get_u16(env, alias, &spec->alias) ||
+      !get_u16(env, position, &spec->position) ||
+      !enif_get_uint(env, vendor_id, &spec->vendor_id) ||
+      !enif_get_uint(env, product_code, &spec->product_code) ||
+      !enif_get_uint(env, sdo_requests, &spec->sdo_requests) ||
+      !enif_get_uint(env, sdo_size, &size) || size == 0 ||
+      !enif_get_uint64(env, foe_size, &foe) || !enif_get_uint(env, reg_size, &reg)) {
+    return false;
+  }
+  spec->sdo_size = size;
+  spec->foe_size = foe;
+  spec->reg_size = reg;
+  return decode_startup_sdos(env, startup_sdos, &spec->startup_sdos) &&
+         decode_dc(env, dc, &spec->dc) && decode_eoe(env, eoe, &spec->eoe) &&
+         decode_syncs(env, sync_managers, syncs);
+}
+
+}  // namespace
+
+// argv: master, every, phase
+ERL_NIF_TERM create_domain(ErlNifEnv *env, int, const ERL_NIF_TERM argv[]) {
+  Master *master;
+  unsigned every, phase;
+  if (!get_master(env, argv[0], &master) || !enif_get_uint(env, argv[1], &every) ||
+      !enif_get_uint(env, argv[2], &phase) || every == 0 || phase >= every) {
+    return enif_make_badarg(env);
+  }
+
+  std::lock_guard<std::mutex> guard(master->lock);
+  if (!master->is_open()) return make_error(env, atoms.closed);
+  if (master->is_active()) return make_error(env, atoms.already_active);
+
+  unsigned index;
+  const int ret = master->create_domain(every, phase, &index);
+  if (ret < 0) return make_errno_error(env, ret);
+  return make_ok(env, enif_make_uint(env, index));
+}
+
+ERL_NIF_TERM configure_slave(ErlNifEnv *env, int, const ERL_NIF_TERM argv[]) {
+  Master *master;
+  SlaveConfig spec;
+  SyncSpec syncs;
+  if (!get_master(env, argv[0], &master) || !decode_slave_spec(env, argv[1], &spec, &syncs)) {
+    return enif_make_badarg(env);
+  }
+
+  std::lock_guard<std::mutex> guard(master->lock);
+  if (!master->is_open()) return make_error(env, atoms.closed);
+  if (master->is_active()) return make_error(env, atoms.already_active);
+  if (master->is_misconfigured()) return make_error(env, atoms.configuration_failed);
+  if (spec.domain >= master->domain_count()) return make_error(env, atoms.unknown_domain);
+
+  const SlaveConfig *config;
+  const int ret = master->configure_slave(spec, syncs.syncs, &config);
+  if (ret < 0 && master->is_misconfigured()) {
+    return make_error(env, enif_make_tuple2(env, atoms.configuration_failed, make_errno(env, ret)));
+  }
+  if (ret < 0) return make_errno_error(env, ret);
+  return make_ok(env, make_layout(env, *config));
+}
+
+ERL_NIF_TERM slave_layout(ErlNifEnv *env, int, const ERL_NIF_TERM argv[]) {
+  Master *master;
+  uint16_t position;
+  if (!get_master(env, argv[0], &master) || !get_u16(env, argv[1], &position)) {
+    return enif_make_badarg(env);
+  }
+
+  // Runs on a dirty scheduler, as configure_slave/2 may hold the lock a while.
+  std::lock_guard<std::mutex> guard(master->lock);
+  const SlaveConfig *config = master->find_slave(position);
+  if (config == nullptr) return make_error(env, atoms.not_configured);
+  return make_ok(env, make_layout(env, *config));
+}
+
+ERL_NIF_TERM domain_image(ErlNifEnv *env, int, const ERL_NIF_TERM argv[]) {
+  MasterResource *res;
+  unsigned domain;
+  if (!get_master_resource(env, argv[0], &res) || !enif_get_uint(env, argv[1], &domain)) {
+    return enif_make_badarg(env);
+  }
+
+  Master &master = res->master;
+  if (!master.pin()) return make_error(env, atoms.closed);
+
+  // The domain list is fixed once active.
+  ERL_NIF_TERM result;
+  if (!master.is_active()) {
+    result = make_error(env, atoms.not_active);
+  } else if (domain >= master.domain_count()) {
+    result = make_error(env, atoms.unknown_domain);
+  } else {
+    const ImageAccess access(master);
+    const ImageRange whole{0, static_cast<unsigned>(master.domain(domain).size)};
+    result = make_ok(env, make_image_binary(env, master, domain, whole));
+  }
+  master.unpin();
+  return result;
+}
+
+ERL_NIF_TERM read_pdo(ErlNifEnv *env, int, const ERL_NIF_TERM argv[]) {
+  MasterResource *res;
+  uint16_t position;
+  if (!get_position_args(env, argv, &res, &position)) return enif_make_badarg(env);
+
+  Master &master = res->master;
+  if (!master.pin()) return make_error(env, atoms.closed);
+
+  ERL_NIF_TERM result;
+  if (const SlaveConfig *config = find_active_slave(env, master, position, &result)) {
+    const ImageAccess access(master);
+    ERL_NIF_TERM inputs = make_image_binary(env, master, config->domain, config->inputs);
+    ERL_NIF_TERM outputs = make_image_binary(env, master, config->domain, config->outputs);
+    result = make_ok(env, enif_make_tuple2(env, inputs, outputs));
+  }
+  master.unpin();
+  return result;
+}
+
+ERL_NIF_TERM write_pdo(ErlNifEnv *env, int, const ERL_NIF_TERM argv[]) {
+  MasterResource *res;
+  uint16_t position;
+  ErlNifBinary outputs;
+  if (!get_position_args(env, argv, &res, &position) ||
+      !enif_inspect_iolist_as_binary(env, argv[2], &outputs)) {
+    return enif_make_badarg(env);
+  }
+
+  Master &master = res->master;
+  if (!master.pin()) return make_error(env, atoms.closed);
+
+  ERL_NIF_TERM result;
+  if (const SlaveConfig *config = find_active_slave(env, master, position, &result)) {
+    if (outputs.size != config->outputs.size) {
+      result = make_error(env, atoms.size_mismatch);
+    } else {
+      const ImageAccess access(master);
+      if (CyclicTask *task = master.task()) {
+        task->write(config->domain, config->outputs, outputs.data);
+      } else {
+        std::memcpy(master.domain(config->domain).data + config->outputs.offset, outputs.data,
+                    outputs.size);
+      }
+      result = atoms.ok;
+    }
+  }
+  master.unpin();
+  return result;
+}
+
+ERL_NIF_TERM cycle(ErlNifEnv *env, int, const ERL_NIF_TERM argv[]) {
+  Master *master;
+  if (!get_master(env, argv[0], &master)) return enif_make_badarg(env);
+
+  std::lock_guard<std::mutex> guard(master->lock);
+  if (!master->is_open()) return make_error(env, atoms.closed);
+  if (!master->is_active()) return make_error(env, atoms.not_active);
+
+  const int ret = master->cycle();
+  return ret < 0 ? make_errno_error(env, ret) : atoms.ok;
+}
+
+}  // namespace ethercat_ex
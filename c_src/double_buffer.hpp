@@ -0,0 +1,74 @@
+// Lock-free single-writer double buffer with per-slot sequence counters.
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace ethercat_ex {
+
+// The writer fills the slot that is not published and then publishes it;
+// it never waits. A reader copies the published slot and validates the
+// copy against the slot's sequence counter (odd while being written), so a
+// copy that raced with a rewrite of the same slot is detected and rejected
+// rather than returned torn.
+class DoubleBuffer {
+ public:
+  DoubleBuffer() = default;
+  explicit DoubleBuffer(size_t size) { resize(size); }
+
+  // Not thread-safe; only for use before reader and writer start.
+  void resize(size_t size) {
+    size_ = size;
+    for (Slot &slot : slots_) slot.data.assign(size, 0);
+  }
+
+  size_t size() const { return size_; }
+
+  // Writer side; begin_write() and end_write() must be paired.
+  uint8_t *begin_write() {
+    Slot &slot = slots_[back_];
+    slot.seq.store(slot.seq.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    return slot.data.data();
+  }
+
+  void end_write() {
+    Slot &slot = slots_[back_];
+    slot.seq.store(slot.seq.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    published_.store(back_, std::memory_order_release);
+    back_ ^= 1;
+  }
+
+  // Reader side. Copies `size` bytes at `offset` of the published slot into
+  // `dst`; returns false if the copy may be torn.
+  bool try_read(size_t offset, size_t size, uint8_t *dst) const {
+    const Slot &slot = slots_[published_.load(std::memory_order_acquire)];
+    const uint32_t before = slot.seq.load(std::memory_order_acquire);
+    if (before & 1) return false;
+
+    std::memcpy(dst, slot.data.data() + offset, size);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return slot.seq.load(std::memory_order_relaxed) == before;
+  }
+
+  void read(size_t offset, size_t size, uint8_t *dst) const {
+    while (!try_read(offset, size, dst)) {
+    }
+  }
+
+ private:
+  struct alignas(64) Slot {
+    std::atomic<uint32_t> seq{0};
+    std::vector<uint8_t> data;
+  };
+
+  size_t size_ = 0;
+  Slot slots_[2];
+  std::atomic<unsigned> published_{0};
+  unsigned back_ = 1;
+};
+
+}  // namespace ethercat_ex
@@ -0,0 +1,62 @@
+// NIF library for EthercatEx.Nif. Entry points are grouped by concern in
+// the *_nif.cpp files; each decodes its arguments, takes the master's
+// configuration lock where needed and calls libethercat directly, so no
+// `ethercat` CLI process is involved.
+#include <erl_nif.h>
+
+#include "nif_util.hpp"
+#include "nifs.hpp"
+#include "resources.hpp"
+
+using namespace ethercat_ex;
+
+namespace {
+
+int load(ErlNifEnv *env, void **, ERL_NIF_TERM) {
+  init_atoms(env);
+  return open_resource_types(env);
+}
+
+ErlNifFunc nif_funcs[] = {
+    {"request_master", 1, request_master, ERL_NIF_DIRTY_JOB_IO_BOUND},
+    {"release_master", 1, release_master, ERL_NIF_DIRTY_JOB_IO_BOUND},
+    {"activate", 2, activate, ERL_NIF_DIRTY_JOB_IO_BOUND},
+    {"master_info", 1, master_info, 0},
+    {"master_state", 1, master_state, 0},
+    {"slave_info", 2, slave_info, 0},
+    {"slaves", 1, slaves, 0},
+    {"cycle_stats", 1, cycle_stats, 0},
+    {"rt_check_trap", 0, rt_check_trap, 0},
+    {"attach_monitor", 2, attach_monitor, 0},
+    {"detach_monitor", 2, detach_monitor, 0},
+    {"create_domain", 3, create_domain, ERL_NIF_DIRTY_JOB_IO_BOUND},
+    {"configure_slave", 2, configure_slave, ERL_NIF_DIRTY_JOB_IO_BOUND},
+    {"slave_layout", 2, slave_layout, ERL_NIF_DIRTY_JOB_IO_BOUND},
+    {"domain_image", 2, domain_image, 0},
+    {"read_pdo", 2, read_pdo, 0},
+    {"write_pdo", 3, write_pdo, 0},
+    {"cycle", 1, cycle, 0},
+    {"sdo_read", 6, sdo_read, 0},
+    {"sdo_write", 7, sdo_write, 0},
+    {"foe_load", 4, foe_load, ERL_NIF_DIRTY_JOB_IO_BOUND},
+    {"foe_write", 7, foe_write, ERL_NIF_DIRTY_JOB_IO_BOUND},
+    {"foe_read", 6, foe_read, ERL_NIF_DIRTY_JOB_IO_BOUND},
+    {"foe_unload", 4, foe_unload, ERL_NIF_DIRTY_JOB_IO_BOUND},
+    {"foe_release", 2, foe_release, ERL_NIF_DIRTY_JOB_IO_BOUND},
+    {"register_read", 5, register_read, 0},
+    {"register_write", 5, register_write, 0},
+    {"convert_prepare", 1, convert_prepare, 0},
+    {"convert_f64", 2, convert_f64, 0},
+    {"recorder_start", 3, recorder_start, ERL_NIF_DIRTY_JOB_IO_BOUND},
+    {"recorder_freeze", 2, recorder_freeze, 0},
+    {"recorder_stop", 1, recorder_stop, ERL_NIF_DIRTY_JOB_IO_BOUND},
+    {"set_reflexes", 2, set_reflexes, ERL_NIF_DIRTY_JOB_IO_BOUND},
+    {"subscribe_pdo", 7, subscribe_pdo, ERL_NIF_DIRTY_JOB_IO_BOUND},
+    {"unsubscribe_pdo", 2, unsubscribe_pdo, 0},
+    {"stream_start", 3, stream_start, 0},
+    {"stream_stop", 1, stream_stop, 0},
+};
+
+}  // namespace
+
+ERL_NIF_INIT(Elixir.EthercatEx.Nif, nif_funcs, load, nullptr, nullptr, nullptr)
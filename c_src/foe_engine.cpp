@@ -0,0 +1,238 @@
+#include "foe_engine.hpp"
+
+#include <cerrno>
+#include <cstring>
+
+#include "nif_util.hpp"
+#include "notifier.hpp"
+
+namespace ethercat_ex {
+
+FoeChannel::FoeChannel(ec_foe_request_t *request, size_t capacity)
+    : request(request), capacity(capacity), env(enif_alloc_env()) {}
+
+FoeChannel::~FoeChannel() { enif_free_env(env); }
+
+int FoeEngine::add_slave(uint16_t position, ec_slave_config_t *sc, size_t capacity) {
+  ec_foe_request_t *request = ecrt_slave_config_create_foe_request(sc, capacity);
+  if (request == nullptr) return -ENOMEM;
+  channels_[position].reset(new FoeChannel(request, capacity));
+  return 0;
+}
+
+FoeChannel *FoeEngine::find(uint16_t position) {
+  auto it = channels_.find(position);
+  return it == channels_.end() ? nullptr : it->second.get();
+}
+
+bool FoeEngine::reserve(ErlNifEnv *env, FoeChannel &channel, const ErlNifPid &owner) {
+  uint8_t phase = FoeChannel::Idle;
+  if (!channel.phase.compare_exchange_strong(phase, FoeChannel::Loading,
+                                             std::memory_order_acquire)) {
+    // Only BEAM phases can be taken over; the exchange and the notifier
+    // finish the others on their own.
+    if ((phase != FoeChannel::Loading && phase != FoeChannel::Holding) ||
+        enif_is_process_alive(env, &channel.owner)) {
+      return false;
+    }
+    channel.phase.store(FoeChannel::Loading, std::memory_order_relaxed);
+  }
+  channel.owner = owner;
+  return true;
+}
+
+int FoeEngine::load(ErlNifEnv *env, const ErlNifPid &owner, uint16_t position, size_t offset,
+                    const uint8_t *data, size_t size) {
+  FoeChannel *channel = find(position);
+  if (channel == nullptr) return -ENOENT;
+  // Checked first so that a failed first chunk never reserves the slave.
+  if (offset > channel->capacity || size > channel->capacity - offset) return -EMSGSIZE;
+
+  if (offset == 0) {
+    if (!reserve(env, *channel, owner)) return -EBUSY;
+  } else if (channel->phase.load(std::memory_order_acquire) != FoeChannel::Loading) {
+    return -EINVAL;
+  }
+  std::memcpy(ecrt_foe_request_data(channel->request) + offset, data, size);
+  return 0;
+}
+
+void FoeEngine::queue(FoeChannel &channel, bool write, size_t size, const std::string &file,
+                      uint32_t password, uint32_t timeout_ms, const ErlNifPid &pid,
+                      ERL_NIF_TERM ref) {
+  channel.write = write;
+  channel.size = size;
+  channel.file = file;
+  channel.password = password;
+  channel.timeout_ms = timeout_ms;
+  channel.pid = pid;
+  enif_clear_env(channel.env);
+  channel.ref = enif_make_copy(channel.env, ref);
+  channel.progress.store(0, std::memory_order_relaxed);
+  channel.reported = 0;
+  channel.abandoned.store(false, std::memory_order_relaxed);
+  channel.phase.store(FoeChannel::Queued, std::memory_order_release);
+}
+
+int FoeEngine::start_write(uint16_t position, const std::string &file, uint32_t password,
+                           size_t size, uint32_t timeout_ms, const ErlNifPid &pid,
+                           ERL_NIF_TERM ref) {
+  FoeChannel *channel = find(position);
+  if (channel == nullptr) return -ENOENT;
+  if (channel->phase.load(std::memory_order_acquire) != FoeChannel::Loading) return -EINVAL;
+  if (size > channel->capacity) return -EMSGSIZE;
+
+  queue(*channel, true, size, file, password, timeout_ms, pid, ref);
+  return 0;
+}
+
+int FoeEngine::start_read(ErlNifEnv *env, uint16_t position, const std::string &file,
+                          uint32_t password, uint32_t timeout_ms, const ErlNifPid &pid,
+                          ERL_NIF_TERM ref) {
+  FoeChannel *channel = find(position);
+  if (channel == nullptr) return -ENOENT;
+  if (!reserve(env, *channel, pid)) return -EBUSY;
+
+  queue(*channel, false, 0, file, password, timeout_ms, pid, ref);
+  return 0;
+}
+
+int FoeEngine::unload(uint16_t position, size_t offset, size_t max, const uint8_t **data,
+                      size_t *size) {
+  FoeChannel *channel = find(position);
+  if (channel == nullptr) return -ENOENT;
+  if (channel->phase.load(std::memory_order_acquire) != FoeChannel::Holding) return -EINVAL;
+
+  const size_t total = ecrt_foe_request_data_size(channel->request);
+  const size_t start = offset < total ? offset : total;
+  *data = ecrt_foe_request_data(channel->request) + start;
+  *size = total - start < max ? total - start : max;
+  return 0;
+}
+
+int FoeEngine::release(uint16_t position, const ErlNifPid &caller) {
+  FoeChannel *channel = find(position);
+  if (channel == nullptr) return -ENOENT;
+
+  uint8_t phase = channel->phase.load(std::memory_order_acquire);
+  if (phase != FoeChannel::Idle && enif_compare_pids(&channel->owner, &caller) != 0) {
+    return -EPERM;
+  }
+  if (phase == FoeChannel::Loading || phase == FoeChannel::Holding) {
+    channel->phase.store(FoeChannel::Idle, std::memory_order_release);
+    return 0;
+  }
+  if (phase == FoeChannel::Idle) return -EINVAL;
+
+  // Publishing `abandoned` before reading `phase` again, while report()
+  // does the opposite (all sequentially consistent), means that either
+  // report() sees the flag or this sees the Holding it left.
+  channel->abandoned.store(true);
+  phase = FoeChannel::Holding;
+  channel->phase.compare_exchange_strong(phase, FoeChannel::Idle);
+  return 0;
+}
+
+void FoeEngine::service(Notifier &notifier) {
+  for (auto &entry : channels_) {
+    FoeChannel &channel = *entry.second;
+
+    switch (channel.phase.load(std::memory_order_acquire)) {
+      case FoeChannel::Queued:
+        ecrt_foe_request_file(channel.request, channel.file.c_str(), channel.password);
+        ecrt_foe_request_timeout(channel.request, channel.timeout_ms);
+        if (channel.write) {
+          ecrt_foe_request_write(channel.request, channel.size);
+        } else {
+          ecrt_foe_request_read(channel.request);
+        }
+        channel.phase.store(FoeChannel::Busy, std::memory_order_relaxed);
+        break;
+
+      case FoeChannel::Busy: {
+        const ec_request_state_t state = ecrt_foe_request_state(channel.request);
+        const size_t progress = ecrt_foe_request_progress(channel.request);
+        const size_t previous = channel.progress.exchange(progress, std::memory_order_relaxed);
+        if (state == EC_REQUEST_BUSY || state == EC_REQUEST_UNUSED) {
+          if (progress / kProgressStep != previous / kProgressStep) notifier.wake();
+          break;
+        }
+
+        channel.state = state;
+        channel.error_code = ecrt_foe_request_error_code(channel.request);
+        channel.phase.store(FoeChannel::Finished, std::memory_order_release);
+        notifier.wake();
+        break;
+      }
+
+      default:
+        break;
+    }
+  }
+}
+
+bool FoeEngine::send_done(FoeChannel &channel, ERL_NIF_TERM result) {
+  ErlNifEnv *env = message_env();
+  ERL_NIF_TERM ref = enif_make_copy(env, channel.ref);
+  return send_message(channel.pid,
+                      enif_make_tuple3(env, atoms.foe_done, ref, enif_make_copy(env, result)));
+}
+
+void FoeEngine::report() {
+  for (auto &entry : channels_) {
+    FoeChannel &channel = *entry.second;
+
+    const uint8_t phase = channel.phase.load(std::memory_order_acquire);
+    if (phase == FoeChannel::Busy) {
+      if (channel.abandoned.load(std::memory_order_relaxed)) continue;
+      const size_t progress = channel.progress.load(std::memory_order_relaxed);
+      if (progress < channel.reported + kProgressStep) continue;
+      channel.reported = progress;
+
+      ErlNifEnv *env = message_env();
+      const ERL_NIF_TERM total =
+          channel.write ? enif_make_uint64(env, channel.size) : atoms.nil;
+      send_message(channel.pid,
+                   enif_make_tuple4(env, atoms.foe_progress, enif_make_copy(env, channel.ref),
+                                    enif_make_uint64(env, progress), total));
+    } else if (phase == FoeChannel::Finished) {
+      ErlNifEnv *env = channel.env;
+      ERL_NIF_TERM result;
+      uint8_t next = FoeChannel::Idle;
+      if (channel.state == EC_REQUEST_UNUSED) {
+        // Aborted by abort().
+        result = make_error(env, atoms.closed);
+      } else if (channel.state != EC_REQUEST_SUCCESS) {
+        result = make_error(env, enif_make_tuple2(env, atoms.foe_failed,
+                                                  enif_make_uint(env, channel.error_code)));
+      } else if (channel.write) {
+        result = atoms.ok;
+      } else {
+        result = make_ok(env, enif_make_uint64(env, ecrt_foe_request_data_size(channel.request)));
+        next = FoeChannel::Holding;
+      }
+      // Nobody is left to unload a read that was abandoned or whose caller
+      // died.
+      if (channel.abandoned.load() || !send_done(channel, result)) next = FoeChannel::Idle;
+      channel.phase.store(next);
+
+      uint8_t holding = FoeChannel::Holding;
+      if (next == holding && channel.abandoned.load()) {
+        channel.phase.compare_exchange_strong(holding, FoeChannel::Idle);
+      }
+    }
+  }
+}
+
+void FoeEngine::abort() {
+  for (auto &entry : channels_) {
+    FoeChannel &channel = *entry.second;
+    const uint8_t phase = channel.phase.load(std::memory_order_acquire);
+    if (phase == FoeChannel::Queued || phase == FoeChannel::Busy) {
+      channel.state = EC_REQUEST_UNUSED;
+      channel.phase.store(FoeChannel::Finished, std::memory_order_release);
+    }
+  }
+}
+
+}  // namespace ethercat_ex
@@ -0,0 +1,119 @@
+// File transfers over EtherCAT (FoE) serviced by the thread running the
+// exchange.
+#pragma once
+
+#include <ecrt.h>
+#include <erl_nif.h>
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+
+namespace ethercat_ex {
+
+class Notifier;
+
+// One ec_foe_request_t per slave configured with a `foe_size`, holding one
+// transfer at a time. The request buffer is the only copy of the file: the
+// BEAM fills it chunk by chunk before a write and drains it chunk by chunk
+// after a read, so no process ever holds the whole image.
+//
+// Ownership of the buffer moves with `phase`:
+//
+//   Idle -load-> Loading -start_write-> Queued -> Busy -> Finished -> Idle
+//   Idle -start_read-> Queued -> Busy -> Finished -> Holding -release-> Idle
+//
+// Loading and Holding belong to the BEAM, Queued and Busy to the exchange,
+// and Finished to the notifier, which sends the result and moves on. Each
+// hand-over is a release store of `phase`.
+//
+// Nothing is left stuck by a caller that gives up or dies: release() of a
+// transfer still under way marks it `abandoned`, so the notifier drops its
+// result and returns the channel to Idle; a read result the caller is no
+// longer alive to take goes straight to Idle; and a channel left Loading or
+// Holding by a process that died is taken over by the next caller.
+struct FoeChannel {
+  enum Phase : uint8_t { Idle, Loading, Queued, Busy, Finished, Holding };
+
+  FoeChannel(ec_foe_request_t *request, size_t capacity);
+  ~FoeChannel();
+
+  ec_foe_request_t *const request;
+  const size_t capacity;
+  std::atomic<uint8_t> phase{Idle};
+  std::atomic<bool> abandoned{false};
+  // Process that reserved the channel, for as long as it is not Idle.
+  ErlNifPid owner{};
+
+  // Set by the BEAM before Queued.
+  bool write = false;
+  size_t size = 0;
+  std::string file;
+  uint32_t password = 0;
+  uint32_t timeout_ms = 0;
+  ErlNifPid pid{};
+  ErlNifEnv *env;
+  ERL_NIF_TERM ref = 0;
+
+  // Set by the exchange. `progress` is bytes transferred so far; the result
+  // fields are valid once Finished.
+  std::atomic<size_t> progress{0};
+  size_t reported = 0;
+  ec_request_state_t state = EC_REQUEST_UNUSED;
+  uint32_t error_code = 0;
+};
+
+class FoeEngine {
+ public:
+  // Progress is reported to Elixir about every kProgressStep bytes.
+  static constexpr size_t kProgressStep = 64 * 1024;
+
+  // Configuration phase only.
+  int add_slave(uint16_t position, ec_slave_config_t *sc, size_t capacity);
+
+  // BEAM side, on an active master, serialized by Master::lock; `env` is
+  // the calling NIF's. Return 0 or -ENOENT for a slave without FoE, -EBUSY
+  // while another transfer holds the slave, -EMSGSIZE past the buffer and
+  // -EINVAL when called out of phase.
+  //
+  // Copies `data` to `offset` of the buffer; offset 0 starts a new
+  // download and reserves the slave for `owner` unless it fails.
+  int load(ErlNifEnv *env, const ErlNifPid &owner, uint16_t position, size_t offset,
+           const uint8_t *data, size_t size);
+  // Sends the first `size` loaded bytes as `file`.
+  int start_write(uint16_t position, const std::string &file, uint32_t password, size_t size,
+                  uint32_t timeout_ms, const ErlNifPid &pid, ERL_NIF_TERM ref);
+  // Reserves the slave for `pid`, like load() at offset 0.
+  int start_read(ErlNifEnv *env, uint16_t position, const std::string &file, uint32_t password,
+                 uint32_t timeout_ms, const ErlNifPid &pid, ERL_NIF_TERM ref);
+  // Points `data` at up to `max` bytes of a finished read from `offset` on.
+  int unload(uint16_t position, size_t offset, size_t max, const uint8_t **data, size_t *size);
+  // Ends Loading or Holding, or abandons a transfer that has not been
+  // reported yet. -EPERM unless `caller` reserved the slave.
+  int release(uint16_t position, const ErlNifPid &caller);
+
+  // Thread running the exchange, once per cycle.
+  void service(Notifier &notifier);
+  // Notifier thread, on every wake-up. Sends {:foe_progress, ref, bytes,
+  // total} and {:foe_done, ref, result}.
+  void report();
+  // After the exchange has stopped: fails every transfer that has not
+  // finished.
+  void abort();
+
+ private:
+  FoeChannel *find(uint16_t position);
+  // Moves the channel from Idle, or from Loading or Holding left by a dead
+  // process, to Loading for `owner`.
+  bool reserve(ErlNifEnv *env, FoeChannel &channel, const ErlNifPid &owner);
+  // Fills in a transfer on a Loading channel and hands it to the exchange.
+  void queue(FoeChannel &channel, bool write, size_t size, const std::string &file,
+             uint32_t password, uint32_t timeout_ms, const ErlNifPid &pid, ERL_NIF_TERM ref);
+  bool send_done(FoeChannel &channel, ERL_NIF_TERM result);
+
+  std::map<uint16_t, std::unique_ptr<FoeChannel>> channels_;
+};
+
+}  // namespace ethercat_ex
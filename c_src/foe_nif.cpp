@@ -0,0 +1,156 @@
+// File transfers over EtherCAT on an active master; see FoeEngine.
+//
+// Elixir streams a file into the slave's FoE buffer with foe_load/4 and
+// starts the transfer with foe_write/7, or starts a read with foe_read/6
+// and streams the result out with foe_unload/4 before foe_release/2. The
+// caller receives {:foe_progress, ref, bytes, total} along the way and
+// {:foe_done, ref, result} at the end; foe_release/2 before that abandons
+// the transfer and nothing more is sent.
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+#include "nif_util.hpp"
+#include "nifs.hpp"
+#include "resources.hpp"
+
+namespace ethercat_ex {
+
+namespace {
+
+ERL_NIF_TERM foe_result(ErlNifEnv *env, int ret) {
+  switch (ret) {
+    case 0:
+      return atoms.ok;
+    case -ENOENT:
+      return make_error(env, atoms.not_configured);
+    case -EBUSY:
+      return make_error(env, atoms.busy);
+    case -EMSGSIZE:
+      return make_error(env, atoms.too_large);
+    case -EINVAL:
+      return make_error(env, atoms.no_transfer);
+    case -EPERM:
+      return make_error(env, atoms.not_owner);
+    default:
+      return make_errno_error(env, ret);
+  }
+}
+
+// Runs `fn` on an active master held under its lock, which also serializes
+// taking over a slave from a dead owner. The FoE NIFs run on dirty
+// schedulers, as activate/2 and configure_slave/2 may hold the lock a while.
+template <typename Fn>
+ERL_NIF_TERM with_active(ErlNifEnv *env, Master *master, Fn fn) {
+  std::lock_guard<std::mutex> guard(master->lock);
+  if (!master->is_open()) return make_error(env, atoms.closed);
+  if (!master->is_active()) return make_error(env, atoms.not_active);
+  return fn(master->foe());
+}
+
+bool get_file(ErlNifEnv *env, ERL_NIF_TERM term, std::string *file) {
+  ErlNifBinary bin;
+  if (!enif_inspect_iolist_as_binary(env, term, &bin) ||
+      std::memchr(bin.data, 0, bin.size) != nullptr) {
+    return false;
+  }
+  file->assign(reinterpret_cast<const char *>(bin.data), bin.size);
+  return true;
+}
+
+}  // namespace
+
+// argv: master, position, offset, data
+ERL_NIF_TERM foe_load(ErlNifEnv *env, int, const ERL_NIF_TERM argv[]) {
+  Master *master;
+  uint16_t position;
+  ErlNifUInt64 offset;
+  ErlNifBinary data;
+  if (!get_master(env, argv[0], &master) || !get_u16(env, argv[1], &position) ||
+      !enif_get_uint64(env, argv[2], &offset) ||
+      !enif_inspect_iolist_as_binary(env, argv[3], &data)) {
+    return enif_make_badarg(env);
+  }
+  ErlNifPid pid;
+  enif_self(env, &pid);
+  return with_active(env, master, [&](FoeEngine &foe) {
+    return foe_result(env, foe.load(env, pid, position, offset, data.data, data.size));
+  });
+}
+
+// argv: master, position, file name, password, size, timeout_ms, ref
+ERL_NIF_TERM foe_write(ErlNifEnv *env, int, const ERL_NIF_TERM argv[]) {
+  Master *master;
+  uint16_t position;
+  std::string file;
+  unsigned password, timeout_ms;
+  ErlNifUInt64 size;
+  if (!get_master(env, argv[0], &master) || !get_u16(env, argv[1], &position) ||
+      !get_file(env, argv[2], &file) || !enif_get_uint(env, argv[3], &password) ||
+      !enif_get_uint64(env, argv[4], &size) || !enif_get_uint(env, argv[5], &timeout_ms) ||
+      !enif_is_ref(env, argv[6])) {
+    return enif_make_badarg(env);
+  }
+  ErlNifPid pid;
+  enif_self(env, &pid);
+  return with_active(env, master, [&](FoeEngine &foe) {
+    return foe_result(env,
+                      foe.start_write(position, file, password, size, timeout_ms, pid, argv[6]));
+  });
+}
+
+// argv: master, position, file name, password, timeout_ms, ref
+ERL_NIF_TERM foe_read(ErlNifEnv *env, int, const ERL_NIF_TERM argv[]) {
+  Master *master;
+  uint16_t position;
+  std::string file;
+  unsigned password, timeout_ms;
+  if (!get_master(env, argv[0], &master) || !get_u16(env, argv[1], &position) ||
+      !get_file(env, argv[2], &file) || !enif_get_uint(env, argv[3], &password) ||
+      !enif_get_uint(env, argv[4], &timeout_ms) || !enif_is_ref(env, argv[5])) {
+    return enif_make_badarg(env);
+  }
+  ErlNifPid pid;
+  enif_self(env, &pid);
+  return with_active(env, master, [&](FoeEngine &foe) {
+    return foe_result(env, foe.start_read(env, position, file, password, timeout_ms, pid, argv[5]));
+  });
+}
+
+// argv: master, position, offset, max bytes. Returns {:ok, chunk}, empty
+// past the end of the file.
+ERL_NIF_TERM foe_unload(ErlNifEnv *env, int, const ERL_NIF_TERM argv[]) {
+  Master *master;
+  uint16_t position;
+  ErlNifUInt64 offset, max;
+  if (!get_master(env, argv[0], &master) || !get_u16(env, argv[1], &position) ||
+      !enif_get_uint64(env, argv[2], &offset) || !enif_get_uint64(env, argv[3], &max)) {
+    return enif_make_badarg(env);
+  }
+  return with_active(env, master, [&](FoeEngine &foe) {
+    const uint8_t *data;
+    size_t size;
+    const int ret = foe.unload(position, offset, max, &data, &size);
+    if (ret < 0) return foe_result(env, ret);
+
+    ERL_NIF_TERM chunk;
+    std::memcpy(enif_make_new_binary(env, size, &chunk), data, size);
+    return make_ok(env, chunk);
+  });
+}
+
+ERL_NIF_TERM foe_release(ErlNifEnv *env, int, const ERL_NIF_TERM argv[]) {
+  Master *master;
+  uint16_t position;
+  if (!get_master(env, argv[0], &master) || !get_u16(env, argv[1], &position)) {
+    return enif_make_badarg(env);
+  }
+  ErlNifPid caller;
+  enif_self(env, &caller);
+  return with_active(env, master, [&](FoeEngine &foe) {
+    return foe_result(env, foe.release(position, caller));
+  });
+}
+
+}  // namespace ethercat_ex
@@ -0,0 +1,344 @@
+#include "master.hpp"
+
+#include <cerrno>
+
+namespace ethercat_ex {
+
+void extend_range(ImageRange &range, const PdoEntry &entry) {
+  const unsigned begin = entry.offset;
+  const unsigned end = entry.offset + (entry.bit_position + entry.bit_length + 7) / 8;
+
+  if (range.size == 0) {
+    range.offset = begin;
+    range.size = end - begin;
+    return;
+  }
+
+  const unsigned range_end = range.offset + range.size;
+  if (begin < range.offset) range.offset = begin;
+  range.size = (end > range_end ? end : range_end) - range.offset;
+}
+
+namespace {
+
+int configure_eoe(ec_slave_config_t *sc, const EoeConfig &eoe) {
+#ifdef EC_HAVE_SET_IP
+  using SetAddress = int (*)(ec_slave_config_t *, struct in_addr);
+  static const SetAddress setters[EoeConfig::AddressCount] = {
+      ecrt_slave_config_eoe_ip_address, ecrt_slave_config_eoe_subnet_mask,
+      ecrt_slave_config_eoe_default_gateway, ecrt_slave_config_eoe_dns_address};
+
+  if (!eoe.mac.empty()) {
+    const int ret = ecrt_slave_config_eoe_mac_address(sc, eoe.mac.data());
+    if (ret < 0) return ret;
+  }
+  for (int a = 0; a < EoeConfig::AddressCount; ++a) {
+    if (!eoe.has_address[a]) continue;
+    const int ret = setters[a](sc, eoe.address[a]);
+    if (ret < 0) return ret;
+  }
+  if (!eoe.hostname.empty()) {
+    const int ret = ecrt_slave_config_eoe_hostname(sc, eoe.hostname.c_str());
+    if (ret < 0) return ret;
+  }
+  return 0;
+#else
+  // libethercat before 1.6 has no Set IP for slave configurations.
+  (void)sc;
+  (void)eoe;
+  return -EOPNOTSUPP;
+#endif
+}
+
+// IgH lets as many acyclic bytes into each frame as fit in the send
+// interval at 100 Mbit/s (80 ns per byte), less 10%, so the interval is
+// what bounds EoE, mailbox and register traffic per cycle.
+size_t send_interval_us(const CyclicOptions &options) {
+  if (options.acyclic_bytes == 0) return options.period_ns / 1000;
+  const uint64_t us = (uint64_t{options.acyclic_bytes} * 4 + 44) / 45;
+  return us == 0 ? 1 : us;
+}
+
+}  // namespace
+
+Master::~Master() { release(); }
+
+int Master::request(unsigned index) {
+  errno = 0;
+  ec_master_t *handle = ecrt_request_master(index);
+  if (handle == nullptr) return errno != 0 ? -errno : -ENODEV;
+
+  ec_domain_t *domain = ecrt_master_create_domain(handle);
+  if (domain == nullptr) {
+    ecrt_release_master(handle);
+    return -ENOMEM;
+  }
+
+  index_ = index;
+  handle_ = handle;
+  domains_.assign(1, Domain());
+  domains_[0].handle = domain;
+  watch_.add_domain();
+  return 0;
+}
+
+int Master::create_domain(unsigned every, unsigned phase, unsigned *out) {
+  if (!is_open()) return -EBADF;
+  if (is_active()) return -EBUSY;
+  if (every == 0 || phase >= every) return -EINVAL;
+
+  ec_domain_t *handle = ecrt_master_create_domain(handle_);
+  if (handle == nullptr) return -ENOMEM;
+
+  Domain domain;
+  domain.handle = handle;
+  domain.every = every;
+  domain.phase = phase;
+  domains_.push_back(domain);
+  watch_.add_domain();
+  *out = static_cast<unsigned>(domains_.size() - 1);
+  return 0;
+}
+
+int Master::activate(const CyclicOptions *options) {
+  if (!is_open()) return -EBADF;
+  if (is_active()) return -EALREADY;
+  if (misconfigured_) return -ENOTRECOVERABLE;
+
+  std::unique_ptr<Notifier> notifier(
+      new Notifier(&monitors_, &subscriptions_, &stream_, &foe_, &registers_));
+  notifier->start();
+
+  std::unique_ptr<CyclicTask> task;
+  if (options != nullptr) {
+    ecrt_master_set_send_interval(handle_, send_interval_us(*options));
+    task.reset(new CyclicTask(handle_, *options));
+    const int ret = task->start(index_);
+    if (ret < 0) return ret;
+  }
+
+  // Deactivating would discard the whole configuration, so everything that
+  // can fail is done before this point.
+  const int ret = ecrt_master_activate(handle_);
+  if (ret < 0) return ret;
+
+  size_t image_offset = 0;
+  for (Domain &domain : domains_) {
+    domain.data = ecrt_domain_data(domain.handle);
+    domain.size = ecrt_domain_size(domain.handle);
+    domain.image_offset = image_offset;
+    image_offset += domain.size;
+  }
+
+  if (task) {
+    std::vector<std::vector<ImageRange>> outputs(domains_.size());
+    for (const auto &slave : slaves_) {
+      const SlaveConfig &config = slave.second;
+      if (config.outputs.size != 0) outputs[config.domain].push_back(config.outputs);
+    }
+    const ExchangeServices services{&sdo_,      &foe_,      &registers_, &watch_, &subscriptions_,
+                                    &reflexes_, &recorder_, &stream_,    notifier.get()};
+    task->begin(domains_, outputs, services);
+  }
+  notifier_ = std::move(notifier);
+  task_ = std::move(task);
+
+  active_.store(true, std::memory_order_release);
+  return 0;
+}
+
+// close() and pin() each publish their own flag before reading the other
+// one's (all sequentially consistent), so either the pin sees the close and
+// backs off or the close sees the pin and defers the release.
+void Master::close() {
+  closed_.store(true);
+  if (pins_.load() == 0) release();
+}
+
+bool Master::pin() {
+  pins_.fetch_add(1);
+  if (!closed_.load()) return true;
+
+  unpin();
+  return false;
+}
+
+void Master::unpin() {
+  if (pins_.fetch_sub(1) != 1) return;
+
+  std::lock_guard<std::mutex> guard(lock);
+  if (closed_.load() && pins_.load() == 0) release();
+}
+
+int Master::configure_slave(const SlaveConfig &spec, const std::vector<ec_sync_info_t> &syncs,
+                            const SlaveConfig **out) {
+  if (!is_open()) return -EBADF;
+  if (is_active()) return -EBUSY;
+  if (misconfigured_) return -ENOTRECOVERABLE;
+  if (slaves_.count(spec.position) != 0) return -EEXIST;
+  if (spec.domain >= domains_.size()) return -EINVAL;
+
+  ec_slave_config_t *sc = ecrt_master_slave_config(handle_, spec.alias, spec.position,
+                                                   spec.vendor_id, spec.product_code);
+  if (sc == nullptr) return -EINVAL;
+
+  const int ret = setup_slave(sc, spec, syncs, out);
+  if (ret < 0) misconfigured_ = true;
+  return ret;
+}
+
+int Master::setup_slave(ec_slave_config_t *sc, const SlaveConfig &spec,
+                        const std::vector<ec_sync_info_t> &syncs, const SlaveConfig **out) {
+  ec_domain_t *domain = domains_[spec.domain].handle;
+
+  if (!syncs.empty()) {
+    const int ret = ecrt_slave_config_pdos(sc, syncs.size(), syncs.data());
+    if (ret < 0) return ret;
+  }
+
+  // Only queued here. The master downloads them itself while it configures
+  // the slaves, which it does for all slaves concurrently.
+  for (const StartupSdo &sdo : spec.startup_sdos) {
+    const int ret =
+        sdo.complete
+            ? ecrt_slave_config_complete_sdo(sc, sdo.index, sdo.data.data(), sdo.data.size())
+            : ecrt_slave_config_sdo(sc, sdo.index, sdo.subindex, sdo.data.data(), sdo.data.size());
+    if (ret < 0) return ret;
+  }
+
+  if (spec.dc.enabled) {
+    const DcConfig &dc = spec.dc;
+    ecrt_slave_config_dc(sc, dc.assign_activate, dc.sync0_cycle, dc.sync0_shift, dc.sync1_cycle,
+                         dc.sync1_shift);
+    if (dc.reference_clock) {
+      const int ret = ecrt_master_select_reference_clock(handle_, sc);
+      if (ret < 0) return ret;
+    }
+  }
+
+  if (spec.eoe.enabled) {
+    const int ret = configure_eoe(sc, spec.eoe);
+    if (ret < 0) return ret;
+  }
+
+  SlaveConfig config = spec;
+  config.handle = sc;
+  config.entries.clear();
+
+  for (const ec_sync_info_t &sync : syncs) {
+    for (unsigned p = 0; p < sync.n_pdos; ++p) {
+      const ec_pdo_info_t &pdo = sync.pdos[p];
+      for (unsigned e = 0; e < pdo.n_entries; ++e) {
+        const ec_pdo_entry_info_t &info = pdo.entries[e];
+        // Index 0 marks a gap in the mapping; it has no object to register.
+        if (info.index == 0) continue;
+
+        unsigned bit_position = 0;
+        const int offset = ecrt_slave_config_reg_pdo_entry(sc, info.index, info.subindex,
+                                                           domain, &bit_position);
+        if (offset < 0) return offset;
+
+        const PdoEntry entry{info.index,     info.subindex,      info.bit_length,
+                             sync.dir,       static_cast<unsigned>(offset), bit_position};
+        extend_range(sync.dir == EC_DIR_INPUT ? config.inputs : config.outputs, entry);
+        config.entries.push_back(entry);
+      }
+    }
+  }
+
+  if (config.sdo_requests != 0) {
+    const int ret = sdo_.add_slave(spec.position, sc, config.sdo_requests, config.sdo_size);
+    if (ret < 0) return ret;
+  }
+
+  if (config.foe_size != 0) {
+    const int ret = foe_.add_slave(spec.position, sc, config.foe_size);
+    if (ret < 0) return ret;
+  }
+
+  if (config.reg_size != 0) {
+    const int ret = registers_.add_slave(spec.position, sc, config.reg_size);
+    if (ret < 0) return ret;
+  }
+
+  watch_.add_slave(spec.position, sc);
+
+  auto inserted = slaves_.emplace(spec.position, std::move(config));
+  *out = &inserted.first->second;
+  return 0;
+}
+
+const SlaveConfig *Master::find_slave(uint16_t position) const {
+  auto it = slaves_.find(position);
+  return it == slaves_.end() ? nullptr : &it->second;
+}
+
+int Master::cycle() {
+  if (task_) return -EBUSY;
+
+  ecrt_master_receive(handle_);
+  for (unsigned i = 0; i < domains_.size(); ++i) {
+    Domain &domain = domains_[i];
+    if (!domain.queued) continue;
+
+    ecrt_domain_process(domain.handle);
+    domain.queued = false;
+    ec_domain_state_t domain_state;
+    if (ecrt_domain_state(domain.handle, &domain_state) == 0) {
+      watch_.check_domain(i, domain_state, *notifier_);
+    }
+  }
+  watch_.check(handle_, *notifier_);
+  subscriptions_.check(domains_, *notifier_);
+  reflexes_.evaluate(domains_, *notifier_);
+  sdo_.service(*notifier_);
+  foe_.service(*notifier_);
+  registers_.service(*notifier_);
+
+  for (unsigned i = 0; i < domains_.size(); ++i) {
+    Domain &domain = domains_[i];
+    if (!domain.due(cycles_)) continue;
+    reflexes_.apply(i, domain);
+    ecrt_domain_queue(domain.handle);
+    domain.queued = true;
+  }
+  ecrt_master_send(handle_);
+
+  recorder_.record(domains_, cycles_);
+  stream_.push(domains_, cycles_, *notifier_);
+  ++cycles_;
+  return 0;
+}
+
+int Master::submit_sdo(uint16_t position, SdoJob *job) {
+  if (!is_active()) return -EPERM;
+  return sdo_.submit(position, job);
+}
+
+void Master::release() {
+  if (handle_ == nullptr) return;
+
+  // The cyclic thread must be gone before the domain memory it works on,
+  // and pending SDO callers are answered before their requests vanish.
+  // ecrt_release_master() deactivates an active master and unmaps the
+  // domain image as part of the release.
+  task_.reset();
+  recorder_.stop();
+  stream_.stop();
+  if (notifier_) {
+    sdo_.abort(*notifier_);
+    foe_.abort();
+    registers_.abort();
+    notifier_->stop();
+    notifier_.reset();
+  }
+  ecrt_release_master(handle_);
+  handle_ = nullptr;
+  active_.store(false);
+  domains_.clear();
+  cycles_ = 0;
+  slaves_.clear();
+  misconfigured_ = false;
+}
+
+}  // namespace ethercat_ex
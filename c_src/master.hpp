@@ -0,0 +1,152 @@
+// A requested EtherCAT master and everything configured on it.
+#pragma once
+
+#include <ecrt.h>
+
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "cyclic_task.hpp"
+#include "delta_stream.hpp"
+#include "domain.hpp"
+#include "foe_engine.hpp"
+#include "monitors.hpp"
+#include "notifier.hpp"
+#include "recorder.hpp"
+#include "reflexes.hpp"
+#include "register_engine.hpp"
+#include "sdo_engine.hpp"
+#include "state_watch.hpp"
+#include "subscriptions.hpp"
+
+namespace ethercat_ex {
+
+// Lives inside an `ethercat_master` NIF resource. All configuration calls
+// from the BEAM serialize on `lock`. Slave configuration is frozen once the
+// master is active, so lookups after activation need no lock.
+//
+// Domain 0 is created with the master and exchanged every cycle; more can
+// be added with create_domain() before activation. libethercat unmaps the
+// domain images on release, so Elixir only ever gets copies of them. Calls
+// that use the master without holding `lock` pin it for their duration;
+// `close()` only releases the master once nothing is pinned, otherwise the
+// last unpin does it, right as that call returns.
+class Master {
+ public:
+  Master() = default;
+  ~Master();
+
+  Master(const Master &) = delete;
+  Master &operator=(const Master &) = delete;
+
+  // Returns 0 or a negative errno.
+  int request(unsigned index);
+  // Adds a domain exchanged every `every` cycles, on the cycles where
+  // `cycle % every == phase`. Stores its index in `out`.
+  int create_domain(unsigned every, unsigned phase, unsigned *out);
+  // Starts a CyclicTask when `options` is given; without one the exchange
+  // is driven from the BEAM through cycle().
+  int activate(const CyclicOptions *options);
+  void close();
+
+  // Applies `syncs` (may be empty to keep the slave's default mapping),
+  // queues the spec's startup SDOs and registers every non-gap entry in the
+  // domain given by `spec.domain`, which must exist.
+  //
+  // libethercat has no way to drop a slave configuration, and one that
+  // failed half-way may already have entries in the domain or requests in
+  // the engines. Such a failure marks the master misconfigured: further
+  // configure_slave() and activate() calls return -ENOTRECOVERABLE until it
+  // is closed and requested again.
+  int configure_slave(const SlaveConfig &spec, const std::vector<ec_sync_info_t> &syncs,
+                      const SlaveConfig **out);
+  const SlaveConfig *find_slave(uint16_t position) const;
+
+  // One BEAM-driven exchange: receive and process the domains of the
+  // previous frame, then queue the due domains with the current outputs and
+  // send. Returns -EBUSY while a CyclicTask owns the domains.
+  int cycle();
+
+  // Queues an SDO transfer on an active master; see SdoEngine::submit().
+  // The caller must hold a pin.
+  int submit_sdo(uint16_t position, SdoJob *job);
+
+  // Keeps the master and its domain image alive until unpin(), for the
+  // length of one NIF call. Returns false, without pinning, if the master
+  // is already closed.
+  bool pin();
+  void unpin();
+
+  bool is_open() const { return handle_ != nullptr && !closed_.load(); }
+  bool is_active() const { return active_.load(std::memory_order_acquire); }
+  bool is_misconfigured() const { return misconfigured_; }
+  unsigned index() const { return index_; }
+  ec_master_t *handle() const { return handle_; }
+  const Domain &domain(unsigned index) const { return domains_[index]; }
+  size_t domain_count() const { return domains_.size(); }
+  // Set before the master is published as active and kept until release.
+  CyclicTask *task() const { return task_.get(); }
+  Monitors &monitors() { return monitors_; }
+  Subscriptions &subscriptions() { return subscriptions_; }
+  Reflexes &reflexes() { return reflexes_; }
+  Recorder &recorder() { return recorder_; }
+  DeltaStream &stream() { return stream_; }
+  FoeEngine &foe() { return foe_; }
+  RegisterEngine &registers() { return registers_; }
+  const std::vector<Domain> &domains() const { return domains_; }
+
+  std::mutex lock;
+
+ private:
+  void release();
+  int setup_slave(ec_slave_config_t *sc, const SlaveConfig &spec,
+                  const std::vector<ec_sync_info_t> &syncs, const SlaveConfig **out);
+
+  unsigned index_ = 0;
+  ec_master_t *handle_ = nullptr;
+  std::atomic<bool> active_{false};
+  std::atomic<bool> closed_{false};
+  std::atomic<int> pins_{0};
+  std::vector<Domain> domains_;
+  // Exchanges done through cycle().
+  uint64_t cycles_ = 0;
+  std::map<uint16_t, SlaveConfig> slaves_;
+  bool misconfigured_ = false;
+  SdoEngine sdo_;
+  FoeEngine foe_;
+  RegisterEngine registers_;
+  StateWatch watch_;
+  Monitors monitors_;
+  Subscriptions subscriptions_;
+  Reflexes reflexes_;
+  Recorder recorder_;
+  DeltaStream stream_;
+  // Declared before task_ so that it outlives the thread posting to it.
+  std::unique_ptr<Notifier> notifier_;
+  std::unique_ptr<CyclicTask> task_;
+};
+
+// Pins a master for the length of a NIF call on a normal scheduler, which
+// must not wait for `Master::lock`: activation, configuration and release
+// hold it for as long as they take. False if the master was already closed.
+class MasterPin {
+ public:
+  explicit MasterPin(Master &master) : master_(master), pinned_(master.pin()) {}
+  ~MasterPin() {
+    if (pinned_) master_.unpin();
+  }
+
+  MasterPin(const MasterPin &) = delete;
+  MasterPin &operator=(const MasterPin &) = delete;
+
+  explicit operator bool() const { return pinned_; }
+
+ private:
+  Master &master_;
+  const bool pinned_;
+};
+
+}  // namespace ethercat_ex
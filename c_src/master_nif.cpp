@@ -0,0 +1,273 @@
+// Master lifecycle and bus inspection.
+#include <cstdint>
+#include <new>
+
+#include "nif_util.hpp"
+#include "nifs.hpp"
+#include "resources.hpp"
+#include "rt_check.hpp"
+
+namespace ethercat_ex {
+
+namespace {
+
+ERL_NIF_TERM make_slave_info(ErlNifEnv *env, const ec_slave_info_t &info) {
+  static const char *const keys[] = {"id",     "vendor_id", "product_code", "revision",
+                                     "serial", "alias",     "name",         "state",
+                                     "error_flag"};
+  const ERL_NIF_TERM values[] = {
+      enif_make_uint(env, info.position),
+      enif_make_uint(env, info.vendor_id),
+      enif_make_uint(env, info.product_code),
+      enif_make_uint(env, info.revision_number),
+      enif_make_uint(env, info.serial_number),
+      enif_make_uint(env, info.alias),
+      make_binary_string(env, info.name),
+      make_al_state(info.al_state),
+      make_bool(info.error_flag != 0),
+  };
+  return make_map(env, keys, values, sizeof(values) / sizeof(values[0]));
+}
+
+// [{highest_value_ns, count}] for the non-empty buckets, ascending.
+ERL_NIF_TERM drain_histogram(ErlNifEnv *env, Histogram &histogram) {
+  ERL_NIF_TERM cells[Histogram::kBuckets + 1];
+  unsigned n = 0;
+  histogram.drain([&](uint64_t value, uint32_t count) {
+    cells[n++] = enif_make_tuple2(env, enif_make_uint64(env, value), enif_make_uint(env, count));
+  });
+  return enif_make_list_from_array(env, cells, n);
+}
+
+}  // namespace
+
+ERL_NIF_TERM request_master(ErlNifEnv *env, int, const ERL_NIF_TERM argv[]) {
+  unsigned index;
+  if (!enif_get_uint(env, argv[0], &index)) return enif_make_badarg(env);
+
+  auto *res = static_cast<MasterResource *>(
+      enif_alloc_resource(master_type, sizeof(MasterResource)));
+  new (res) MasterResource();
+
+  const int ret = res->master.request(index);
+  ERL_NIF_TERM result = ret < 0 ? make_errno_error(env, ret)
+                                : make_ok(env, enif_make_resource(env, res));
+  enif_release_resource(res);
+  return result;
+}
+
+ERL_NIF_TERM release_master(ErlNifEnv *env, int, const ERL_NIF_TERM argv[]) {
+  Master *master;
+  if (!get_master(env, argv[0], &master)) return enif_make_badarg(env);
+
+  std::lock_guard<std::mutex> guard(master->lock);
+  master->close();
+  return atoms.ok;
+}
+
+// argv[1] is nil for BEAM-driven cycling or
+// {period_ns, priority, cpu, dc, clock, lock_memory, acyclic_bytes} with
+// cpu -1 for no affinity, dc false, :follow_reference or :sync_reference,
+// clock :monotonic or :virtual, lock_memory a boolean and acyclic_bytes 0
+// for no budget.
+ERL_NIF_TERM activate(ErlNifEnv *env, int, const ERL_NIF_TERM argv[]) {
+  Master *master;
+  if (!get_master(env, argv[0], &master)) return enif_make_badarg(env);
+
+  CyclicOptions options;
+  const CyclicOptions *cyclic = nullptr;
+  if (!enif_is_identical(argv[1], atoms.nil)) {
+    int arity;
+    const ERL_NIF_TERM *tuple;
+    if (!enif_get_tuple(env, argv[1], &arity, &tuple) || arity != 7 ||
+        !enif_get_uint(env, tuple[0], &options.period_ns) || options.period_ns == 0 ||
+        !enif_get_int(env, tuple[1], &options.priority) ||
+        !enif_get_int(env, tuple[2], &options.cpu) ||
+        !enif_get_uint(env, tuple[6], &options.acyclic_bytes)) {
+      return enif_make_badarg(env);
+    }
+    if (enif_is_identical(tuple[3], atoms.follow_reference)) {
+      options.dc = DcMode::FollowReference;
+    } else if (enif_is_identical(tuple[3], atoms.sync_reference)) {
+      options.dc = DcMode::SyncReference;
+    } else if (!enif_is_identical(tuple[3], atoms.false_)) {
+      return enif_make_badarg(env);
+    }
+    if (enif_is_identical(tuple[4], atoms.virtual_)) {
+      options.clock = ClockMode::Virtual;
+    } else if (!enif_is_identical(tuple[4], atoms.monotonic)) {
+      return enif_make_badarg(env);
+    }
+    if (enif_is_identical(tuple[5], atoms.true_)) {
+      options.lock_memory = true;
+    } else if (!enif_is_identical(tuple[5], atoms.false_)) {
+      return enif_make_badarg(env);
+    }
+    cyclic = &options;
+  }
+
+  std::lock_guard<std::mutex> guard(master->lock);
+  if (!master->is_open()) return make_error(env, atoms.closed);
+  if (master->is_active()) return make_error(env, atoms.already_active);
+  if (master->is_misconfigured()) return make_error(env, atoms.configuration_failed);
+
+  const int ret = master->activate(cyclic);
+  return ret < 0 ? make_errno_error(env, ret) : atoms.ok;
+}
+
+// The bus inspection NIFs make single ioctls, safe next to the cyclic
+// thread, and pin the master rather than take its lock.
+ERL_NIF_TERM master_info(ErlNifEnv *env, int, const ERL_NIF_TERM argv[]) {
+  Master *master;
+  if (!get_master(env, argv[0], &master)) return enif_make_badarg(env);
+
+  const MasterPin pin(*master);
+  if (!pin) return make_error(env, atoms.closed);
+
+  ec_master_info_t info;
+  const int ret = ecrt_master(master->handle(), &info);
+  if (ret < 0) return make_errno_error(env, ret);
+
+  static const char *const keys[] = {"index", "slave_count", "link_up", "scan_busy",
+                                     "app_time"};
+  const ERL_NIF_TERM values[] = {
+      enif_make_uint(env, master->index()),
+      enif_make_uint(env, info.slave_count),
+      make_bool(info.link_up),
+      make_bool(info.scan_busy),
+      enif_make_uint64(env, info.app_time),
+  };
+  return make_ok(env, make_map(env, keys, values, sizeof(values) / sizeof(values[0])));
+}
+
+ERL_NIF_TERM master_state(ErlNifEnv *env, int, const ERL_NIF_TERM argv[]) {
+  Master *master;
+  if (!get_master(env, argv[0], &master)) return enif_make_badarg(env);
+
+  const MasterPin pin(*master);
+  if (!pin) return make_error(env, atoms.closed);
+
+  ec_master_state_t state;
+  const int ret = ecrt_master_state(master->handle(), &state);
+  if (ret < 0) return make_errno_error(env, ret);
+
+  static const char *const keys[] = {"slaves_responding", "al_states", "link_up"};
+  const ERL_NIF_TERM values[] = {
+      enif_make_uint(env, state.slaves_responding),
+      make_al_state_list(env, state.al_states),
+      make_bool(state.link_up),
+  };
+  return make_ok(env, make_map(env, keys, values, 3));
+}
+
+ERL_NIF_TERM slave_info(ErlNifEnv *env, int, const ERL_NIF_TERM argv[]) {
+  Master *master;
+  unsigned position;
+  if (!get_master(env, argv[0], &master) || !enif_get_uint(env, argv[1], &position) ||
+      position > UINT16_MAX) {
+    return enif_make_badarg(env);
+  }
+
+  const MasterPin pin(*master);
+  if (!pin) return make_error(env, atoms.closed);
+
+  ec_slave_info_t info;
+  const int ret = ecrt_master_get_slave(master->handle(), position, &info);
+  if (ret < 0) return make_errno_error(env, ret);
+  return make_ok(env, make_slave_info(env, info));
+}
+
+ERL_NIF_TERM slaves(ErlNifEnv *env, int, const ERL_NIF_TERM argv[]) {
+  Master *master;
+  if (!get_master(env, argv[0], &master)) return enif_make_badarg(env);
+
+  const MasterPin pin(*master);
+  if (!pin) return make_error(env, atoms.closed);
+
+  ec_master_info_t info;
+  int ret = ecrt_master(master->handle(), &info);
+  if (ret < 0) return make_errno_error(env, ret);
+
+  ERL_NIF_TERM list = enif_make_list(env, 0);
+  for (unsigned position = info.slave_count; position-- > 0;) {
+    ec_slave_info_t slave;
+    ret = ecrt_master_get_slave(master->handle(), position, &slave);
+    if (ret < 0) return make_errno_error(env, ret);
+    list = enif_make_list_cell(env, make_slave_info(env, slave), list);
+  }
+  return make_ok(env, list);
+}
+
+// Drains the statistics the cyclic thread gathered since the previous call.
+ERL_NIF_TERM cycle_stats(ErlNifEnv *env, int, const ERL_NIF_TERM argv[]) {
+  MasterResource *res;
+  if (!get_master_resource(env, argv[0], &res)) return enif_make_badarg(env);
+
+  Master &master = res->master;
+  if (!master.pin()) return make_error(env, atoms.closed);
+
+  ERL_NIF_TERM result;
+  CyclicTask *task = master.task();
+  if (!master.is_active()) {
+    result = make_error(env, atoms.not_active);
+  } else if (task == nullptr) {
+    result = make_error(env, atoms.not_cyclic);
+  } else {
+    CycleStats &stats = task->stats();
+    // Read before `cycles`, so the cycle it is the deadline of is counted
+    // by this call at the latest.
+    const int64_t time = stats.time.load(std::memory_order_acquire);
+    static const char *const keys[] = {"cycles",          "deadline_misses", "wc_incomplete",
+                                       "working_counter", "dc_error",        "time",
+                                       "latency",         "duration"};
+    const ERL_NIF_TERM values[] = {
+        enif_make_uint64(env, stats.cycles.exchange(0, std::memory_order_relaxed)),
+        enif_make_uint64(env, stats.deadline_misses.exchange(0, std::memory_order_relaxed)),
+        enif_make_uint64(env, stats.wc_incomplete.exchange(0, std::memory_order_relaxed)),
+        enif_make_uint(env, stats.working_counter.load(std::memory_order_relaxed)),
+        enif_make_int(env, task->dc_error()),
+        enif_make_int64(env, time),
+        drain_histogram(env, stats.latency),
+        drain_histogram(env, stats.duration),
+    };
+    result = make_ok(env, make_map(env, keys, values, sizeof(values) / sizeof(values[0])));
+  }
+  master.unpin();
+  return result;
+}
+
+// Allocates inside an RtScope, which aborts the VM when built with
+// ETHERCAT_RT_CHECKS=1 and returns :disabled otherwise. Lets the test
+// suite check that the trap is armed.
+ERL_NIF_TERM rt_check_trap(ErlNifEnv *env, int, const ERL_NIF_TERM[]) {
+  RtScope scope;
+  // Through a volatile pointer, so that the pair cannot be elided.
+  int *volatile probe = new int(0);
+  delete probe;
+  return enif_make_atom(env, "disabled");
+}
+
+ERL_NIF_TERM attach_monitor(ErlNifEnv *env, int, const ERL_NIF_TERM argv[]) {
+  Master *master;
+  ErlNifPid pid;
+  if (!get_master(env, argv[0], &master) || !enif_get_local_pid(env, argv[1], &pid)) {
+    return enif_make_badarg(env);
+  }
+  if (!master->is_open()) return make_error(env, atoms.closed);
+
+  master->monitors().add(pid);
+  return atoms.ok;
+}
+
+ERL_NIF_TERM detach_monitor(ErlNifEnv *env, int, const ERL_NIF_TERM argv[]) {
+  Master *master;
+  ErlNifPid pid;
+  if (!get_master(env, argv[0], &master) || !enif_get_local_pid(env, argv[1], &pid)) {
+    return enif_make_badarg(env);
+  }
+
+  master->monitors().remove(pid);
+  return atoms.ok;
+}
+
+}  // namespace ethercat_ex
@@ -0,0 +1,92 @@
+#include "monitors.hpp"
+
+#include <algorithm>
+
+#include "nif_util.hpp"
+
+namespace ethercat_ex {
+
+namespace {
+
+bool same_pid(const ErlNifPid &a, const ErlNifPid &b) {
+  return enif_compare_pids(&a, &b) == 0;
+}
+
+ERL_NIF_TERM make_wc_state(ec_wc_state_t state) {
+  switch (state) {
+    case EC_WC_ZERO:
+      return atoms.zero;
+    case EC_WC_INCOMPLETE:
+      return atoms.incomplete;
+    default:
+      return atoms.complete;
+  }
+}
+
+// {:ethercat, :domain, %{...}}, {:ethercat, :master, %{...}},
+// {:ethercat, :slave, position, %{...}} or {:ethercat, :reflex, rule}
+ERL_NIF_TERM make_event(ErlNifEnv *env, const Event &event) {
+  switch (event.kind) {
+    case Event::Kind::Domain: {
+      static const char *const keys[] = {"domain", "working_counter", "wc_state"};
+      const ERL_NIF_TERM values[] = {enif_make_uint(env, event.position),
+                                     enif_make_uint(env, event.domain.working_counter),
+                                     make_wc_state(event.domain.wc_state)};
+      return enif_make_tuple3(env, atoms.ethercat, atoms.domain, make_map(env, keys, values, 3));
+    }
+    case Event::Kind::Master: {
+      static const char *const keys[] = {"slaves_responding", "al_states", "link_up"};
+      const ERL_NIF_TERM values[] = {enif_make_uint(env, event.master.slaves_responding),
+                                     make_al_state_list(env, event.master.al_states),
+                                     make_bool(event.master.link_up)};
+      return enif_make_tuple3(env, atoms.ethercat, atoms.master, make_map(env, keys, values, 3));
+    }
+    case Event::Kind::Reflex:
+      return enif_make_tuple3(env, atoms.ethercat, atoms.reflex,
+                              enif_make_uint(env, event.position));
+    case Event::Kind::Slave:
+    default: {
+      static const char *const keys[] = {"online", "operational", "al_state"};
+      const ERL_NIF_TERM values[] = {make_bool(event.slave.online),
+                                     make_bool(event.slave.operational),
+                                     make_al_state(event.slave.al_state)};
+      return enif_make_tuple4(env, atoms.ethercat, atoms.slave,
+                              enif_make_uint(env, event.position), make_map(env, keys, values, 3));
+    }
+  }
+}
+
+}  // namespace
+
+void Monitors::add(const ErlNifPid &pid) {
+  std::lock_guard<std::mutex> guard(lock_);
+  for (const ErlNifPid &known : pids_) {
+    if (same_pid(known, pid)) return;
+  }
+  pids_.push_back(pid);
+}
+
+void Monitors::remove(const ErlNifPid &pid) {
+  std::lock_guard<std::mutex> guard(lock_);
+  pids_.erase(std::remove_if(pids_.begin(), pids_.end(),
+                             [&](const ErlNifPid &known) { return same_pid(known, pid); }),
+              pids_.end());
+}
+
+void Monitors::deliver(const Event &event) {
+  std::lock_guard<std::mutex> guard(lock_);
+  if (pids_.empty()) return;
+
+  ErlNifEnv *env = message_env();
+  auto it = pids_.begin();
+  while (it != pids_.end()) {
+    // Sending clears the env, so the message is rebuilt for every receiver.
+    if (send_message(*it, make_event(env, event))) {
+      ++it;
+    } else {
+      it = pids_.erase(it);
+    }
+  }
+}
+
+}  // namespace ethercat_ex
@@ -0,0 +1,43 @@
+// Bus state changes and the Elixir processes that want to hear about them.
+#pragma once
+
+#include <ecrt.h>
+#include <erl_nif.h>
+
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+namespace ethercat_ex {
+
+// A state change observed by the exchange. Queued by value, so that the
+// thread running the exchange never allocates to report one.
+struct Event {
+  enum class Kind : uint8_t { Domain, Master, Slave, Reflex };
+
+  Kind kind;
+  // Slave position, domain index for domain events, rule index for reflex
+  // events.
+  uint16_t position;
+  ec_domain_state_t domain;
+  ec_master_state_t master;
+  ec_slave_config_state_t slave;
+};
+
+// Processes registered through attach_monitor/1. Only used from scheduler
+// threads and the notifier thread, never from the cyclic thread.
+class Monitors {
+ public:
+  void add(const ErlNifPid &pid);
+  void remove(const ErlNifPid &pid);
+
+  // Sends the event to every registered process and forgets the ones that
+  // no longer exist.
+  void deliver(const Event &event);
+
+ private:
+  std::mutex lock_;
+  std::vector<ErlNifPid> pids_;
+};
+
+}  // namespace ethercat_ex
@@ -0,0 +1,126 @@
+#include "nif_util.hpp"
+
+#include <cstring>
+
+namespace ethercat_ex {
+
+namespace {
+
+struct MessageEnv {
+  ErlNifEnv *env = enif_alloc_env();
+  ~MessageEnv() { enif_free_env(env); }
+};
+
+thread_local MessageEnv message_env_;
+
+}  // namespace
+
+Atoms atoms;
+
+ErlNifEnv *message_env() { return message_env_.env; }
+
+bool send_message(const ErlNifPid &pid, ERL_NIF_TERM message) {
+  ErlNifEnv *env = message_env_.env;
+  // A successful send clears the environment itself.
+  const bool sent = enif_send(nullptr, &pid, env, message);
+  if (!sent) enif_clear_env(env);
+  return sent;
+}
+
+void init_atoms(ErlNifEnv *env) {
+  atoms.ok = enif_make_atom(env, "ok");
+  atoms.error = enif_make_atom(env, "error");
+  atoms.true_ = enif_make_atom(env, "true");
+  atoms.false_ = enif_make_atom(env, "false");
+  atoms.nil = enif_make_atom(env, "nil");
+  atoms.closed = enif_make_atom(env, "closed");
+  atoms.already_active = enif_make_atom(env, "already_active");
+  atoms.not_active = enif_make_atom(env, "not_active");
+  atoms.not_owner = enif_make_atom(env, "not_owner");
+  atoms.not_configured = enif_make_atom(env, "not_configured");
+  atoms.size_mismatch = enif_make_atom(env, "size_mismatch");
+  atoms.input = enif_make_atom(env, "input");
+  atoms.output = enif_make_atom(env, "output");
+  atoms.complete = enif_make_atom(env, "complete");
+  atoms.follow_reference = enif_make_atom(env, "follow_reference");
+  atoms.sync_reference = enif_make_atom(env, "sync_reference");
+  atoms.monotonic = enif_make_atom(env, "monotonic");
+  atoms.virtual_ = enif_make_atom(env, "virtual");
+  atoms.not_cyclic = enif_make_atom(env, "not_cyclic");
+  atoms.ethercat = enif_make_atom(env, "ethercat");
+  atoms.domain = enif_make_atom(env, "domain");
+  atoms.master = enif_make_atom(env, "master");
+  atoms.slave = enif_make_atom(env, "slave");
+  atoms.zero = enif_make_atom(env, "zero");
+  atoms.incomplete = enif_make_atom(env, "incomplete");
+  atoms.sdo_done = enif_make_atom(env, "sdo_done");
+  atoms.sdo_failed = enif_make_atom(env, "sdo_failed");
+  atoms.queue_full = enif_make_atom(env, "queue_full");
+  atoms.too_large = enif_make_atom(env, "too_large");
+  atoms.init = enif_make_atom(env, "init");
+  atoms.pre_operational = enif_make_atom(env, "pre_operational");
+  atoms.bootstrap = enif_make_atom(env, "bootstrap");
+  atoms.safe_operational = enif_make_atom(env, "safe_operational");
+  atoms.operational = enif_make_atom(env, "operational");
+  atoms.unknown = enif_make_atom(env, "unknown");
+  atoms.unknown_domain = enif_make_atom(env, "unknown_domain");
+  atoms.pdo_changed = enif_make_atom(env, "pdo_changed");
+  atoms.too_many_subscriptions = enif_make_atom(env, "too_many_subscriptions");
+  atoms.reflex = enif_make_atom(env, "reflex");
+  atoms.ethercat_stream = enif_make_atom(env, "ethercat_stream");
+  atoms.foe_done = enif_make_atom(env, "foe_done");
+  atoms.foe_progress = enif_make_atom(env, "foe_progress");
+  atoms.foe_failed = enif_make_atom(env, "foe_failed");
+  atoms.busy = enif_make_atom(env, "busy");
+  atoms.no_transfer = enif_make_atom(env, "no_transfer");
+  atoms.register_done = enif_make_atom(env, "register_done");
+  atoms.configuration_failed = enif_make_atom(env, "configuration_failed");
+  atoms.eq = enif_make_atom(env, "==");
+  atoms.ne = enif_make_atom(env, "!=");
+}
+
+ERL_NIF_TERM make_errno(ErlNifEnv *env, int ret) {
+  const int code = ret < 0 ? -ret : ret;
+  return enif_make_tuple2(env, enif_make_int(env, code),
+                          make_binary_string(env, std::strerror(code)));
+}
+
+ERL_NIF_TERM make_errno_error(ErlNifEnv *env, int ret) {
+  return make_error(env, make_errno(env, ret));
+}
+
+ERL_NIF_TERM make_al_state(unsigned state) {
+  switch (state) {
+    case 1:
+      return atoms.init;
+    case 2:
+      return atoms.pre_operational;
+    case 3:
+      return atoms.bootstrap;
+    case 4:
+      return atoms.safe_operational;
+    case 8:
+      return atoms.operational;
+    default:
+      return atoms.unknown;
+  }
+}
+
+ERL_NIF_TERM make_al_state_list(ErlNifEnv *env, unsigned mask) {
+  ERL_NIF_TERM list = enif_make_list(env, 0);
+  for (unsigned bit = 8; bit != 0; bit >>= 1) {
+    if (mask & bit) list = enif_make_list_cell(env, make_al_state(bit), list);
+  }
+  return list;
+}
+
+ERL_NIF_TERM make_map(ErlNifEnv *env, const char *const keys[],
+                      const ERL_NIF_TERM values[], size_t count) {
+  ERL_NIF_TERM map = enif_make_new_map(env);
+  for (size_t i = 0; i < count; ++i) {
+    enif_make_map_put(env, map, enif_make_atom(env, keys[i]), values[i], &map);
+  }
+  return map;
+}
+
+}  // namespace ethercat_ex
@@ -0,0 +1,132 @@
+// Shared helpers for building and decoding Erlang terms in the NIF.
+#pragma once
+
+#include <erl_nif.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace ethercat_ex {
+
+struct Atoms {
+  ERL_NIF_TERM ok;
+  ERL_NIF_TERM error;
+  ERL_NIF_TERM true_;
+  ERL_NIF_TERM false_;
+  ERL_NIF_TERM nil;
+  ERL_NIF_TERM closed;
+  ERL_NIF_TERM already_active;
+  ERL_NIF_TERM not_active;
+  ERL_NIF_TERM not_owner;
+  ERL_NIF_TERM not_configured;
+  ERL_NIF_TERM size_mismatch;
+  ERL_NIF_TERM input;
+  ERL_NIF_TERM output;
+  ERL_NIF_TERM complete;
+  ERL_NIF_TERM follow_reference;
+  ERL_NIF_TERM sync_reference;
+  ERL_NIF_TERM monotonic;
+  ERL_NIF_TERM virtual_;
+  ERL_NIF_TERM not_cyclic;
+  ERL_NIF_TERM ethercat;
+  ERL_NIF_TERM domain;
+  ERL_NIF_TERM master;
+  ERL_NIF_TERM slave;
+  ERL_NIF_TERM zero;
+  ERL_NIF_TERM incomplete;
+  ERL_NIF_TERM sdo_done;
+  ERL_NIF_TERM sdo_failed;
+  ERL_NIF_TERM queue_full;
+  ERL_NIF_TERM too_large;
+  ERL_NIF_TERM init;
+  ERL_NIF_TERM pre_operational;
+  ERL_NIF_TERM bootstrap;
+  ERL_NIF_TERM safe_operational;
+  ERL_NIF_TERM operational;
+  ERL_NIF_TERM unknown;
+  ERL_NIF_TERM unknown_domain;
+  ERL_NIF_TERM pdo_changed;
+  ERL_NIF_TERM too_many_subscriptions;
+  ERL_NIF_TERM reflex;
+  ERL_NIF_TERM ethercat_stream;
+  ERL_NIF_TERM foe_done;
+  ERL_NIF_TERM foe_progress;
+  ERL_NIF_TERM foe_failed;
+  ERL_NIF_TERM busy;
+  ERL_NIF_TERM no_transfer;
+  ERL_NIF_TERM register_done;
+  ERL_NIF_TERM configuration_failed;
+  ERL_NIF_TERM eq;
+  ERL_NIF_TERM ne;
+};
+
+extern Atoms atoms;
+
+void init_atoms(ErlNifEnv *env);
+
+// Environment for building a message on a thread the BEAM does not manage,
+// such as the notifier. There is one per thread, reused for every message
+// instead of allocated for each.
+ErlNifEnv *message_env();
+// Sends `message`, built in message_env(), and clears the environment for
+// the next one whether or not it was delivered.
+bool send_message(const ErlNifPid &pid, ERL_NIF_TERM message);
+
+inline ERL_NIF_TERM make_ok(ErlNifEnv *env, ERL_NIF_TERM value) {
+  return enif_make_tuple2(env, atoms.ok, value);
+}
+
+inline ERL_NIF_TERM make_error(ErlNifEnv *env, ERL_NIF_TERM reason) {
+  return enif_make_tuple2(env, atoms.error, reason);
+}
+
+inline ERL_NIF_TERM make_bool(bool value) {
+  return value ? atoms.true_ : atoms.false_;
+}
+
+// Copies a NUL-terminated C string into a new Elixir binary.
+inline ERL_NIF_TERM make_binary_string(ErlNifEnv *env, const char *str) {
+  ERL_NIF_TERM term;
+  const size_t len = std::strlen(str);
+  unsigned char *data = enif_make_new_binary(env, len, &term);
+  std::memcpy(data, str, len);
+  return term;
+}
+
+inline bool get_u8(ErlNifEnv *env, ERL_NIF_TERM term, uint8_t *out) {
+  unsigned value;
+  if (!enif_get_uint(env, term, &value) || value > UINT8_MAX) return false;
+  *out = static_cast<uint8_t>(value);
+  return true;
+}
+
+inline bool get_u16(ErlNifEnv *env, ERL_NIF_TERM term, uint16_t *out) {
+  unsigned value;
+  if (!enif_get_uint(env, term, &value) || value > UINT16_MAX) return false;
+  *out = static_cast<uint16_t>(value);
+  return true;
+}
+
+// Looks up an atom key in an Elixir map. Returns false if the key is absent.
+inline bool get_map_field(ErlNifEnv *env, ERL_NIF_TERM map, const char *key, ERL_NIF_TERM *out) {
+  return enif_get_map_value(env, map, enif_make_atom(env, key), out);
+}
+
+// libethercat reports failures as negative errno values. They are surfaced
+// as `{:error, {code, reason}}`, the same shape `EthercatEx.Cli` uses for
+// failed commands. make_errno() builds the bare `{code, reason}`.
+ERL_NIF_TERM make_errno(ErlNifEnv *env, int ret);
+ERL_NIF_TERM make_errno_error(ErlNifEnv *env, int ret);
+
+// Converts a single EtherCAT AL state value (1, 2, 3, 4 or 8) to an atom.
+ERL_NIF_TERM make_al_state(unsigned state);
+
+// Expands an AL state bitmask such as `ec_master_state_t::al_states` into a
+// list of atoms, lowest state first.
+ERL_NIF_TERM make_al_state_list(ErlNifEnv *env, unsigned mask);
+
+ERL_NIF_TERM make_map(ErlNifEnv *env, const char *const keys[],
+                      const ERL_NIF_TERM values[], size_t count);
+
+}  // namespace ethercat_ex
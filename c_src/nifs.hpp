@@ -0,0 +1,69 @@
+// Prototypes of the NIF entry points registered in ethercat_nif.cpp.
+#pragma once
+
+#include <erl_nif.h>
+
+namespace ethercat_ex {
+
+#define ETHERCAT_NIF(name) ERL_NIF_TERM name(ErlNifEnv *env, int argc, const ERL_NIF_TERM argv[])
+
+// master_nif.cpp
+ETHERCAT_NIF(request_master);
+ETHERCAT_NIF(release_master);
+ETHERCAT_NIF(activate);
+ETHERCAT_NIF(master_info);
+ETHERCAT_NIF(master_state);
+ETHERCAT_NIF(slave_info);
+ETHERCAT_NIF(slaves);
+ETHERCAT_NIF(cycle_stats);
+ETHERCAT_NIF(rt_check_trap);
+ETHERCAT_NIF(attach_monitor);
+ETHERCAT_NIF(detach_monitor);
+
+// domain_nif.cpp
+ETHERCAT_NIF(create_domain);
+ETHERCAT_NIF(configure_slave);
+ETHERCAT_NIF(slave_layout);
+ETHERCAT_NIF(domain_image);
+ETHERCAT_NIF(read_pdo);
+ETHERCAT_NIF(write_pdo);
+ETHERCAT_NIF(cycle);
+
+// sdo_nif.cpp
+ETHERCAT_NIF(sdo_read);
+ETHERCAT_NIF(sdo_write);
+
+// foe_nif.cpp
+ETHERCAT_NIF(foe_load);
+ETHERCAT_NIF(foe_write);
+ETHERCAT_NIF(foe_read);
+ETHERCAT_NIF(foe_unload);
+ETHERCAT_NIF(foe_release);
+
+// register_nif.cpp
+ETHERCAT_NIF(register_read);
+ETHERCAT_NIF(register_write);
+
+// convert_nif.cpp
+ETHERCAT_NIF(convert_prepare);
+ETHERCAT_NIF(convert_f64);
+
+// recorder_nif.cpp
+ETHERCAT_NIF(recorder_start);
+ETHERCAT_NIF(recorder_freeze);
+ETHERCAT_NIF(recorder_stop);
+
+// reflex_nif.cpp
+ETHERCAT_NIF(set_reflexes);
+
+// subscription_nif.cpp
+ETHERCAT_NIF(subscribe_pdo);
+ETHERCAT_NIF(unsubscribe_pdo);
+
+// stream_nif.cpp
+ETHERCAT_NIF(stream_start);
+ETHERCAT_NIF(stream_stop);
+
+#undef ETHERCAT_NIF
+
+}  // namespace ethercat_ex
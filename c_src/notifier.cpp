@@ -0,0 +1,79 @@
+#include "notifier.hpp"
+
+namespace ethercat_ex {
+
+Notifier::Notifier(Monitors *monitors, Subscriptions *subscriptions, DeltaStream *stream,
+                   FoeEngine *foe, RegisterEngine *registers)
+    : monitors_(monitors),
+      subscriptions_(subscriptions),
+      stream_(stream),
+      foe_(foe),
+      registers_(registers) {
+  sem_init(&wakeup_, 0, 0);
+}
+
+Notifier::~Notifier() {
+  stop();
+  sem_destroy(&wakeup_);
+}
+
+void Notifier::start() {
+  running_.store(true);
+  thread_ = std::thread(&Notifier::loop, this);
+}
+
+void Notifier::stop() {
+  if (!thread_.joinable()) return;
+
+  running_.store(false);
+  sem_post(&wakeup_);
+  thread_.join();
+  drain();
+}
+
+bool Notifier::post(Message *message) {
+  if (!queue_.push(message)) return false;
+  sem_post(&wakeup_);
+  return true;
+}
+
+bool Notifier::post_event(const Event &event) {
+  if (!events_.push(event)) return false;
+  sem_post(&wakeup_);
+  return true;
+}
+
+bool Notifier::post_change(const PdoChange &change) {
+  if (!changes_.push(change)) return false;
+  sem_post(&wakeup_);
+  return true;
+}
+
+void Notifier::wake() { sem_post(&wakeup_); }
+
+void Notifier::loop() {
+  while (running_.load()) {
+    sem_wait(&wakeup_);
+    drain();
+  }
+}
+
+void Notifier::drain() {
+  Message *message;
+  while (queue_.pop(message)) {
+    message->deliver();
+    delete message;
+  }
+
+  Event event;
+  while (events_.pop(event)) monitors_->deliver(event);
+
+  PdoChange change;
+  while (changes_.pop(change)) subscriptions_->deliver(change);
+
+  stream_->drain();
+  foe_->report();
+  registers_->report();
+}
+
+}  // namespace ethercat_ex
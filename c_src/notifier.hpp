@@ -0,0 +1,74 @@
+// Delivers messages produced on the cyclic thread to Elixir processes.
+#pragma once
+
+#include <semaphore.h>
+
+#include <atomic>
+#include <thread>
+
+#include "delta_stream.hpp"
+#include "foe_engine.hpp"
+#include "monitors.hpp"
+#include "register_engine.hpp"
+#include "spsc_queue.hpp"
+#include "subscriptions.hpp"
+
+namespace ethercat_ex {
+
+// Something to hand to Elixir. Built and queued by the producer, delivered
+// (typically through enif_send()) and then deleted on the notifier thread.
+class Message {
+ public:
+  virtual ~Message() = default;
+  virtual void deliver() = 0;
+};
+
+// enif_send() copies terms and may take locks, so it has no place on the
+// RT thread. The cyclic thread only pushes pointers or plain events onto
+// lock-free rings and posts a semaphore; a plain thread per master does the
+// sending.
+class Notifier {
+ public:
+  // Events posted with post_event() go to `monitors`, changes posted with
+  // post_change() to `subscriptions`; `stream`, `foe` and `registers` are
+  // drained on every wake-up.
+  Notifier(Monitors *monitors, Subscriptions *subscriptions, DeltaStream *stream,
+           FoeEngine *foe, RegisterEngine *registers);
+  ~Notifier();
+
+  Notifier(const Notifier &) = delete;
+  Notifier &operator=(const Notifier &) = delete;
+
+  void start();
+  // Delivers everything still queued, then joins the thread.
+  void stop();
+
+  // Single producer: the thread running the exchange. Returns false, and
+  // keeps ownership with the caller, when the ring is full.
+  bool post(Message *message);
+  // Same producer as post(). Drops the event when the ring is full.
+  bool post_event(const Event &event);
+  // Same producer as post(). Returns false when the ring is full.
+  bool post_change(const PdoChange &change);
+  // Same producer as post(). Makes the thread drain without queueing
+  // anything.
+  void wake();
+
+ private:
+  void loop();
+  void drain();
+
+  Monitors *monitors_;
+  Subscriptions *subscriptions_;
+  DeltaStream *stream_;
+  FoeEngine *foe_;
+  RegisterEngine *registers_;
+  SpscQueue<Message *, 1024> queue_;
+  SpscQueue<Event, 256> events_;
+  SpscQueue<PdoChange, 1024> changes_;
+  sem_t wakeup_;
+  std::atomic<bool> running_{false};
+  std::thread thread_;
+};
+
+}  // namespace ethercat_ex
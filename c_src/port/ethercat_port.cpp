@@ -0,0 +1,410 @@
+// Long-lived helper serving `ethercat` tool commands from libethercat, so
+// EthercatEx.Cli does not fork a tool process, and reopen the master
+// device, for every call. Spawned by EthercatEx.Cli.Coprocess as an Erlang
+// port with {:packet, 4}; the only argument is the master index.
+//
+// A request is the command followed by its arguments, each terminated by a
+// NUL byte, as they would be passed to the tool after `-m <master>`; SDO
+// addresses may also be given as one "index:subindex" argument. The
+// reply is one status byte and the output: 0 and output formatted like the
+// tool's own, so the same parsers read both; 1 and an error message for a
+// command that failed; or kUnsupported for a command or option not served
+// here, which the caller then runs through the tool itself.
+#include <ecrt.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cinttypes>
+#include <cstdarg>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace ethercat_ex {
+
+namespace {
+
+constexpr uint8_t kOk = 0;
+constexpr uint8_t kFailed = 1;
+constexpr uint8_t kUnsupported = 255;
+
+struct Reply {
+  uint8_t status = kOk;
+  std::string output;
+
+  void printf(const char *format, ...) __attribute__((format(printf, 2, 3))) {
+    char line[512];
+    va_list args;
+    va_start(args, format);
+    const int n = std::vsnprintf(line, sizeof(line), format, args);
+    va_end(args);
+    if (n > 0) output.append(line, std::min<size_t>(n, sizeof(line) - 1));
+  }
+
+  void fail(uint8_t code, const char *message) {
+    status = code;
+    output = message;
+  }
+};
+
+// Options and positional arguments of one request.
+struct Args {
+  int position = -1;
+  std::string type;
+  std::vector<std::string> positional;
+  bool unknown_option = false;
+};
+
+Args parse_args(const std::vector<std::string> &argv) {
+  Args args;
+  for (size_t i = 1; i < argv.size(); ++i) {
+    const std::string &arg = argv[i];
+    if ((arg == "-p" || arg == "--position") && i + 1 < argv.size()) {
+      args.position = std::atoi(argv[++i].c_str());
+    } else if ((arg == "-t" || arg == "--type") && i + 1 < argv.size()) {
+      args.type = argv[++i];
+    } else if (arg == "-q" || arg == "--quiet") {
+      // Nothing is printed besides the result anyway.
+    } else if (arg.size() > 1 && arg[0] == '-' &&
+               !std::isdigit(static_cast<unsigned char>(arg[1]))) {
+      args.unknown_option = true;
+    } else {
+      args.positional.push_back(arg);
+    }
+  }
+  return args;
+}
+
+bool parse_number(const std::string &text, int64_t max, int64_t *value, int base = 0) {
+  char *end;
+  errno = 0;
+  const long long parsed = std::strtoll(text.c_str(), &end, base);
+  if (errno != 0 || end == text.c_str() || *end != '\0' || parsed < 0 || parsed > max) {
+    return false;
+  }
+  *value = parsed;
+  return true;
+}
+
+const char *al_state_name(uint8_t state) {
+  switch (state & 0x0F) {
+    case EC_AL_STATE_INIT:
+      return "INIT";
+    case EC_AL_STATE_PREOP:
+      return "PREOP";
+    case 0x03:
+      return "BOOT";
+    case EC_AL_STATE_SAFEOP:
+      return "SAFEOP";
+    case EC_AL_STATE_OP:
+      return "OP";
+    default:
+      return "???";
+  }
+}
+
+// Integer CoE types as named by the tool's --type option.
+struct IntegerType {
+  const char *name;
+  size_t size;
+  bool is_signed;
+};
+
+constexpr IntegerType kIntegerTypes[] = {
+    {"bool", 1, false},  {"uint8", 1, false}, {"uint16", 2, false}, {"uint32", 4, false},
+    {"uint64", 8, false}, {"int8", 1, true},   {"int16", 2, true},   {"int32", 4, true},
+    {"int64", 8, true},
+};
+
+const IntegerType *integer_type(const std::string &name) {
+  for (const IntegerType &type : kIntegerTypes) {
+    if (name == type.name) return &type;
+  }
+  return nullptr;
+}
+
+// Stands in for the dictionary lookup the tool does without -t: an entry
+// of 1, 2, 4 or 8 bytes is taken as an unsigned integer of that size.
+const IntegerType *unsigned_type(size_t size) {
+  switch (size) {
+    case 1:
+      return integer_type("uint8");
+    case 2:
+      return integer_type("uint16");
+    case 4:
+      return integer_type("uint32");
+    case 8:
+      return integer_type("uint64");
+    default:
+      return nullptr;
+  }
+}
+
+// Reads the object address at the start of `positional`, either as the
+// tool's two arguments "index subindex" or as one "index:subindex" with a
+// hexadecimal subindex. Returns the number of arguments used, 0 if there is
+// no valid address.
+size_t parse_address(const std::vector<std::string> &positional, int64_t *index,
+                     int64_t *subindex) {
+  if (positional.empty()) return 0;
+
+  const std::string &first = positional[0];
+  const size_t colon = first.find(':');
+  if (colon != std::string::npos) {
+    return parse_number(first.substr(0, colon), 0xFFFF, index) &&
+                   parse_number(first.substr(colon + 1), 0xFF, subindex, 16)
+               ? 1
+               : 0;
+  }
+  return positional.size() >= 2 && parse_number(first, 0xFFFF, index) &&
+                 parse_number(positional[1], 0xFF, subindex)
+             ? 2
+             : 0;
+}
+
+// ethercat slaves [-p position]
+void slaves(ec_master_t *master, const Args &args, Reply &reply) {
+  ec_master_info_t info;
+  if (ecrt_master(master, &info) != 0) {
+    return reply.fail(kFailed, "Failed to get master information.");
+  }
+
+  // Positions are printed relative to the last slave with an alias, like
+  // the tool does.
+  uint16_t alias = 0;
+  unsigned relative = 0;
+  for (unsigned position = 0; position < info.slave_count; ++position) {
+    ec_slave_info_t slave;
+    if (ecrt_master_get_slave(master, position, &slave) != 0) {
+      return reply.fail(kFailed, "Failed to get slave information.");
+    }
+    if (slave.alias != 0) {
+      alias = slave.alias;
+      relative = 0;
+    }
+    if (args.position < 0 || static_cast<unsigned>(args.position) == position) {
+      reply.printf("%u  %u:%u  %-6s  %c  %s\n", position, alias, relative,
+                   al_state_name(slave.al_state), slave.error_flag ? 'E' : '+', slave.name);
+    }
+    ++relative;
+  }
+}
+
+// ethercat pdos -p position. libethercat has no PDO names, so they are
+// printed empty.
+void pdos(ec_master_t *master, const Args &args, Reply &reply) {
+  ec_slave_info_t slave;
+  if (ecrt_master_get_slave(master, args.position, &slave) != 0) {
+    return reply.fail(kFailed, "Failed to get slave information.");
+  }
+
+  for (uint8_t sm = 0; sm < slave.sync_count; ++sm) {
+    ec_sync_info_t sync;
+    if (ecrt_master_get_sync_manager(master, args.position, sm, &sync) != 0) {
+      return reply.fail(kFailed, "Failed to get sync manager.");
+    }
+    reply.printf("SM%u:\n", sm);
+
+    for (unsigned p = 0; p < sync.n_pdos; ++p) {
+      ec_pdo_info_t pdo;
+      if (ecrt_master_get_pdo(master, args.position, sm, p, &pdo) != 0) {
+        return reply.fail(kFailed, "Failed to get PDO.");
+      }
+      reply.printf("  %cxPDO 0x%04X \"\"\n", sync.dir == EC_DIR_OUTPUT ? 'R' : 'T', pdo.index);
+
+      for (unsigned e = 0; e < pdo.n_entries; ++e) {
+        ec_pdo_entry_info_t entry;
+        if (ecrt_master_get_pdo_entry(master, args.position, sm, p, e, &entry) != 0) {
+          return reply.fail(kFailed, "Failed to get PDO entry.");
+        }
+        reply.printf("    PDO entry 0x%04X:%02X, %2u bit, \"\"\n", entry.index, entry.subindex,
+                     entry.bit_length);
+      }
+    }
+  }
+}
+
+// Reports a failed SDO transfer: the abort code if the slave sent one,
+// otherwise the error of the call. An entry too big for the buffers here
+// goes to the tool, which sizes its own.
+void sdo_error(Reply &reply, int ret, uint32_t abort_code) {
+  if (ret == -EOVERFLOW) return reply.fail(kUnsupported, "");
+
+  char message[64];
+  if (abort_code != 0) {
+    std::snprintf(message, sizeof(message), "SDO transfer aborted with code 0x%08X.",
+                  abort_code);
+  } else {
+    std::snprintf(message, sizeof(message), "SDO transfer failed: %s.", std::strerror(-ret));
+  }
+  reply.fail(kFailed, message);
+}
+
+// Largest entry uploaded here; anything bigger is not an integer anyway.
+constexpr size_t kUploadSize = 64;
+
+// ethercat upload -p position [-t type] index subindex
+void upload(ec_master_t *master, const Args &args, Reply &reply) {
+  const IntegerType *type = integer_type(args.type);
+  int64_t index, subindex;
+  const size_t used = parse_address(args.positional, &index, &subindex);
+  if ((!args.type.empty() && !type) || used == 0 || args.positional.size() != used) {
+    // Other types stay with the tool.
+    return reply.fail(kUnsupported, "");
+  }
+
+  uint8_t data[kUploadSize] = {};
+  size_t size;
+  uint32_t abort_code = 0;
+  const int ret = ecrt_master_sdo_upload(master, args.position, index, subindex, data,
+                                         sizeof(data), &size, &abort_code);
+  if (ret != 0) return sdo_error(reply, ret, abort_code);
+  if (type == nullptr && (type = unsigned_type(size)) == nullptr) {
+    return reply.fail(kUnsupported, "");
+  }
+
+  uint64_t value = 0;
+  for (size_t i = 0; i < type->size && i < size; ++i) value |= uint64_t{data[i]} << (8 * i);
+  const int width = static_cast<int>(type->size * 2);
+  if (type->is_signed) {
+    const unsigned shift = 64 - 8 * type->size;
+    const int64_t signed_value = static_cast<int64_t>(value << shift) >> shift;
+    reply.printf("0x%0*" PRIx64 " %" PRId64 "\n", width, value, signed_value);
+  } else {
+    reply.printf("0x%0*" PRIx64 " %" PRIu64 "\n", width, value, value);
+  }
+}
+
+// ethercat download -p position [-t type] index subindex value
+void download(ec_master_t *master, const Args &args, Reply &reply) {
+  const IntegerType *type = integer_type(args.type);
+  int64_t index, subindex;
+  const size_t used = parse_address(args.positional, &index, &subindex);
+  if ((!args.type.empty() && !type) || used == 0 || args.positional.size() != used + 1) {
+    return reply.fail(kUnsupported, "");
+  }
+
+  uint32_t abort_code = 0;
+  if (type == nullptr) {
+    // The entry's size is all the download needs from the dictionary.
+    uint8_t current[kUploadSize];
+    size_t size;
+    const int ret = ecrt_master_sdo_upload(master, args.position, index, subindex, current,
+                                           sizeof(current), &size, &abort_code);
+    if (ret != 0) return sdo_error(reply, ret, abort_code);
+    if ((type = unsigned_type(size)) == nullptr) return reply.fail(kUnsupported, "");
+  }
+
+  char *end;
+  errno = 0;
+  const std::string &text = args.positional[used];
+  const uint64_t value = type->is_signed || text[0] == '-'
+                             ? static_cast<uint64_t>(std::strtoll(text.c_str(), &end, 0))
+                             : std::strtoull(text.c_str(), &end, 0);
+  if (errno != 0 || end == text.c_str() || *end != '\0') {
+    return reply.fail(kFailed, "Invalid value for type.");
+  }
+
+  uint8_t data[8];
+  for (size_t i = 0; i < type->size; ++i) data[i] = static_cast<uint8_t>(value >> (8 * i));
+  const int ret = ecrt_master_sdo_download(master, args.position, index, subindex, data,
+                                           type->size, &abort_code);
+  if (ret != 0) return sdo_error(reply, ret, abort_code);
+}
+
+void serve(ec_master_t *master, const std::vector<std::string> &argv, Reply &reply) {
+  const Args args = parse_args(argv);
+  if (args.unknown_option) return reply.fail(kUnsupported, "");
+
+  const std::string &command = argv[0];
+  if (command == "slaves") return slaves(master, args, reply);
+  if (args.position < 0) return reply.fail(kUnsupported, "");
+  if (command == "pdos") return pdos(master, args, reply);
+  if (command == "upload") return upload(master, args, reply);
+  if (command == "download") return download(master, args, reply);
+  reply.fail(kUnsupported, "");
+}
+
+bool read_exact(void *buf, size_t size) {
+  auto *p = static_cast<uint8_t *>(buf);
+  while (size > 0) {
+    const ssize_t n = read(STDIN_FILENO, p, size);
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0) return false;
+    p += n;
+    size -= n;
+  }
+  return true;
+}
+
+bool write_exact(const void *buf, size_t size) {
+  auto *p = static_cast<const uint8_t *>(buf);
+  while (size > 0) {
+    const ssize_t n = write(STDOUT_FILENO, p, size);
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0) return false;
+    p += n;
+    size -= n;
+  }
+  return true;
+}
+
+}  // namespace
+
+}  // namespace ethercat_ex
+
+int main(int argc, char **argv) {
+  using namespace ethercat_ex;
+
+  if (argc != 2) {
+    std::fprintf(stderr, "usage: %s <master index>\n", argv[0]);
+    return 2;
+  }
+  ec_master_t *master = ecrt_open_master(std::strtoul(argv[1], nullptr, 10));
+  if (!master) return 1;
+
+  std::vector<uint8_t> request;
+  Reply reply;
+  std::string frame;
+  for (;;) {
+    uint8_t header[4];
+    if (!read_exact(header, sizeof(header))) break;
+    const uint32_t size = uint32_t{header[0]} << 24 | uint32_t{header[1]} << 16 |
+                          uint32_t{header[2]} << 8 | header[3];
+    request.resize(size);
+    if (!read_exact(request.data(), size)) break;
+
+    std::vector<std::string> args;
+    size_t start = 0;
+    for (size_t i = 0; i < size; ++i) {
+      if (request[i] != 0) continue;
+      args.emplace_back(reinterpret_cast<const char *>(request.data()) + start, i - start);
+      start = i + 1;
+    }
+
+    reply = Reply{};
+    if (args.empty()) {
+      reply.fail(kUnsupported, "");
+    } else {
+      serve(master, args, reply);
+    }
+
+    const uint32_t length = reply.output.size() + 1;
+    frame.clear();
+    frame.push_back(static_cast<char>(length >> 24));
+    frame.push_back(static_cast<char>(length >> 16));
+    frame.push_back(static_cast<char>(length >> 8));
+    frame.push_back(static_cast<char>(length));
+    frame.push_back(static_cast<char>(reply.status));
+    frame += reply.output;
+    if (!write_exact(frame.data(), frame.size())) break;
+  }
+
+  ecrt_release_master(master);
+  return 0;
+}
@@ -0,0 +1,121 @@
+#include "recorder.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <new>
+#include <thread>
+
+namespace ethercat_ex {
+
+namespace {
+
+constexpr uint32_t kRecorderVersion = 1;
+// Cycle number and timestamp in front of each image.
+constexpr size_t kRecordPrefix = 16;
+
+}  // namespace
+
+Recorder::~Recorder() { stop(); }
+
+int Recorder::start(const char *path, uint64_t capacity, const std::vector<Domain> &domains) {
+  if (header_ != nullptr) return -EBUSY;
+  if (domains.size() > kRecorderMaxDomains) return -E2BIG;
+  if (capacity == 0) return -EINVAL;
+
+  const Domain &last = domains.back();
+  const size_t image_size = last.image_offset + last.size;
+  const size_t record_size = (kRecordPrefix + image_size + 7) & ~static_cast<size_t>(7);
+  const size_t size = kRecorderHeaderSize + capacity * record_size;
+
+  const int fd = open(path, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (fd < 0) return -errno;
+
+  // Allocate the blocks now so that the exchange never hits a full disk
+  // through a page fault, and fault the pages in before it writes.
+  int ret = posix_fallocate(fd, 0, size);
+  void *map = ret == 0 ? mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                              fd, 0)
+                       : MAP_FAILED;
+  if (map == MAP_FAILED) {
+    ret = ret != 0 ? -ret : -errno;
+    close(fd);
+    return ret;
+  }
+
+  auto *header = new (map) RecorderHeader();
+  std::memcpy(header->magic, kRecorderMagic, sizeof(header->magic));
+  header->version = kRecorderVersion;
+  header->record_size = static_cast<uint32_t>(record_size);
+  header->image_size = image_size;
+  header->capacity = capacity;
+  header->domain_count = static_cast<uint32_t>(domains.size());
+  for (size_t i = 0; i < domains.size(); ++i) {
+    header->domains[i].offset = domains[i].image_offset;
+    header->domains[i].size = domains[i].size;
+  }
+
+  fd_ = fd;
+  mapped_size_ = size;
+  records_ = static_cast<uint8_t *>(map) + kRecorderHeaderSize;
+  header_ = header;
+  remaining_.store(-1);
+  recording_.store(true);
+  return 0;
+}
+
+void Recorder::stop() {
+  if (header_ == nullptr) return;
+
+  recording_.store(false);
+  while (writing_.load()) std::this_thread::yield();
+
+  msync(header_, mapped_size_, MS_SYNC);
+  munmap(header_, mapped_size_);
+  close(fd_);
+  header_ = nullptr;
+  records_ = nullptr;
+  fd_ = -1;
+}
+
+int Recorder::freeze(uint64_t after) {
+  if (header_ == nullptr) return -EBADF;
+  int64_t expected = -1;
+  remaining_.compare_exchange_strong(expected, static_cast<int64_t>(after));
+  return 0;
+}
+
+void Recorder::record(const std::vector<Domain> &domains, uint64_t cycle) {
+  writing_.store(true);
+  if (!recording_.load()) {
+    writing_.store(false);
+    return;
+  }
+
+  const int64_t remaining = remaining_.load(std::memory_order_relaxed);
+  if (remaining == 0) {
+    header_->frozen.store(1, std::memory_order_release);
+  } else {
+    const uint64_t head = header_->head.load(std::memory_order_relaxed);
+    uint8_t *record = records_ + (head % header_->capacity) * header_->record_size;
+
+    timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    const int64_t time_ns = static_cast<int64_t>(now.tv_sec) * 1000000000 + now.tv_nsec;
+    std::memcpy(record, &cycle, sizeof(cycle));
+    std::memcpy(record + 8, &time_ns, sizeof(time_ns));
+    for (const Domain &domain : domains) {
+      std::memcpy(record + kRecordPrefix + domain.image_offset, domain.data, domain.size);
+    }
+    header_->head.store(head + 1, std::memory_order_release);
+
+    if (remaining > 0) remaining_.store(remaining - 1, std::memory_order_relaxed);
+  }
+  writing_.store(false);
+}
+
+}  // namespace ethercat_ex
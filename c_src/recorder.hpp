@@ -0,0 +1,83 @@
+// Post-mortem recording of the process image into a memory-mapped ring file.
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "domain.hpp"
+
+namespace ethercat_ex {
+
+// File layout, in host byte order. The header is followed, at
+// kRecorderHeaderSize, by `capacity` records of `record_size` bytes:
+// the exchange cycle number, CLOCK_REALTIME in ns, and the images of all
+// domains back to back at the offsets listed in the header. Record `n`
+// lives in slot `n % capacity` and `head` records have been written, so
+// the file alone is enough to recover the last window after a crash.
+constexpr size_t kRecorderHeaderSize = 4096;
+constexpr size_t kRecorderMaxDomains = 16;
+constexpr char kRecorderMagic[8] = {'E', 'C', 'A', 'T', 'R', 'E', 'C', '1'};
+
+struct RecorderHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t record_size;
+  uint64_t image_size;
+  uint64_t capacity;
+  std::atomic<uint64_t> head;
+  std::atomic<uint32_t> frozen;
+  uint32_t domain_count;
+  struct {
+    uint64_t offset;
+    uint64_t size;
+  } domains[kRecorderMaxDomains];
+};
+
+static_assert(sizeof(RecorderHeader) <= kRecorderHeaderSize, "header fits its page");
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "head is shared through the file");
+
+// Opened from the BEAM on an active master; the thread running the
+// exchange then appends one record per cycle with plain stores into the
+// shared mapping, so recording costs a memcpy and no system call. The file
+// is allocated and faulted in up front.
+//
+// freeze() asks for `after` more records and then stops the recording, so
+// the ring holds the window around a trigger; the file stays readable
+// through read() or by decoding it directly.
+class Recorder {
+ public:
+  Recorder() = default;
+  ~Recorder();
+
+  Recorder(const Recorder &) = delete;
+  Recorder &operator=(const Recorder &) = delete;
+
+  // BEAM side. Creates or truncates `path`. Returns 0 or a negative errno;
+  // -EBUSY if already recording, -E2BIG with too many domains.
+  int start(const char *path, uint64_t capacity, const std::vector<Domain> &domains);
+  // BEAM side. Waits for a record in progress, then flushes and unmaps.
+  void stop();
+  // BEAM side. Returns -EBADF when not recording.
+  int freeze(uint64_t after);
+  bool is_open() const { return header_ != nullptr; }
+
+  // Thread running the exchange, after send.
+  void record(const std::vector<Domain> &domains, uint64_t cycle);
+
+ private:
+  RecorderHeader *header_ = nullptr;
+  uint8_t *records_ = nullptr;
+  size_t mapped_size_ = 0;
+  int fd_ = -1;
+
+  // recording_ and writing_ are published before each other is read (all
+  // sequentially consistent), so stop() never unmaps under a record.
+  std::atomic<bool> recording_{false};
+  std::atomic<bool> writing_{false};
+  // Records still to write after freeze(), or -1 while not frozen.
+  std::atomic<int64_t> remaining_{-1};
+};
+
+}  // namespace ethercat_ex
@@ -0,0 +1,52 @@
+// Process image recorder of an active master; see Recorder.
+#include <cstdint>
+#include <string>
+
+#include "nif_util.hpp"
+#include "nifs.hpp"
+#include "resources.hpp"
+
+namespace ethercat_ex {
+
+// argv: master, path (binary), capacity in records
+ERL_NIF_TERM recorder_start(ErlNifEnv *env, int, const ERL_NIF_TERM argv[]) {
+  Master *master;
+  ErlNifBinary path;
+  ErlNifUInt64 capacity;
+  if (!get_master(env, argv[0], &master) || !enif_inspect_iolist_as_binary(env, argv[1], &path) ||
+      !enif_get_uint64(env, argv[2], &capacity) || capacity == 0) {
+    return enif_make_badarg(env);
+  }
+
+  std::lock_guard<std::mutex> guard(master->lock);
+  if (!master->is_open()) return make_error(env, atoms.closed);
+  if (!master->is_active()) return make_error(env, atoms.not_active);
+
+  const std::string file(reinterpret_cast<const char *>(path.data), path.size);
+  const int ret = master->recorder().start(file.c_str(), capacity, master->domains());
+  return ret < 0 ? make_errno_error(env, ret) : atoms.ok;
+}
+
+// argv: master, records to write before stopping
+ERL_NIF_TERM recorder_freeze(ErlNifEnv *env, int, const ERL_NIF_TERM argv[]) {
+  Master *master;
+  ErlNifUInt64 after;
+  if (!get_master(env, argv[0], &master) || !enif_get_uint64(env, argv[1], &after)) {
+    return enif_make_badarg(env);
+  }
+
+  std::lock_guard<std::mutex> guard(master->lock);
+  const int ret = master->recorder().freeze(after);
+  return ret < 0 ? make_error(env, atoms.not_active) : atoms.ok;
+}
+
+ERL_NIF_TERM recorder_stop(ErlNifEnv *env, int, const ERL_NIF_TERM argv[]) {
+  Master *master;
+  if (!get_master(env, argv[0], &master)) return enif_make_badarg(env);
+
+  std::lock_guard<std::mutex> guard(master->lock);
+  master->recorder().stop();
+  return atoms.ok;
+}
+
+}  // namespace ethercat_ex
@@ -0,0 +1,108 @@
+// Uploads the reflex rule table of a master.
+//
+// Rules refer to slaves by position and to regions by their offset into
+// the slave's inputs or outputs; they are resolved against the slave
+// configuration here, so the thread running the exchange only ever sees
+// domain offsets.
+#include <cstdint>
+#include <vector>
+
+#include "nif_util.hpp"
+#include "nifs.hpp"
+#include "resources.hpp"
+
+namespace ethercat_ex {
+
+namespace {
+
+enum class Resolve { Ok, Badarg, NotConfigured, SizeMismatch };
+
+// {position, offset, size, mask}, with `offset` relative to the slave's
+// inputs or outputs.
+Resolve get_bits(ErlNifEnv *env, const Master &master, ERL_NIF_TERM term, bool input,
+                 ImageBits *out) {
+  const ERL_NIF_TERM *fields;
+  int arity;
+  uint16_t position;
+  unsigned offset, size;
+  ErlNifUInt64 mask;
+  if (!enif_get_tuple(env, term, &arity, &fields) || arity != 4 ||
+      !get_u16(env, fields[0], &position) || !enif_get_uint(env, fields[1], &offset) ||
+      !enif_get_uint(env, fields[2], &size) || !enif_get_uint64(env, fields[3], &mask) ||
+      size == 0 || size > 8 || mask == 0 || (size < 8 && (mask >> (8 * size)) != 0)) {
+    return Resolve::Badarg;
+  }
+
+  const SlaveConfig *config = master.find_slave(position);
+  if (config == nullptr) return Resolve::NotConfigured;
+
+  const ImageRange &range = input ? config->inputs : config->outputs;
+  if (offset + size > range.size) return Resolve::SizeMismatch;
+
+  *out = ImageBits{config->domain, range.offset + offset, size, mask};
+  return Resolve::Ok;
+}
+
+// Shifts an entry value into the position of `mask`.
+uint64_t place(uint64_t value, uint64_t mask) { return (value << __builtin_ctzll(mask)) & mask; }
+
+// {input_bits, :== | :!=, expected, output_bits, value, latch}
+Resolve get_rule(ErlNifEnv *env, const Master &master, ERL_NIF_TERM term, ReflexRule *rule) {
+  const ERL_NIF_TERM *fields;
+  int arity;
+  ErlNifUInt64 expected, value;
+  if (!enif_get_tuple(env, term, &arity, &fields) || arity != 6 ||
+      !(enif_is_identical(fields[1], atoms.eq) || enif_is_identical(fields[1], atoms.ne)) ||
+      !enif_get_uint64(env, fields[2], &expected) || !enif_get_uint64(env, fields[4], &value) ||
+      !(enif_is_identical(fields[5], atoms.true_) || enif_is_identical(fields[5], atoms.false_))) {
+    return Resolve::Badarg;
+  }
+
+  Resolve ret = get_bits(env, master, fields[0], true, &rule->input);
+  if (ret != Resolve::Ok) return ret;
+  ret = get_bits(env, master, fields[3], false, &rule->output);
+  if (ret != Resolve::Ok) return ret;
+
+  rule->expected = place(expected, rule->input.mask);
+  rule->negate = enif_is_identical(fields[1], atoms.ne);
+  rule->value = place(value, rule->output.mask);
+  rule->latch = enif_is_identical(fields[5], atoms.true_);
+  return Resolve::Ok;
+}
+
+}  // namespace
+
+ERL_NIF_TERM set_reflexes(ErlNifEnv *env, int, const ERL_NIF_TERM argv[]) {
+  Master *master;
+  unsigned length;
+  if (!get_master(env, argv[0], &master) || !enif_get_list_length(env, argv[1], &length)) {
+    return enif_make_badarg(env);
+  }
+  if (length > Reflexes::kMaxRules) return make_error(env, atoms.too_large);
+
+  // Slave configurations only change under the lock before activation;
+  // configure_slave/2 may hold it for a while, hence a dirty scheduler.
+  std::lock_guard<std::mutex> guard(master->lock);
+  if (!master->is_open()) return make_error(env, atoms.closed);
+
+  std::vector<ReflexRule> rules(length);
+  ERL_NIF_TERM list = argv[1], head;
+  for (ReflexRule &rule : rules) {
+    enif_get_list_cell(env, list, &head, &list);
+    switch (get_rule(env, *master, head, &rule)) {
+      case Resolve::Ok:
+        break;
+      case Resolve::Badarg:
+        return enif_make_badarg(env);
+      case Resolve::NotConfigured:
+        return make_error(env, atoms.not_configured);
+      case Resolve::SizeMismatch:
+        return make_error(env, atoms.size_mismatch);
+    }
+  }
+
+  master->reflexes().set(rules);
+  return atoms.ok;
+}
+
+}  // namespace ethercat_ex
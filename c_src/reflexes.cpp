@@ -0,0 +1,87 @@
+#include "reflexes.hpp"
+
+#include <cstring>
+
+#include "notifier.hpp"
+
+namespace ethercat_ex {
+
+namespace {
+
+// EtherCAT process data is little-endian whatever the host is.
+uint64_t load(const uint8_t *data, unsigned size) {
+  uint64_t word = 0;
+  for (unsigned b = 0; b < size; ++b) word |= static_cast<uint64_t>(data[b]) << (8 * b);
+  return word;
+}
+
+}  // namespace
+
+Reflexes::Reflexes() { tables_.resize(sizeof(Table)); }
+
+void Reflexes::set(const std::vector<ReflexRule> &rules) {
+  std::lock_guard<std::mutex> guard(writer_lock_);
+
+  Table table{};
+  table.generation = ++generation_;
+  table.count = static_cast<uint32_t>(rules.size());
+  std::memcpy(table.rules, rules.data(), rules.size() * sizeof(ReflexRule));
+
+  std::memcpy(tables_.back(), &table, sizeof(Table));
+  tables_.publish();
+}
+
+void Reflexes::evaluate(const std::vector<Domain> &domains, Notifier &notifier) {
+  table_ = reinterpret_cast<const Table *>(tables_.front());
+  if (table_->generation != seen_generation_) {
+    seen_generation_ = table_->generation;
+    latched_ = 0;
+    active_ = 0;
+  }
+
+  // Validated on upload; checked again here so that a bad table can never
+  // make the thread read outside the images.
+  uint64_t matched = 0;
+  for (uint32_t i = 0; i < table_->count; ++i) {
+    const ReflexRule &rule = table_->rules[i];
+    const ImageBits &in = rule.input;
+    if (in.domain >= domains.size() || in.offset + in.size > domains[in.domain].size) continue;
+
+    const uint64_t bits = load(domains[in.domain].data + in.offset, in.size) & in.mask;
+    const uint64_t match = (bits == rule.expected) != rule.negate;
+    matched |= match << i;
+    latched_ |= (match & rule.latch) << i;
+  }
+
+  const uint64_t active = matched | latched_;
+  for (uint64_t rising = active & ~active_; rising != 0; rising &= rising - 1) {
+    Event event{};
+    event.kind = Event::Kind::Reflex;
+    event.position = static_cast<uint16_t>(__builtin_ctzll(rising));
+    notifier.post_event(event);
+  }
+  active_ = active;
+}
+
+void Reflexes::apply(unsigned index, Domain &domain, uint8_t *held_mask,
+                     uint8_t *held_value) const {
+  for (uint64_t active = active_; active != 0; active &= active - 1) {
+    const ReflexRule &rule = table_->rules[__builtin_ctzll(active)];
+    const ImageBits &out = rule.output;
+    if (out.domain != index || out.offset + out.size > domain.size) continue;
+
+    uint8_t *data = domain.data + out.offset;
+    for (unsigned b = 0; b < out.size; ++b) {
+      const uint8_t mask = static_cast<uint8_t>(out.mask >> (8 * b));
+      const uint8_t value = static_cast<uint8_t>(rule.value >> (8 * b));
+      data[b] = static_cast<uint8_t>((data[b] & ~mask) | (value & mask));
+      if (held_mask != nullptr) {
+        held_mask[out.offset + b] |= mask;
+        held_value[out.offset + b] = static_cast<uint8_t>(
+            (held_value[out.offset + b] & ~mask) | (value & mask));
+      }
+    }
+  }
+}
+
+}  // namespace ethercat_ex
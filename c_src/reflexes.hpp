@@ -0,0 +1,88 @@
+// Interlock rules evaluated by the exchange itself, without the BEAM.
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <type_traits>
+#include <vector>
+
+#include "domain.hpp"
+#include "triple_buffer.hpp"
+
+namespace ethercat_ex {
+
+class Notifier;
+
+// Up to 8 bytes of a domain image under a little-endian bit mask.
+struct ImageBits {
+  uint32_t domain;
+  uint32_t offset;
+  uint32_t size;
+  uint64_t mask;
+};
+
+// While `input` under its mask equals `expected` (or differs, with
+// `negate`), `output` under its mask is forced to `value`. A latching rule
+// keeps forcing once triggered until the table is replaced. Values are
+// already shifted into mask position.
+struct ReflexRule {
+  ImageBits input;
+  uint64_t expected;
+  bool negate;
+  ImageBits output;
+  uint64_t value;
+  bool latch;
+};
+
+// The rule table is replaced as a whole from the BEAM and reaches the
+// thread running the exchange through a triple buffer, so that thread
+// never waits for an upload. Every cycle it evaluates all rules against
+// the freshly processed inputs and, for each due domain, applies the
+// active ones to the outputs after they were copied in and before the
+// domain is queued: a matching input changes the outputs of the very next
+// frame, with no BEAM round trip. Forced bits stay forced after the rule
+// stops being active until the outputs are written again; the caller keeps
+// them in `held_mask` and `held_value` when it copies the outputs in anew
+// every cycle (see CyclicTask).
+class Reflexes {
+ public:
+  // One bit of the latch and active masks per rule.
+  static constexpr size_t kMaxRules = 64;
+
+  Reflexes();
+
+  // BEAM side, any process. Replaces the table and clears all latches.
+  // `rules.size()` must not exceed kMaxRules.
+  void set(const std::vector<ReflexRule> &rules);
+
+  // Thread running the exchange, after the inputs were processed. Posts an
+  // Event for every rule that became active.
+  void evaluate(const std::vector<Domain> &domains, Notifier &notifier);
+  // Thread running the exchange, before `domain` with index `index` is
+  // queued. Also records the forced bits in `held_mask` and `held_value`,
+  // laid out like the domain memory, unless they are null.
+  void apply(unsigned index, Domain &domain, uint8_t *held_mask = nullptr,
+             uint8_t *held_value = nullptr) const;
+
+ private:
+  struct Table {
+    uint32_t generation;
+    uint32_t count;
+    ReflexRule rules[kMaxRules];
+  };
+  static_assert(std::is_trivially_copyable<Table>::value, "published by memcpy");
+
+  TripleBuffer tables_;
+  // Uploads serialize among themselves, so the buffer sees one producer.
+  std::mutex writer_lock_;
+  uint32_t generation_ = 0;
+
+  // Owned by the thread running the exchange.
+  const Table *table_ = nullptr;
+  uint32_t seen_generation_ = 0;
+  uint64_t latched_ = 0;
+  uint64_t active_ = 0;
+};
+
+}  // namespace ethercat_ex
@@ -0,0 +1,150 @@
+#include "register_engine.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+
+#include "nif_util.hpp"
+#include "notifier.hpp"
+
+namespace ethercat_ex {
+
+namespace {
+
+int64_t monotonic_ns() {
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+}  // namespace
+
+RegisterEngine::RegisterEngine() : env_(enif_alloc_env()) {}
+
+RegisterEngine::~RegisterEngine() { enif_free_env(env_); }
+
+int RegisterEngine::add_slave(uint16_t position, ec_slave_config_t *sc, size_t capacity) {
+  ec_reg_request_t *request = ecrt_slave_config_create_reg_request(sc, capacity);
+  if (request == nullptr) return -ENOMEM;
+
+  auto it = std::lower_bound(channels_.begin(), channels_.end(), position,
+                             [](const Channel &c, uint16_t p) { return c.position < p; });
+  channels_.insert(it, Channel{position, request, capacity, false});
+  min_capacity_ = channels_.size() == 1 ? capacity : std::min(min_capacity_, capacity);
+  data_.resize(min_capacity_);
+  return 0;
+}
+
+int RegisterEngine::start(bool write, uint16_t address, size_t size, const uint8_t *data,
+                          uint32_t timeout_ms, const ErlNifPid &pid, ERL_NIF_TERM ref) {
+  if (channels_.empty()) return -ENOENT;
+  if (size > min_capacity_) return -EMSGSIZE;
+
+  uint8_t idle = Idle;
+  if (!phase_.compare_exchange_strong(idle, Filling, std::memory_order_acquire)) return -EBUSY;
+
+  write_ = write;
+  address_ = address;
+  size_ = size;
+  if (write) std::memcpy(data_.data(), data, size);
+  deadline_ns_ = monotonic_ns() + static_cast<int64_t>(timeout_ms) * 1000000;
+  pid_ = pid;
+  enif_clear_env(env_);
+  ref_ = enif_make_copy(env_, ref);
+  phase_.store(Queued, std::memory_order_release);
+  return 0;
+}
+
+void RegisterEngine::service(Notifier &notifier) {
+  switch (phase_.load(std::memory_order_acquire)) {
+    case Queued:
+      for (Channel &channel : channels_) {
+        channel.failed = false;
+        if (write_) {
+          std::memcpy(ecrt_reg_request_data(channel.request), data_.data(), size_);
+          ecrt_reg_request_write(channel.request, address_, size_);
+        } else {
+          ecrt_reg_request_read(channel.request, address_, size_);
+        }
+      }
+      pending_ = channels_.size();
+      aborted_ = false;
+      phase_.store(Busy, std::memory_order_relaxed);
+      break;
+
+    case Busy: {
+      // Requests finish in any order; each is counted once, when it leaves
+      // EC_REQUEST_BUSY. Those of slaves that are not on the bus would stay
+      // busy for good, so past the deadline they are given up as failed.
+      const bool expired = monotonic_ns() >= deadline_ns_;
+      pending_ = 0;
+      for (Channel &channel : channels_) {
+        const ec_request_state_t state = ecrt_reg_request_state(channel.request);
+        if (state == EC_REQUEST_BUSY || state == EC_REQUEST_UNUSED) {
+          if (expired) {
+            channel.failed = true;
+          } else {
+            ++pending_;
+          }
+        } else {
+          channel.failed = state != EC_REQUEST_SUCCESS;
+        }
+      }
+      if (pending_ == 0) {
+        phase_.store(Finished, std::memory_order_release);
+        notifier.wake();
+      }
+      break;
+    }
+
+    default:
+      break;
+  }
+}
+
+void RegisterEngine::report() {
+  if (phase_.load(std::memory_order_acquire) != Finished) return;
+
+  ErlNifEnv *env = message_env();
+  ERL_NIF_TERM result;
+  if (aborted_) {
+    result = make_error(env, atoms.closed);
+  } else {
+    ERL_NIF_TERM positions = enif_make_list(env, 0);
+    ERL_NIF_TERM failed = enif_make_list(env, 0);
+    ERL_NIF_TERM data;
+    uint8_t *out = enif_make_new_binary(env, write_ ? 0 : size_ * channels_.size(), &data);
+
+    // Built back to front so the lists come out in position order.
+    for (size_t i = channels_.size(); i-- > 0;) {
+      const Channel &channel = channels_[i];
+      const ERL_NIF_TERM position = enif_make_uint(env, channel.position);
+      positions = enif_make_list_cell(env, position, positions);
+      if (channel.failed) failed = enif_make_list_cell(env, position, failed);
+      if (!write_) {
+        uint8_t *slot = out + i * size_;
+        if (channel.failed) {
+          std::memset(slot, 0, size_);
+        } else {
+          std::memcpy(slot, ecrt_reg_request_data(channel.request), size_);
+        }
+      }
+    }
+    result = enif_make_tuple4(env, atoms.ok, positions, data, failed);
+  }
+
+  send_message(pid_,
+               enif_make_tuple3(env, atoms.register_done, enif_make_copy(env, ref_), result));
+  phase_.store(Idle, std::memory_order_release);
+}
+
+void RegisterEngine::abort() {
+  const uint8_t phase = phase_.load(std::memory_order_acquire);
+  if (phase == Queued || phase == Busy) {
+    aborted_ = true;
+    phase_.store(Finished, std::memory_order_release);
+  }
+}
+
+}  // namespace ethercat_ex
@@ -0,0 +1,93 @@
+// ESC register reads and writes batched across slaves, serviced by the
+// thread running the exchange.
+#pragma once
+
+#include <ecrt.h>
+#include <erl_nif.h>
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+namespace ethercat_ex {
+
+class Notifier;
+
+// One ec_reg_request_t per slave configured with a `reg_size`. A batch
+// reads or writes the same register range on all of them: the exchange
+// starts every request in the same cycle, so the master sends them side
+// by side in the acyclic datagrams of the following frames, and the
+// notifier returns the results as one binary once the last one is done.
+// One batch runs at a time per master.
+//
+//   Idle -start-> Filling -> Queued -> Busy -> Finished -> Idle
+//
+// Filling belongs to the BEAM, Queued and Busy to the exchange and
+// Finished to the notifier. Each hand-over is a release store of `phase_`.
+class RegisterEngine {
+ public:
+  RegisterEngine();
+  ~RegisterEngine();
+
+  RegisterEngine(const RegisterEngine &) = delete;
+  RegisterEngine &operator=(const RegisterEngine &) = delete;
+
+  // Configuration phase only. Slaves may be added in any order.
+  int add_slave(uint16_t position, ec_slave_config_t *sc, size_t capacity);
+
+  // BEAM side, on an active master. Reads `size` bytes from `address` of
+  // every slave, or writes `data` there when `write` is set. Returns 0,
+  // -ENOENT without slaves, -EMSGSIZE past the smallest request and -EBUSY
+  // while another batch is in flight.
+  //
+  // libethercat only serves the request of a slave that is on the bus, so
+  // a request still busy `timeout_ms` after the batch started counts as
+  // failed and the batch finishes without it.
+  //
+  // `pid` later receives {:register_done, ref, {:ok, positions, data,
+  // failed}} with the slaves in ascending position order, `data` holding
+  // `size` bytes per slave in that order (nothing for a write) and `failed`
+  // listing the positions whose request failed, or {:register_done, ref,
+  // {:error, :closed}}.
+  int start(bool write, uint16_t address, size_t size, const uint8_t *data,
+            uint32_t timeout_ms, const ErlNifPid &pid, ERL_NIF_TERM ref);
+
+  // Thread running the exchange, once per cycle.
+  void service(Notifier &notifier);
+  // Notifier thread, on every wake-up.
+  void report();
+  // After the exchange has stopped: fails a batch that has not finished.
+  void abort();
+
+ private:
+  enum Phase : uint8_t { Idle, Filling, Queued, Busy, Finished };
+
+  struct Channel {
+    uint16_t position;
+    ec_reg_request_t *request;
+    size_t capacity;
+    bool failed;
+  };
+
+  // Sorted by position.
+  std::vector<Channel> channels_;
+  size_t min_capacity_ = 0;
+  std::atomic<uint8_t> phase_{Idle};
+
+  // Set by the BEAM before Queued. `data_` is sized at configuration.
+  bool write_ = false;
+  uint16_t address_ = 0;
+  size_t size_ = 0;
+  std::vector<uint8_t> data_;
+  // CLOCK_MONOTONIC, in ns.
+  int64_t deadline_ns_ = 0;
+  ErlNifPid pid_{};
+  ErlNifEnv *env_;
+  ERL_NIF_TERM ref_ = 0;
+
+  // Set by the exchange while Busy.
+  size_t pending_ = 0;
+  bool aborted_ = false;
+};
+
+}  // namespace ethercat_ex
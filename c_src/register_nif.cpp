@@ -0,0 +1,71 @@
+// ESC register batches on an active master; see RegisterEngine.
+//
+// register_read/5 and register_write/5 return :ok once the batch is
+// queued; the caller then receives {:register_done, ref, result}.
+#include <cerrno>
+#include <cstdint>
+
+#include "nif_util.hpp"
+#include "nifs.hpp"
+#include "resources.hpp"
+
+namespace ethercat_ex {
+
+namespace {
+
+ERL_NIF_TERM start_batch(ErlNifEnv *env, Master *master, bool write, uint16_t address,
+                         size_t size, const uint8_t *data, uint32_t timeout_ms,
+                         ERL_NIF_TERM ref) {
+  ErlNifPid pid;
+  enif_self(env, &pid);
+
+  // RegisterEngine takes a batch atomically, so a pin is enough.
+  const MasterPin pin(*master);
+  if (!pin) return make_error(env, atoms.closed);
+  if (!master->is_active()) return make_error(env, atoms.not_active);
+
+  const int ret = master->registers().start(write, address, size, data, timeout_ms, pid, ref);
+  switch (ret) {
+    case 0:
+      return atoms.ok;
+    case -ENOENT:
+      return make_error(env, atoms.not_configured);
+    case -EBUSY:
+      return make_error(env, atoms.busy);
+    case -EMSGSIZE:
+      return make_error(env, atoms.too_large);
+    default:
+      return make_errno_error(env, ret);
+  }
+}
+
+}  // namespace
+
+// argv: master, address, size, timeout_ms, ref
+ERL_NIF_TERM register_read(ErlNifEnv *env, int, const ERL_NIF_TERM argv[]) {
+  Master *master;
+  uint16_t address;
+  unsigned size, timeout_ms;
+  if (!get_master(env, argv[0], &master) || !get_u16(env, argv[1], &address) ||
+      !enif_get_uint(env, argv[2], &size) || size == 0 ||
+      !enif_get_uint(env, argv[3], &timeout_ms) || !enif_is_ref(env, argv[4])) {
+    return enif_make_badarg(env);
+  }
+  return start_batch(env, master, false, address, size, nullptr, timeout_ms, argv[4]);
+}
+
+// argv: master, address, data, timeout_ms, ref
+ERL_NIF_TERM register_write(ErlNifEnv *env, int, const ERL_NIF_TERM argv[]) {
+  Master *master;
+  uint16_t address;
+  ErlNifBinary data;
+  unsigned timeout_ms;
+  if (!get_master(env, argv[0], &master) || !get_u16(env, argv[1], &address) ||
+      !enif_inspect_binary(env, argv[2], &data) || data.size == 0 ||
+      !enif_get_uint(env, argv[3], &timeout_ms) || !enif_is_ref(env, argv[4])) {
+    return enif_make_badarg(env);
+  }
+  return start_batch(env, master, true, address, data.size, data.data, timeout_ms, argv[4]);
+}
+
+}  // namespace ethercat_ex
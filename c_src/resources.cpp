@@ -0,0 +1,39 @@
+#include "resources.hpp"
+
+#include <new>
+
+namespace ethercat_ex {
+
+ErlNifResourceType *master_type = nullptr;
+ErlNifResourceType *plan_type = nullptr;
+
+namespace {
+
+void master_dtor(ErlNifEnv *, void *obj) {
+  static_cast<MasterResource *>(obj)->~MasterResource();
+}
+
+void plan_dtor(ErlNifEnv *, void *obj) { static_cast<PlanResource *>(obj)->~PlanResource(); }
+
+}  // namespace
+
+int open_resource_types(ErlNifEnv *env) {
+  master_type = enif_open_resource_type(env, nullptr, "ethercat_master", master_dtor,
+                                        ERL_NIF_RT_CREATE, nullptr);
+  plan_type = enif_open_resource_type(env, nullptr, "ethercat_convert_plan", plan_dtor,
+                                      ERL_NIF_RT_CREATE, nullptr);
+  return master_type != nullptr && plan_type != nullptr ? 0 : -1;
+}
+
+bool get_master_resource(ErlNifEnv *env, ERL_NIF_TERM term, MasterResource **out) {
+  return enif_get_resource(env, term, master_type, reinterpret_cast<void **>(out));
+}
+
+bool get_master(ErlNifEnv *env, ERL_NIF_TERM term, Master **out) {
+  MasterResource *res;
+  if (!get_master_resource(env, term, &res)) return false;
+  *out = &res->master;
+  return true;
+}
+
+}  // namespace ethercat_ex
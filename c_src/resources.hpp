@@ -0,0 +1,29 @@
+// NIF resource types shared by the entry point files.
+#pragma once
+
+#include <erl_nif.h>
+
+#include "convert.hpp"
+#include "master.hpp"
+
+namespace ethercat_ex {
+
+struct MasterResource {
+  Master master;
+};
+
+// A prepared ConvertPlan; immutable once returned to Elixir, so any number
+// of processes can run it at once.
+struct PlanResource {
+  ConvertPlan plan;
+};
+
+extern ErlNifResourceType *master_type;
+extern ErlNifResourceType *plan_type;
+
+int open_resource_types(ErlNifEnv *env);
+
+bool get_master(ErlNifEnv *env, ERL_NIF_TERM term, Master **out);
+bool get_master_resource(ErlNifEnv *env, ERL_NIF_TERM term, MasterResource **out);
+
+}  // namespace ethercat_ex
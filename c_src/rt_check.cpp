@@ -0,0 +1,57 @@
+#include "rt_check.hpp"
+
+#ifdef ETHERCAT_EX_RT_CHECKS
+
+#include <unistd.h>
+
+#include <cstdlib>
+#include <new>
+
+namespace ethercat_ex {
+
+namespace {
+
+thread_local bool rt_context = false;
+
+void check(const char *what) {
+  if (!rt_context) return;
+  // Nothing here may allocate, so the message is written as is.
+  static const char prefix[] = "ethercat_ex: ";
+  static const char suffix[] = " on the cyclic thread\n";
+  ssize_t ignored = write(STDERR_FILENO, prefix, sizeof(prefix) - 1);
+  for (const char *p = what; *p != '\0'; ++p) ignored = write(STDERR_FILENO, p, 1);
+  ignored = write(STDERR_FILENO, suffix, sizeof(suffix) - 1);
+  (void)ignored;
+  std::abort();
+}
+
+void *allocate(size_t size) {
+  check("operator new");
+  void *p = std::malloc(size == 0 ? 1 : size);
+  if (p == nullptr) throw std::bad_alloc();
+  return p;
+}
+
+void release(void *p) {
+  if (p != nullptr) check("operator delete");
+  std::free(p);
+}
+
+}  // namespace
+
+RtScope::RtScope() { rt_context = true; }
+
+RtScope::~RtScope() { rt_context = false; }
+
+}  // namespace ethercat_ex
+
+// Replace the global allocation functions; threads not marked by RtScope
+// only pay for the check of a thread-local flag.
+void *operator new(size_t size) { return ethercat_ex::allocate(size); }
+void *operator new[](size_t size) { return ethercat_ex::allocate(size); }
+void operator delete(void *p) noexcept { ethercat_ex::release(p); }
+void operator delete[](void *p) noexcept { ethercat_ex::release(p); }
+void operator delete(void *p, size_t) noexcept { ethercat_ex::release(p); }
+void operator delete[](void *p, size_t) noexcept { ethercat_ex::release(p); }
+
+#endif
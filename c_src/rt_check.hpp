@@ -0,0 +1,33 @@
+// Debug check that the cyclic thread never allocates.
+#pragma once
+
+namespace ethercat_ex {
+
+#ifdef ETHERCAT_EX_RT_CHECKS
+
+// Marks the calling thread as real-time while in scope. Built with
+// ETHERCAT_RT_CHECKS=1, operator new and delete abort the VM with a message
+// when called from a marked thread. Only allocations made by the NIF's own
+// C++ code are seen; libethercat's are not.
+class RtScope {
+ public:
+  RtScope();
+  ~RtScope();
+
+  RtScope(const RtScope &) = delete;
+  RtScope &operator=(const RtScope &) = delete;
+};
+
+#else
+
+class RtScope {
+ public:
+  // User-provided so that an otherwise unused scope draws no warning.
+  RtScope() {}
+  RtScope(const RtScope &) = delete;
+  RtScope &operator=(const RtScope &) = delete;
+};
+
+#endif
+
+}  // namespace ethercat_ex
@@ -0,0 +1,159 @@
+#include "sdo_engine.hpp"
+
+#include <cerrno>
+#include <cstring>
+
+#include "nif_util.hpp"
+
+// ecrt_sdo_request_write_with_size() came with the 1.6 interface. Before
+// it, a download always sends the size the request was created with.
+#if defined(ECRT_VERSION_MAGIC) && ECRT_VERSION_MAGIC >= ECRT_VERSION(1, 6)
+#define ETHERCAT_EX_SDO_WRITE_WITH_SIZE
+#endif
+
+namespace ethercat_ex {
+
+SdoJob::SdoJob(Kind kind, uint16_t index, uint8_t subindex, uint32_t timeout_ms, ErlNifPid pid,
+               ERL_NIF_TERM ref, const uint8_t *data, size_t size)
+    : kind(kind),
+      index(index),
+      subindex(subindex),
+      timeout_ms(timeout_ms),
+      data(data, data + size),
+      env_(enif_alloc_env()),
+      pid_(pid) {
+  ref_ = enif_make_copy(env_, ref);
+}
+
+SdoJob::~SdoJob() { enif_free_env(env_); }
+
+void SdoJob::fail(ERL_NIF_TERM reason) {
+  failed_ = true;
+  failure_ = reason;
+}
+
+void SdoJob::deliver() {
+  ERL_NIF_TERM result;
+  if (failed_) {
+    result = make_error(env_, failure_);
+  } else if (state != EC_REQUEST_SUCCESS) {
+    result = make_error(
+        env_, enif_make_tuple2(env_, atoms.sdo_failed, enif_make_uint(env_, abort_code)));
+  } else if (kind == Kind::Write) {
+    result = atoms.ok;
+  } else {
+    const size_t size = ecrt_sdo_request_data_size(slot->request);
+    ERL_NIF_TERM value;
+    std::memcpy(enif_make_new_binary(env_, size, &value), ecrt_sdo_request_data(slot->request),
+                size);
+    result = make_ok(env_, value);
+  }
+
+  if (slot != nullptr) slot->available.store(true, std::memory_order_release);
+
+  enif_send(nullptr, &pid_, env_, enif_make_tuple3(env_, atoms.sdo_done, ref_, result));
+}
+
+int SdoEngine::add_slave(uint16_t position, ec_slave_config_t *sc, unsigned count,
+                         size_t capacity) {
+  std::unique_ptr<Channel> channel(new Channel());
+  for (unsigned i = 0; i < count; ++i) {
+    ec_sdo_request_t *request = ecrt_slave_config_create_sdo_request(sc, 0, 0, capacity);
+    if (request == nullptr) return -ENOMEM;
+    channel->slots.emplace_back(new SdoSlot(request, capacity));
+  }
+  channels_[position] = std::move(channel);
+  return 0;
+}
+
+int SdoEngine::submit(uint16_t position, SdoJob *job) {
+  auto it = channels_.find(position);
+  if (it == channels_.end() || it->second->slots.empty()) return -ENOENT;
+
+  Channel &channel = *it->second;
+  if (job->kind == SdoJob::Kind::Write) {
+    const size_t capacity = channel.slots.front()->capacity;
+#ifdef ETHERCAT_EX_SDO_WRITE_WITH_SIZE
+    if (job->data.size() > capacity) return -EMSGSIZE;
+#else
+    if (job->data.size() != capacity) return -EMSGSIZE;
+#endif
+  }
+
+  std::lock_guard<std::mutex> guard(channel.producer_lock);
+  return channel.queue.push(job) ? 0 : -EAGAIN;
+}
+
+void SdoEngine::service(Notifier &notifier) {
+  for (auto &entry : channels_) {
+    Channel &channel = *entry.second;
+
+    for (auto &slot_ptr : channel.slots) {
+      SdoSlot &slot = *slot_ptr;
+
+      if (slot.job != nullptr) {
+        const ec_request_state_t state = ecrt_sdo_request_state(slot.request);
+        if (state == EC_REQUEST_BUSY || state == EC_REQUEST_UNUSED) continue;
+
+        slot.job->slot = &slot;
+        slot.job->state = state;
+#ifdef ETHERCAT_EX_SDO_ABORT_CODE
+        if (state == EC_REQUEST_ERROR) {
+          slot.job->abort_code = ecrt_sdo_request_abort_code(slot.request);
+        }
+#endif
+        // Should the notifier ring be full, retry on the next cycle.
+        if (!notifier.post(slot.job)) continue;
+        slot.job = nullptr;
+      }
+
+      SdoJob *job;
+      if (slot.available.load(std::memory_order_acquire) && channel.queue.pop(job)) {
+        start(slot, job);
+      }
+    }
+  }
+}
+
+void SdoEngine::start(SdoSlot &slot, SdoJob *job) {
+  slot.available.store(false, std::memory_order_relaxed);
+  slot.job = job;
+
+  ecrt_sdo_request_index(slot.request, job->index, job->subindex);
+  ecrt_sdo_request_timeout(slot.request, job->timeout_ms);
+
+  if (job->kind == SdoJob::Kind::Write) {
+    std::memcpy(ecrt_sdo_request_data(slot.request), job->data.data(), job->data.size());
+#ifdef ETHERCAT_EX_SDO_WRITE_WITH_SIZE
+    ecrt_sdo_request_write_with_size(slot.request, job->data.size());
+#else
+    ecrt_sdo_request_write(slot.request);
+#endif
+  } else {
+    ecrt_sdo_request_read(slot.request);
+  }
+}
+
+void SdoEngine::abort(Notifier &notifier) {
+  for (auto &entry : channels_) {
+    Channel &channel = *entry.second;
+    std::vector<SdoJob *> jobs;
+
+    for (auto &slot : channel.slots) {
+      if (slot->job != nullptr) jobs.push_back(slot->job);
+      slot->job = nullptr;
+    }
+    SdoJob *job;
+    while (channel.queue.pop(job)) jobs.push_back(job);
+
+    for (SdoJob *failed : jobs) {
+      failed->fail(atoms.closed);
+      if (!notifier.post(failed)) {
+        failed->deliver();
+        delete failed;
+      }
+    }
+  }
+}
+
+}  // namespace ethercat_ex
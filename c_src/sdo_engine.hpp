@@ -0,0 +1,102 @@
+// Asynchronous SDO transfers serviced by the thread running the exchange.
+#pragma once
+
+#include <ecrt.h>
+#include <erl_nif.h>
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "notifier.hpp"
+#include "spsc_queue.hpp"
+
+namespace ethercat_ex {
+
+class SdoSlot;
+
+// One upload or download requested from Elixir. Created on a scheduler
+// thread, which also copies the caller's reference into the job's own env;
+// the cyclic thread only moves the pointer around, and the notifier thread
+// sends `{:sdo_done, ref, result}` and frees it.
+class SdoJob : public Message {
+ public:
+  enum class Kind { Read, Write };
+
+  SdoJob(Kind kind, uint16_t index, uint8_t subindex, uint32_t timeout_ms, ErlNifPid pid,
+         ERL_NIF_TERM ref, const uint8_t *data, size_t size);
+  ~SdoJob() override;
+
+  void deliver() override;
+  // Completes the job without touching the bus (e.g. on shutdown).
+  void fail(ERL_NIF_TERM reason);
+
+  Kind kind;
+  uint16_t index;
+  uint8_t subindex;
+  uint32_t timeout_ms;
+  std::vector<uint8_t> data;
+
+  // Set by the cyclic thread when the request finishes. The abort code is
+  // only known when built with ETHERCAT_SDO_ABORT_CODE=1, for masters whose
+  // ecrt.h has ecrt_sdo_request_abort_code(); it stays 0 otherwise.
+  SdoSlot *slot = nullptr;
+  ec_request_state_t state = EC_REQUEST_UNUSED;
+  uint32_t abort_code = 0;
+
+ private:
+  ErlNifEnv *env_;
+  ERL_NIF_TERM ref_;
+  bool failed_ = false;
+  ERL_NIF_TERM failure_;
+  ErlNifPid pid_;
+};
+
+// An ec_sdo_request_t created for a slave before activation. A finished
+// slot stays reserved until the notifier has copied the uploaded data out
+// of it, so the cyclic thread never overwrites a result not yet delivered.
+class SdoSlot {
+ public:
+  SdoSlot(ec_sdo_request_t *request, size_t capacity) : request(request), capacity(capacity) {}
+
+  ec_sdo_request_t *const request;
+  const size_t capacity;
+  SdoJob *job = nullptr;
+  std::atomic<bool> available{true};
+};
+
+class SdoEngine {
+ public:
+  // Configuration phase only. Creates `count` requests of `capacity` bytes.
+  int add_slave(uint16_t position, ec_slave_config_t *sc, unsigned count, size_t capacity);
+
+  // Any scheduler thread. Takes ownership of `job` on success; returns
+  // -ENOENT for a slave without SDO requests, -EMSGSIZE for a download
+  // larger than its requests (or, before the 1.6 interface, of another
+  // size) and -EAGAIN while the slave's queue is full.
+  int submit(uint16_t position, SdoJob *job);
+
+  // Thread running the exchange, once per cycle: hands finished requests to
+  // `notifier` and starts queued jobs on idle requests.
+  void service(Notifier &notifier);
+
+  // After the exchange has stopped: fails every queued or running job.
+  void abort(Notifier &notifier);
+
+ private:
+  struct Channel {
+    std::vector<std::unique_ptr<SdoSlot>> slots;
+    SpscQueue<SdoJob *, 256> queue;
+    // Serializes producers so that the queue sees a single one.
+    std::mutex producer_lock;
+  };
+
+  void start(SdoSlot &slot, SdoJob *job);
+
+  std::map<uint16_t, std::unique_ptr<Channel>> channels_;
+};
+
+}  // namespace ethercat_ex
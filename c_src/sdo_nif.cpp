@@ -0,0 +1,88 @@
+// Acyclic SDO transfers on an active master.
+//
+// Both NIFs only queue the transfer and return at once; the thread running
+// the exchange drives the request and the caller later receives
+// `{:sdo_done, ref, result}`. Requests are taken from the ones created by
+// configure_slave/2, so the number of transfers in flight per slave is
+// bounded by its `:sdo_requests`.
+#include <cerrno>
+#include <cstdint>
+
+#include "nif_util.hpp"
+#include "nifs.hpp"
+#include "resources.hpp"
+
+namespace ethercat_ex {
+
+namespace {
+
+struct SdoArgs {
+  uint16_t position;
+  uint16_t index;
+  uint8_t subindex;
+  unsigned timeout_ms;
+};
+
+bool get_sdo_args(ErlNifEnv *env, const ERL_NIF_TERM argv[], MasterResource **res,
+                  SdoArgs *args) {
+  return get_master_resource(env, argv[0], res) && get_u16(env, argv[1], &args->position) &&
+         get_u16(env, argv[2], &args->index) && get_u8(env, argv[3], &args->subindex);
+}
+
+ERL_NIF_TERM submit(ErlNifEnv *env, MasterResource *res, const SdoArgs &args,
+                    SdoJob::Kind kind, const ErlNifBinary *data, ERL_NIF_TERM ref) {
+  ErlNifPid pid;
+  enif_self(env, &pid);
+
+  Master &master = res->master;
+  if (!master.pin()) return make_error(env, atoms.closed);
+
+  SdoJob *job = new SdoJob(kind, args.index, args.subindex, args.timeout_ms, pid, ref,
+                           data != nullptr ? data->data : nullptr,
+                           data != nullptr ? data->size : 0);
+  const int ret = master.submit_sdo(args.position, job);
+  master.unpin();
+
+  if (ret == 0) return atoms.ok;
+  delete job;
+  switch (ret) {
+    case -EPERM:
+      return make_error(env, atoms.not_active);
+    case -ENOENT:
+      return make_error(env, atoms.not_configured);
+    case -EMSGSIZE:
+      return make_error(env, atoms.too_large);
+    case -EAGAIN:
+      return make_error(env, atoms.queue_full);
+    default:
+      return make_errno_error(env, ret);
+  }
+}
+
+}  // namespace
+
+// sdo_read(master, position, index, subindex, timeout_ms, ref)
+ERL_NIF_TERM sdo_read(ErlNifEnv *env, int, const ERL_NIF_TERM argv[]) {
+  MasterResource *res;
+  SdoArgs args;
+  if (!get_sdo_args(env, argv, &res, &args) || !enif_get_uint(env, argv[4], &args.timeout_ms) ||
+      !enif_is_ref(env, argv[5])) {
+    return enif_make_badarg(env);
+  }
+  return submit(env, res, args, SdoJob::Kind::Read, nullptr, argv[5]);
+}
+
+// sdo_write(master, position, index, subindex, data, timeout_ms, ref)
+ERL_NIF_TERM sdo_write(ErlNifEnv *env, int, const ERL_NIF_TERM argv[]) {
+  MasterResource *res;
+  SdoArgs args;
+  ErlNifBinary data;
+  if (!get_sdo_args(env, argv, &res, &args) ||
+      !enif_inspect_iolist_as_binary(env, argv[4], &data) ||
+      !enif_get_uint(env, argv[5], &args.timeout_ms) || !enif_is_ref(env, argv[6])) {
+    return enif_make_badarg(env);
+  }
+  return submit(env, res, args, SdoJob::Kind::Write, &data, argv[6]);
+}
+
+}  // namespace ethercat_ex
@@ -0,0 +1,73 @@
+#include "state_watch.hpp"
+
+namespace ethercat_ex {
+
+namespace {
+
+bool same(const ec_domain_state_t &a, const ec_domain_state_t &b) {
+  return a.working_counter == b.working_counter && a.wc_state == b.wc_state;
+}
+
+bool same(const ec_master_state_t &a, const ec_master_state_t &b) {
+  return a.slaves_responding == b.slaves_responding && a.al_states == b.al_states &&
+         a.link_up == b.link_up;
+}
+
+bool same(const ec_slave_config_state_t &a, const ec_slave_config_state_t &b) {
+  return a.online == b.online && a.operational == b.operational && a.al_state == b.al_state;
+}
+
+}  // namespace
+
+void StateWatch::add_domain() { domains_.push_back(DomainState{{}, false}); }
+
+void StateWatch::add_slave(uint16_t position, ec_slave_config_t *sc) {
+  slaves_.push_back(Slave{position, sc, {}, false});
+}
+
+void StateWatch::check_domain(unsigned index, const ec_domain_state_t &state,
+                              Notifier &notifier) {
+  DomainState &domain = domains_[index];
+  // The first check only records where the bus starts from.
+  if (domain.known && !same(state, domain.state)) {
+    Event event{};
+    event.kind = Event::Kind::Domain;
+    event.position = static_cast<uint16_t>(index);
+    event.domain = state;
+    notifier.post_event(event);
+  }
+  domain.known = true;
+  domain.state = state;
+}
+
+void StateWatch::check(ec_master_t *master, Notifier &notifier) {
+  ec_master_state_t master_state;
+  if (ecrt_master_state(master, &master_state) < 0) return;
+
+  if (known_ && !same(master_state, master_)) {
+    Event event{};
+    event.kind = Event::Kind::Master;
+    event.master = master_state;
+    notifier.post_event(event);
+  }
+  known_ = true;
+  master_ = master_state;
+
+  if (slaves_.empty()) return;
+  Slave &slave = slaves_[next_slave_];
+  next_slave_ = (next_slave_ + 1) % slaves_.size();
+
+  ec_slave_config_state_t state;
+  if (ecrt_slave_config_state(slave.sc, &state) < 0) return;
+  if (slave.known && !same(state, slave.state)) {
+    Event event{};
+    event.kind = Event::Kind::Slave;
+    event.position = slave.position;
+    event.slave = state;
+    notifier.post_event(event);
+  }
+  slave.known = true;
+  slave.state = state;
+}
+
+}  // namespace ethercat_ex
@@ -0,0 +1,50 @@
+// Detects bus state changes between cycles.
+#pragma once
+
+#include <ecrt.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "notifier.hpp"
+
+namespace ethercat_ex {
+
+// Compares the domain, master and slave configuration states with the
+// previous cycle and posts an Event for each one that changed. Domain
+// states are checked whenever the domain is processed and the master state
+// every cycle; slave configurations, one ioctl each, are checked
+// round-robin, one per cycle, so a large bus does not lengthen the cycle.
+class StateWatch {
+ public:
+  // Configuration phase only.
+  void add_domain();
+  void add_slave(uint16_t position, ec_slave_config_t *sc);
+
+  // Thread running the exchange, after domain `index` has been processed.
+  void check_domain(unsigned index, const ec_domain_state_t &state, Notifier &notifier);
+  // Thread running the exchange, once per cycle.
+  void check(ec_master_t *master, Notifier &notifier);
+
+ private:
+  struct Slave {
+    uint16_t position;
+    ec_slave_config_t *sc;
+    ec_slave_config_state_t state;
+    bool known;
+  };
+
+  struct DomainState {
+    ec_domain_state_t state;
+    bool known;
+  };
+
+  std::vector<DomainState> domains_;
+  std::vector<Slave> slaves_;
+  size_t next_slave_ = 0;
+  bool known_ = false;
+  ec_master_state_t master_{};
+};
+
+}  // namespace ethercat_ex
@@ -0,0 +1,35 @@
+// Delta-compressed process image stream of an active master; see DeltaStream.
+#include "nif_util.hpp"
+#include "nifs.hpp"
+#include "resources.hpp"
+
+namespace ethercat_ex {
+
+// argv: master, pid, frames per batch
+ERL_NIF_TERM stream_start(ErlNifEnv *env, int, const ERL_NIF_TERM argv[]) {
+  Master *master;
+  ErlNifPid pid;
+  unsigned batch;
+  if (!get_master(env, argv[0], &master) || !enif_get_local_pid(env, argv[1], &pid) ||
+      !enif_get_uint(env, argv[2], &batch) || batch == 0 || batch > DeltaStream::kSlots) {
+    return enif_make_badarg(env);
+  }
+
+  std::lock_guard<std::mutex> guard(master->lock);
+  if (!master->is_open()) return make_error(env, atoms.closed);
+  if (!master->is_active()) return make_error(env, atoms.not_active);
+
+  master->stream().start(pid, batch, master->domains());
+  return atoms.ok;
+}
+
+ERL_NIF_TERM stream_stop(ErlNifEnv *env, int, const ERL_NIF_TERM argv[]) {
+  Master *master;
+  if (!get_master(env, argv[0], &master)) return enif_make_badarg(env);
+
+  std::lock_guard<std::mutex> guard(master->lock);
+  master->stream().stop();
+  return atoms.ok;
+}
+
+}  // namespace ethercat_ex
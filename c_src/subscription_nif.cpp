@@ -0,0 +1,59 @@
+// Change-of-state subscriptions on slave inputs.
+//
+// A subscription names a masked region of up to 8 bytes of a configured
+// slave's inputs. The thread running the exchange compares it after every
+// processed frame and the subscriber receives
+// `{:pdo_changed, position, tag, value}` only when a bit under the mask
+// changed, instead of polling read_pdo/2.
+#include <cerrno>
+#include <cstdint>
+
+#include "nif_util.hpp"
+#include "nifs.hpp"
+#include "resources.hpp"
+
+namespace ethercat_ex {
+
+// argv: master, pid, position, offset (bytes into the slave's inputs),
+//       size (1..8 bytes), mask (little-endian, non-zero), tag
+ERL_NIF_TERM subscribe_pdo(ErlNifEnv *env, int, const ERL_NIF_TERM argv[]) {
+  Master *master;
+  ErlNifPid pid;
+  uint16_t position;
+  unsigned offset, size;
+  ErlNifUInt64 mask;
+  if (!get_master(env, argv[0], &master) || !enif_get_local_pid(env, argv[1], &pid) ||
+      !get_u16(env, argv[2], &position) || !enif_get_uint(env, argv[3], &offset) ||
+      !enif_get_uint(env, argv[4], &size) || !enif_get_uint64(env, argv[5], &mask) ||
+      size == 0 || size > 8 || mask == 0 || (size < 8 && (mask >> (8 * size)) != 0)) {
+    return enif_make_badarg(env);
+  }
+
+  // Slave configurations only change under the lock before activation;
+  // configure_slave/2 may hold it for a while, hence a dirty scheduler.
+  std::lock_guard<std::mutex> guard(master->lock);
+  if (!master->is_open()) return make_error(env, atoms.closed);
+
+  const SlaveConfig *config = master->find_slave(position);
+  if (config == nullptr) return make_error(env, atoms.not_configured);
+  if (offset + size > config->inputs.size) return make_error(env, atoms.size_mismatch);
+
+  uint64_t id;
+  const int ret = master->subscriptions().add(pid, position, argv[6], config->domain,
+                                              config->inputs.offset + offset, size, mask, &id);
+  if (ret == -ENOSPC) return make_error(env, atoms.too_many_subscriptions);
+  return make_ok(env, enif_make_uint64(env, id));
+}
+
+ERL_NIF_TERM unsubscribe_pdo(ErlNifEnv *env, int, const ERL_NIF_TERM argv[]) {
+  Master *master;
+  ErlNifUInt64 id;
+  if (!get_master(env, argv[0], &master) || !enif_get_uint64(env, argv[1], &id)) {
+    return enif_make_badarg(env);
+  }
+
+  master->subscriptions().remove(id);
+  return atoms.ok;
+}
+
+}  // namespace ethercat_ex
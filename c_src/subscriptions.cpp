@@ -0,0 +1,121 @@
+#include "subscriptions.hpp"
+
+#include <cerrno>
+
+#include "nif_util.hpp"
+#include "notifier.hpp"
+
+namespace ethercat_ex {
+
+namespace {
+
+// The low 16 bits are the slot, the rest its generation.
+uint64_t make_id(size_t slot, uint32_t generation) {
+  return static_cast<uint64_t>(generation) << 16 | slot;
+}
+
+}  // namespace
+
+Subscriptions::~Subscriptions() {
+  for (Owner &owner : owners_) {
+    if (owner.env != nullptr) enif_free_env(owner.env);
+  }
+}
+
+int Subscriptions::add(const ErlNifPid &pid, uint16_t position, ERL_NIF_TERM tag,
+                       unsigned domain, unsigned offset, unsigned size, uint64_t mask,
+                       uint64_t *out) {
+  std::lock_guard<std::mutex> guard(lock_);
+
+  size_t slot = 0;
+  while (slot < kMaxSlots && (slots_[slot].generation.load(std::memory_order_relaxed) & 1)) {
+    ++slot;
+  }
+  if (slot == kMaxSlots) return -ENOSPC;
+
+  Owner &owner = owners_[slot];
+  owner.pid = pid;
+  owner.position = position;
+  owner.env = enif_alloc_env();
+  owner.tag = enif_make_copy(owner.env, tag);
+
+  Slot &s = slots_[slot];
+  s.domain.store(domain, std::memory_order_relaxed);
+  s.offset.store(offset, std::memory_order_relaxed);
+  s.size.store(size, std::memory_order_relaxed);
+  s.mask.store(mask, std::memory_order_relaxed);
+  const uint32_t generation = s.generation.load(std::memory_order_relaxed) + 1;
+  s.generation.store(generation, std::memory_order_release);
+
+  if (slot >= used_.load(std::memory_order_relaxed)) {
+    used_.store(slot + 1, std::memory_order_release);
+  }
+  *out = make_id(slot, generation);
+  return 0;
+}
+
+bool Subscriptions::remove(uint64_t id) {
+  const size_t slot = id & 0xffff;
+  if (slot >= kMaxSlots) return false;
+
+  std::lock_guard<std::mutex> guard(lock_);
+  const uint32_t generation = slots_[slot].generation.load(std::memory_order_relaxed);
+  if (!(generation & 1) || make_id(slot, generation) != id) return false;
+  release(slot);
+  return true;
+}
+
+void Subscriptions::release(size_t slot) {
+  Slot &s = slots_[slot];
+  s.generation.store(s.generation.load(std::memory_order_relaxed) + 1,
+                     std::memory_order_release);
+  enif_free_env(owners_[slot].env);
+  owners_[slot].env = nullptr;
+}
+
+void Subscriptions::check(const std::vector<Domain> &domains, Notifier &notifier) {
+  const size_t used = used_.load(std::memory_order_acquire);
+  for (size_t i = 0; i < used; ++i) {
+    Slot &slot = slots_[i];
+    const uint32_t generation = slot.generation.load(std::memory_order_acquire);
+    if (!(generation & 1)) continue;
+
+    const unsigned domain = slot.domain.load(std::memory_order_relaxed);
+    const unsigned offset = slot.offset.load(std::memory_order_relaxed);
+    const unsigned size = slot.size.load(std::memory_order_relaxed);
+    const uint64_t mask = slot.mask.load(std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (slot.generation.load(std::memory_order_relaxed) != generation) continue;
+    if (domain >= domains.size() || offset + size > domains[domain].size) continue;
+
+    // EtherCAT process data is little-endian whatever the host is.
+    const uint8_t *data = domains[domain].data + offset;
+    uint64_t word = 0;
+    for (unsigned b = 0; b < size; ++b) word |= static_cast<uint64_t>(data[b]) << (8 * b);
+    const uint64_t value = word & mask;
+
+    Seen &seen = seen_[i];
+    if (seen.generation == generation && (seen.value ^ value) == 0) continue;
+
+    // A full ring keeps the edge pending for the next cycle.
+    const PdoChange change{static_cast<uint16_t>(i), generation,
+                           value >> __builtin_ctzll(mask)};
+    if (notifier.post_change(change)) seen = Seen{generation, value};
+  }
+}
+
+void Subscriptions::deliver(const PdoChange &change) {
+  std::lock_guard<std::mutex> guard(lock_);
+  if (slots_[change.slot].generation.load(std::memory_order_relaxed) != change.generation) {
+    return;
+  }
+
+  const Owner &owner = owners_[change.slot];
+  ErlNifEnv *env = message_env();
+  const ERL_NIF_TERM message =
+      enif_make_tuple4(env, atoms.pdo_changed, enif_make_uint(env, owner.position),
+                       enif_make_copy(env, owner.tag), enif_make_uint64(env, change.value));
+  if (!send_message(owner.pid, message)) release(change.slot);
+}
+
+}  // namespace ethercat_ex
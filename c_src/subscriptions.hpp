@@ -0,0 +1,99 @@
+// Change-of-state subscriptions on masked regions of slave inputs.
+#pragma once
+
+#include <erl_nif.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+#include "domain.hpp"
+
+namespace ethercat_ex {
+
+class Notifier;
+
+// A subscribed region that changed, with the masked bits shifted down to
+// bit 0. Queued by value like Event.
+struct PdoChange {
+  uint16_t slot;
+  uint32_t generation;
+  uint64_t value;
+};
+
+// Fixed table of up to kMaxSlots regions of at most 8 bytes, each with a
+// bit mask. After the domains are processed, the thread running the
+// exchange XORs every region's masked word with the value it last reported
+// and posts a PdoChange only when a bit under the mask differs, so
+// subscribers hear about edges instead of polling the image.
+//
+// The exchange thread never locks: each slot carries a generation that is
+// odd while the slot is in use, and the fields it reads are validated
+// against it seqlock-style, so a slot reused concurrently is skipped for a
+// cycle rather than read torn. Changes are matched against the slot's
+// current generation on delivery, which drops the ones of a subscription
+// removed in the meantime.
+class Subscriptions {
+ public:
+  static constexpr size_t kMaxSlots = 256;
+
+  Subscriptions() = default;
+  ~Subscriptions();
+
+  Subscriptions(const Subscriptions &) = delete;
+  Subscriptions &operator=(const Subscriptions &) = delete;
+
+  // BEAM side. `offset` is relative to the image of `domain`, `mask` is
+  // little-endian over `size` bytes. `tag` is copied and sent back in every
+  // message. Stores the subscription id in `out`; returns 0 or -ENOSPC.
+  int add(const ErlNifPid &pid, uint16_t position, ERL_NIF_TERM tag, unsigned domain,
+          unsigned offset, unsigned size, uint64_t mask, uint64_t *out);
+  // BEAM side. Returns false if `id` is not subscribed (any more).
+  bool remove(uint64_t id);
+
+  // Thread running the exchange, after the due domains were processed. A
+  // new subscription reports its current value on its first check.
+  void check(const std::vector<Domain> &domains, Notifier &notifier);
+
+  // Notifier thread. Sends {:pdo_changed, position, tag, value} and drops
+  // subscriptions whose process no longer exists.
+  void deliver(const PdoChange &change);
+
+ private:
+  // Read by the exchange thread.
+  struct Slot {
+    std::atomic<uint32_t> generation{0};
+    std::atomic<uint32_t> domain{0};
+    std::atomic<uint32_t> offset{0};
+    std::atomic<uint32_t> size{0};
+    std::atomic<uint64_t> mask{0};
+  };
+
+  // Owned by the exchange thread.
+  struct Seen {
+    uint32_t generation;
+    uint64_t value;
+  };
+
+  // Guarded by lock_.
+  struct Owner {
+    ErlNifPid pid;
+    uint16_t position;
+    ErlNifEnv *env;
+    ERL_NIF_TERM tag;
+  };
+
+  void release(size_t slot);
+
+  Slot slots_[kMaxSlots];
+  Seen seen_[kMaxSlots] = {};
+  // Slots ever used; the exchange thread scans only these.
+  std::atomic<size_t> used_{0};
+
+  std::mutex lock_;
+  Owner owners_[kMaxSlots] = {};
+};
+
+}  // namespace ethercat_ex
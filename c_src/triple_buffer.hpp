@@ -0,0 +1,53 @@
+// Lock-free single-producer/single-consumer triple buffer.
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace ethercat_ex {
+
+// The producer always owns one buffer ("back") and the consumer another
+// ("front"); the third sits in the middle. Publishing swaps back and middle
+// and marks the middle as fresh, consuming swaps front and middle if it is
+// fresh. Both sides only ever touch a buffer nobody else holds, so neither
+// waits nor retries, and the consumer always sees the latest complete frame.
+class TripleBuffer {
+ public:
+  TripleBuffer() = default;
+
+  // Not thread-safe; only for use before producer and consumer start.
+  void resize(size_t size) {
+    for (std::vector<uint8_t> &buffer : buffers_) buffer.assign(size, 0);
+  }
+
+  size_t size() const { return buffers_[0].size(); }
+
+  // Producer side.
+  uint8_t *back() { return buffers_[back_].data(); }
+
+  void publish() {
+    back_ = middle_.exchange(back_ | kFresh, std::memory_order_acq_rel) & kIndex;
+  }
+
+  // Consumer side. Returns the latest published frame, which stays valid
+  // and unchanged until the next call.
+  const uint8_t *front() {
+    if (middle_.load(std::memory_order_relaxed) & kFresh) {
+      front_ = middle_.exchange(front_, std::memory_order_acq_rel) & kIndex;
+    }
+    return buffers_[front_].data();
+  }
+
+ private:
+  static constexpr unsigned kIndex = 0x3;
+  static constexpr unsigned kFresh = 0x4;
+
+  std::vector<uint8_t> buffers_[3];
+  unsigned back_ = 0;
+  alignas(64) std::atomic<unsigned> middle_{1};
+  alignas(64) unsigned front_ = 2;
+};
+
+}  // namespace ethercat_ex
@@ -3,8 +3,29 @@ defmodule EthercatEx do
   EthercatEx is an Elixir wrapper for the EtherLab Master, enabling real-time EtherCAT communication.
 
   This module provides a high-level interface to configure and manage EtherCAT communication.
+  It talks to the master through a NIF linked against `libethercat`, so calls are served by
+  direct ioctls on `/dev/EtherCATx` instead of spawning the `ethercat` CLI (see `EthercatEx.Cli`
+  for the CLI-based wrapper).
+
+  Every master requested by `init/1` is held as its own NIF resource, shared by all processes
+  until `shutdown/1` is called. Masters are independent: each has its own process data domain,
+  cyclic thread, SDO queue and monitors, so a stalled segment never delays another. Functions
+  act on master `0` unless given a `master: index` option:
+
+      :ok = EthercatEx.init(interface: "eth0", master: 0)
+      :ok = EthercatEx.init(interface: "eth1", master: 1)
+      :ok = EthercatEx.activate(master: 0, cycle_time: 1000, cpu: 2)
+      :ok = EthercatEx.activate(master: 1, cycle_time: 250, cpu: 3)
+      EthercatEx.read_pdo(4, master: 1)
   """
 
+  alias EthercatEx.{Inventory, Nif}
+
+  # One term per held master, {{__MODULE__, :master}, index} => %{master: resource, dc: mode},
+  # written only by init/1 and erased only by shutdown/1, both under a lock on the index. A
+  # new key costs no global GC scan and two masters never rewrite a shared term.
+  @master_key {__MODULE__, :master}
+
   ### Basic Configuration and Initialization ###
 
   @doc """
@@ -13,35 +34,193 @@ defmodule EthercatEx do
   ## Options
 
     * `:interface` - (Required) Network interface to use for EtherCAT communication (e.g., `"eth0"`).
-    * `:dc` - (Optional) Enable distributed clocks (default: `false`).
+      The device itself is bound by the `ec_master` kernel module (`main_devices=`).
+    * `:master` - (Optional) Index of the master to request (default: `0`). Call `init/1` once
+      per master to drive several.
+    * `:dc` - (Optional) Enable distributed clocks (default: `false`). With `true` (or
+      `:follow_reference`) the cyclic thread passes its time to the master every cycle, syncs
+      all slave clocks to the reference clock and steers its own time base, and with it its
+      wake-ups, to the reference clock through a PI controller, so the host never drifts away
+      from the bus. `:sync_reference` instead sets the reference clock to the host time every
+      cycle. Slaves opt in with the `:dc` option of `configure_slave/3`. Requires a
+      `:cycle_time` in `activate/1`.
     * `:timeout` - (Optional) Timeout for operations in milliseconds (default: `1000`).
 
+  Returns `{:error, :already_initialized}` if the master is already held, or
+  `{:error, {code, reason}}` if libethercat could not request it.
+
   ## Examples
 
       iex> EthercatEx.init(interface: "eth0", dc: true, timeout: 2000)
       :ok
   """
   def init(opts \\ []) do
-    # NIF or Port communication to initialize EtherLab Master
+    index = Keyword.get(opts, :master, 0)
+
+    with_master_lock(index, fn ->
+      case fetch_entry(index) do
+        {:ok, _entry} ->
+          {:error, :already_initialized}
+
+        {:error, :not_initialized} ->
+          with {:ok, master} <- Nif.request_master(index) do
+            entry = %{master: master, dc: dc_mode(Keyword.get(opts, :dc, false))}
+            :persistent_term.put(master_key(index), entry)
+          end
+      end
+    end)
+  end
+
+  @doc """
+  Activates the master's configuration and starts cyclic operation.
+
+  Slaves must be configured with `configure_slave/3` before activation; the
+  configuration is fixed afterwards.
+
+  The exchange runs on a native thread, one per master, named `ecat-master<index>`, that wakes on
+  absolute `CLOCK_MONOTONIC` deadlines and performs receive, process, queue
+  and send every cycle independently of BEAM scheduling. Elixir exchanges
+  data with it only through lock-free buffers (see `read_pdo/2` and
+  `write_pdo/3`).
+
+  ## Options
+
+    * `:cycle_time` - (Optional) Cycle period in microseconds (default: `1000`). Pass `nil` to
+      start no thread and drive the exchange with `cycle/1` instead.
+    * `:priority` - (Optional) `SCHED_FIFO` priority of the cyclic thread (default: `80`, or
+      `0` on the virtual clock). Requires `CAP_SYS_NICE`; `0` runs it under the default
+      scheduler.
+    * `:cpu` - (Optional) CPU core to pin the cyclic thread to (default: `nil`, not pinned).
+      Give each master its own core.
+    * `:clock` - (Optional) `:monotonic` (default) or `:virtual`. On the virtual clock the
+      thread does not sleep: each cycle starts as soon as the previous one is done and time
+      advances by exactly `:cycle_time`, with DC time starting at the EtherCAT epoch. Use it
+      with the simulated backend (see the README) to run the cyclic engine, the SDO engine
+      and telemetry at full speed without hardware. Latency is then always zero, while
+      the `:duration` histogram and deadline misses still reflect the real cost of a cycle.
+    * `:lock_memory` - (Optional) Lock all memory of the VM in RAM with `mlockall(2)` before the
+      thread starts (default: `false`), so a cycle never waits for a page fault. It affects the
+      whole OS process and needs `CAP_IPC_LOCK` or a large enough `RLIMIT_MEMLOCK`; activation
+      fails with the `mlockall` error otherwise.
+    * `:acyclic_budget` - (Optional) Bytes of acyclic traffic, EoE frames as well as mailbox
+      and register requests, the master may add to the frames of one cycle (default: `nil`,
+      whatever fits in `:cycle_time` at 100 Mbit/s). Lower it to keep heavy EoE traffic, such
+      as a drive's web UI, from stretching the cyclic frame past its deadline; acyclic
+      transfers then take more cycles instead. See `EthercatEx.Eoe.stats/1` for the traffic.
+    * `:master` - (Optional) Index of the master (default: `0`).
+
+  ## Examples
+
+      iex> EthercatEx.activate(cycle_time: 500, priority: 90, cpu: 3)
+      :ok
+  """
+  def activate(opts \\ []) do
+    with {:ok, %{master: master, dc: dc}} <- fetch_entry(master_index(opts)) do
+      cyclic =
+        case Keyword.get(opts, :cycle_time, 1000) do
+          nil ->
+            nil
+
+          cycle_time ->
+            clock = Keyword.get(opts, :clock, :monotonic)
+            prio = Keyword.get(opts, :priority, if(clock == :virtual, do: 0, else: 80))
+            lock_memory = Keyword.get(opts, :lock_memory, false)
+            budget = Keyword.get(opts, :acyclic_budget) || 0
+
+            {cycle_time * 1000, prio, Keyword.get(opts, :cpu) || -1, dc, clock, lock_memory,
+             budget}
+        end
+
+      if cyclic == nil and dc != false,
+        do: {:error, :dc_needs_cycle_time},
+        else: Nif.activate(master, cyclic)
+    end
   end
 
   @doc """
-  Shuts down the EtherCAT master.
+  Shuts down the EtherCAT master given by the `:master` option, or all held masters without it.
 
   ## Examples
 
+      iex> EthercatEx.shutdown(master: 1)
+      :ok
+
       iex> EthercatEx.shutdown()
       :ok
   """
-  def shutdown() do
-    # Cleanly stop EtherCAT operations
+  def shutdown(opts \\ []) do
+    indexes =
+      case Keyword.fetch(opts, :master) do
+        {:ok, index} -> [index]
+        :error -> Enum.map(masters(), &elem(&1, 0))
+      end
+
+    released =
+      Enum.filter(indexes, fn index ->
+        with_master_lock(index, fn ->
+          case fetch_entry(index) do
+            {:ok, %{master: master}} ->
+              :ok = Nif.release_master(master)
+              :persistent_term.erase(master_key(index))
+
+            {:error, :not_initialized} ->
+              false
+          end
+        end)
+      end)
+
+    if released != [], do: Inventory.invalidate(), else: :ok
   end
 
   ### Slave Management ###
 
+  @doc """
+  Creates an additional process data domain, exchanged every `:every` cycles.
+
+  Domain `0` always exists and is exchanged every cycle. Slaves are put
+  into a domain with the `:domain` option of `configure_slave/3`, so that
+  slow process data (IO, temperatures) only travels in the frames of the
+  cycles where its domain is due instead of taking up space in every fast
+  cycle. Inputs of a domain that was not due stay as last received, and
+  outputs written meanwhile go out with its next frame.
+
+  Must be called before `activate/1`.
+
+  ## Options
+
+    * `:every` - (Optional) Period of the domain in cycles of the `:cycle_time` given to
+      `activate/1` (default: `1`). With a 250 µs cycle, `every: 40` exchanges the domain
+      every 10 ms.
+    * `:phase` - (Optional) Cycle, from `0` to `every - 1`, within the period on which the
+      domain is exchanged (default: `0`). Give slow domains different phases to spread them
+      over the cycles.
+    * `:master` - (Optional) Index of the master (default: `0`).
+
+  ## Examples
+
+      iex> EthercatEx.create_domain(every: 40, phase: 1)
+      {:ok, 1}
+  """
+  def create_domain(opts \\ []) do
+    every = Keyword.get(opts, :every, 1)
+    phase = Keyword.get(opts, :phase, 0)
+
+    with {:ok, master} <- fetch_master(master_index(opts)) do
+      Nif.create_domain(master, every, phase)
+    end
+  end
+
   @doc """
   Scans the EtherCAT bus for connected slaves and returns a list of detected slaves.
 
+  The list is served from `EthercatEx.Inventory` while the bus is unchanged, so the
+  `:state` of each slave is the one seen when it was last loaded; see `status/1` for live
+  states.
+
+  ## Options
+
+    * `:master` - (Optional) Index of the master (default: `0`).
+
   ## Examples
 
       iex> EthercatEx.scan()
@@ -50,25 +229,142 @@ defmodule EthercatEx do
         %{id: 2, vendor_id: 0x23456789, product_code: 0x98765432}
       ]
   """
-  def scan() do
-    # Interact with EtherLab to retrieve slave details
+  def scan(opts \\ []) do
+    index = master_index(opts)
+
+    with {:ok, master} <- fetch_master(index),
+         {:ok, slaves} <-
+           Inventory.slaves({:nif, index}, & &1.id, fn -> Nif.slaves(master) end) do
+      slaves
+    end
   end
 
   @doc """
   Configures a slave with the specified parameters.
 
+  Must be called before `activate/1`. Every PDO entry listed in `:sync_managers`
+  is registered in the slave's process data domain (entries with index `0` are gaps).
+
+  The master cannot take back a slave configuration that failed half-way, e.g. on
+  a PDO entry the slave does not have: this returns
+  `{:error, {:configuration_failed, {errno, message}}}`, and from then on
+  `configure_slave/3` and `activate/1` return `{:error, :configuration_failed}`.
+  Call `shutdown/1` and `init/1` again to start over.
+
   ## Parameters
 
     * `slave_id` - The ID of the slave to configure.
-    * `config` - A map containing configuration details (e.g., PDO mappings, sync managers).
+    * `config` - A map containing configuration details:
+      * `:vendor_id`, `:product_code` - (Required) Expected slave identity.
+      * `:alias` - (Optional) Alias address the position is relative to (default: `0`).
+      * `:sync_managers` - (Optional) PDO assignment and mapping; omit to keep the slave defaults.
+      * `:domain` - (Optional) Domain from `create_domain/1` to exchange the slave's process
+        data in (default: `0`). Returns `{:error, :unknown_domain}` if there is no such domain.
+      * `:sdos` - (Optional) Startup parameters as `{index, subindex, data}`, with `data` a
+        binary or `{value, byte_size}`. Pass `:complete` as subindex for a CoE complete-access
+        download of the whole object. They are written by the master itself, in order, each
+        time it brings the slave to PREOP and before PDO assignment, so there is no need to
+        repeat them after a slave restart.
+      * `:dc` - (Optional) Distributed clocks settings for the slave, a map with
+        `:assign_activate` (the AssignActivate word from the ESI, e.g. `0x0300`), `:sync0_cycle`
+        in ns (usually the `:cycle_time` of `activate/1`), and optionally `:sync0_shift`,
+        `:sync1_cycle`, `:sync1_shift` in ns and `reference_clock: true` to use this slave as
+        the reference clock instead of the first DC-capable one. Only takes effect with the
+        `:dc` option of `init/1`.
+      * `:eoe` - (Optional) EoE IP parameters the master sends to the slave each time it
+        configures it, a map with any of `:ip`, `:netmask`, `:gateway` and `:dns` as address
+        tuples or strings, `:mac` as a 6-byte binary and `:hostname`. Unlike
+        `EthercatEx.Cli.set_eoe_ip/2` this needs no tool call and survives slave restarts.
+      * `:sdo_requests` - (Optional) Number of SDO transfers that can be in flight for the slave
+        at once (default: `2`). `0` disables `sdo_request/5` for it.
+      * `:sdo_size` - (Optional) Largest SDO payload in bytes (default: `256`). With an IgH
+        master older than 1.6, downloads must be exactly this size.
+      * `:foe_size` - (Optional) Largest file in bytes that `foe_write/4` and `foe_read/4` can
+        transfer with the slave (default: `0`, no FoE). The buffer is allocated once, here.
+      * `:reg_size` - (Optional) Largest register range `read_registers/3` and
+        `write_registers/3` can cover on the slave (default: `32`); `0` leaves it out of them.
+    * `opts` - `master: index` to configure a slave of another master than `0`.
 
   ## Examples
 
-      iex> EthercatEx.configure_slave(1, %{pdo_mapping: ...})
+      iex> EthercatEx.configure_slave(1, %{
+      ...>   vendor_id: 0x2,
+      ...>   product_code: 0x07D83052,
+      ...>   sync_managers: [
+      ...>     %{index: 3, direction: :input, pdos: [%{index: 0x1A00, entries: [{0x6000, 0x01, 1}]}]}
+      ...>   ]
+      ...> })
       :ok
   """
-  def configure_slave(slave_id, config) do
-    # Apply configuration to the specified slave
+  def configure_slave(slave_id, config, opts \\ []) do
+    spec = %{
+      domain: Map.get(config, :domain, 0),
+      alias: Map.get(config, :alias, 0),
+      position: slave_id,
+      vendor_id: Map.fetch!(config, :vendor_id),
+      product_code: Map.fetch!(config, :product_code),
+      sync_managers: config |> Map.get(:sync_managers, []) |> Enum.map(&sync_spec/1),
+      startup_sdos: config |> Map.get(:sdos, []) |> Enum.map(&startup_sdo/1),
+      dc: config |> Map.get(:dc) |> dc_spec(),
+      eoe: config |> Map.get(:eoe) |> eoe_spec(),
+      sdo_requests: Map.get(config, :sdo_requests, 2),
+      sdo_size: Map.get(config, :sdo_size, 256),
+      foe_size: Map.get(config, :foe_size, 0),
+      reg_size: Map.get(config, :reg_size, 32)
+    }
+
+    with {:ok, master} <- fetch_master(master_index(opts)),
+         {:ok, _layout} <- Nif.configure_slave(master, spec) do
+      :ok
+    end
+  end
+
+  @doc """
+  Configures several slaves at once.
+
+  Takes `{slave_id, config}` pairs, with `config` and `opts` as for `configure_slave/3`.
+  Startup parameters given in `:sdos` are only queued; the master downloads
+  them while it configures the bus after `activate/1`, for all slaves in
+  parallel, so startup time no longer grows with one round trip per
+  parameter and slave.
+
+  Stops at the first failure and returns `{:error, {slave_id, reason}}`;
+  slaves configured before it stay configured. See `configure_slave/3` for the
+  failures that need `shutdown/1`.
+
+  ## Examples
+
+      iex> EthercatEx.configure_slaves([
+      ...>   {1, %{vendor_id: 0x2, product_code: 0x0C1E3052, sdos: [{0x8010, 0x01, {1500, 2}}]}},
+      ...>   {2, %{vendor_id: 0x2, product_code: 0x0C1E3052, sdos: [{0x8010, 0x01, {1500, 2}}]}}
+      ...> ])
+      :ok
+  """
+  def configure_slaves(slaves, opts \\ []) do
+    Enum.reduce_while(slaves, :ok, fn {slave_id, config}, :ok ->
+      case configure_slave(slave_id, Map.new(config), opts) do
+        :ok -> {:cont, :ok}
+        {:error, reason} -> {:halt, {:error, {slave_id, reason}}}
+      end
+    end)
+  end
+
+  @doc """
+  Returns where a configured slave's PDO entries live in the process image.
+
+  Offsets are byte offsets into the image of the slave's `:domain`; `:inputs` and `:outputs`
+  are the `{offset, size}` ranges `read_pdo/2` and `write_pdo/3` operate on. Takes the
+  `:master` option.
+
+  ## Examples
+
+      iex> EthercatEx.layout(1)
+      {:ok, %{domain: 0, inputs: {0, 1}, outputs: {0, 0}, entries: [%{index: 0x6000, ...}]}}
+  """
+  def layout(slave_id, opts \\ []) do
+    with {:ok, master} <- fetch_master(master_index(opts)) do
+      Nif.slave_layout(master, slave_id)
+    end
   end
 
   ### Data Exchange ###
@@ -76,64 +372,226 @@ defmodule EthercatEx do
   @doc """
   Reads process data from a specified slave.
 
+  Returns binaries, never lists. While the cyclic thread runs they are
+  consistent copies of the slave's slice of the most recently received
+  image.
+
+  When the exchange is driven with `cycle/1` instead, they are copies of
+  the domain image as left by the last `cycle/1`.
+
   ## Parameters
 
     * `slave_id` - The ID of the slave to read from.
+    * `opts` - `master: index` (default: `0`).
 
   ## Examples
 
       iex> EthercatEx.read_pdo(1)
-      %{inputs: [0x12, 0x34], outputs: [0x56, 0x78]}
+      %{inputs: <<0x12, 0x34>>, outputs: <<0x56, 0x78>>}
   """
-  def read_pdo(slave_id) do
-    # Use EtherLab to read process data
+  def read_pdo(slave_id, opts \\ []) do
+    with {:ok, master} <- fetch_master(master_index(opts)),
+         {:ok, {inputs, outputs}} <- Nif.read_pdo(master, slave_id) do
+      %{inputs: inputs, outputs: outputs}
+    end
   end
 
   @doc """
   Writes process data to a specified slave.
 
+  The outputs must match the size of the slave's output slice exactly. They
+  are sent with the next frame of the slave's domain; while the cyclic
+  thread runs they are handed over through a lock-free buffer, so this is
+  safe to call from any process.
+
   ## Parameters
 
     * `slave_id` - The ID of the slave to write to.
-    * `data` - The data to write (e.g., outputs).
+    * `data` - The data to write (e.g., outputs), as a binary or list of bytes.
+    * `opts` - `master: index` (default: `0`).
 
   ## Examples
 
       iex> EthercatEx.write_pdo(1, %{outputs: [0xAA, 0xBB]})
       :ok
   """
-  def write_pdo(slave_id, data) do
-    # Use EtherLab to write process data
+  def write_pdo(slave_id, %{outputs: outputs}, opts \\ []) do
+    with {:ok, master} <- fetch_master(master_index(opts)) do
+      Nif.write_pdo(master, slave_id, outputs)
+    end
+  end
+
+  @doc """
+  Performs one process data exchange from the calling process.
+
+  Receives and processes the previous frame, then queues and sends the
+  current outputs. Only available when the master was activated with
+  `cycle_time: nil`; otherwise the cyclic thread owns the exchange. Takes the
+  `:master` option.
+
+  ## Examples
+
+      iex> EthercatEx.cycle()
+      :ok
+  """
+  def cycle(opts \\ []) do
+    with {:ok, master} <- fetch_master(master_index(opts)) do
+      Nif.cycle(master)
+    end
+  end
+
+  @doc """
+  Subscribes a process to changes of one input of a slave.
+
+  Instead of polling `read_pdo/2`, the subscriber receives
+
+      {:pdo_changed, slave_id, entry, value}
+
+  once right away with the current value and then only when the value
+  changes. The thread running the exchange compares the subscribed bits
+  with the last reported value after every received frame of the slave's
+  domain, with a word-wide XOR and without allocating, so a subscription
+  costs next to nothing while its input is stable. Changes that happen and
+  revert between two frames are not seen.
+
+  ## Parameters
+
+    * `slave_id` - The ID of a configured slave.
+    * `entry` - What to watch, also sent back in every message:
+      * `{index, subindex}` - A PDO entry of the slave's inputs (see `layout/2`). `value` is
+        the entry's unsigned value; entries spanning more than 8 bytes are rejected with
+        `{:error, :too_large}`.
+      * `%{offset: byte, mask: mask}` - Bytes `offset` onwards of the slave's inputs under
+        `mask`, a little-endian bit mask of up to 64 bits. `value` is the masked bits shifted
+        down to bit 0.
+    * `opts` - Options:
+      * `:pid` - Process to notify (default: `self()`).
+      * `:master` - Index of the master (default: `0`).
+
+  Returns `{:ok, subscription}` for `unsubscribe_pdo/2`. Subscriptions of
+  processes that exit are dropped automatically; at most 256 can exist per
+  master at a time.
+
+  ## Examples
+
+      iex> {:ok, _subscription} = EthercatEx.subscribe_pdo(3, {0x6000, 0x01})
+      iex> receive do: ({:pdo_changed, 3, {0x6000, 0x01}, value} -> value)
+      1
+  """
+  def subscribe_pdo(slave_id, entry, opts \\ []) do
+    pid = Keyword.get(opts, :pid, self())
+
+    with {:ok, master} <- fetch_master(master_index(opts)),
+         {:ok, {offset, size, mask}} <- pdo_region(master, slave_id, entry, :input) do
+      Nif.subscribe_pdo(master, pid, slave_id, offset, size, mask, entry)
+    end
+  end
+
+  @doc """
+  Cancels a subscription made with `subscribe_pdo/3`. Messages already sent
+  may still arrive.
+  """
+  def unsubscribe_pdo(subscription, opts \\ []) do
+    with {:ok, master} <- fetch_master(master_index(opts)) do
+      Nif.unsubscribe_pdo(master, subscription)
+    end
+  end
+
+  @doc """
+  Replaces the reflex rules of the master.
+
+  Reflexes are interlocks evaluated by the thread running the exchange
+  itself: every cycle, right after the inputs are processed, each rule
+  compares one input with a value, and while it matches, forces one output
+  of the frame sent in the same cycle. Reactions such as dropping outputs
+  on an e-stop thus take effect within one cycle, independently of BEAM
+  scheduling, and override whatever `write_pdo/3` wrote.
+
+  Each rule is a map with
+
+    * `:when` - `{slave_id, entry, :== | :!=, value}`, the input condition.
+    * `:set` - `{slave_id, entry, value}`, the output to force.
+    * `:latch` - (Optional) Keep forcing once triggered, even after the condition clears,
+      until the rules are set again (default: `false`).
+
+  where `entry` is `{index, subindex}` of a PDO entry, or `%{offset: byte, mask: mask}` for
+  bits of the slave's inputs or outputs, as in `subscribe_pdo/3`. Monitors
+  attached with `attach_monitor/2` receive `{:ethercat, :reflex, rule_index}` whenever a
+  rule becomes active.
+
+  Setting the rules, including the same ones again, clears all latches; `[]`
+  removes them. Up to 64 rules per master. When a rule stops being active,
+  or is removed, the outputs it forced stay as forced until `write_pdo/3`
+  writes that slave's outputs again. Takes the `:master` option.
+
+  ## Examples
+
+      iex> EthercatEx.set_reflexes([
+      ...>   %{when: {2, {0x6000, 0x01}, :==, 0}, set: {5, {0x7000, 0x01}, 0}, latch: true}
+      ...> ])
+      :ok
+  """
+  def set_reflexes(rules, opts \\ []) do
+    with {:ok, master} <- fetch_master(master_index(opts)),
+         {:ok, rules} <- reflex_specs(master, rules) do
+      Nif.set_reflexes(master, rules)
+    end
   end
 
   ### Status and Diagnostics ###
 
   @doc """
-  Gets the status of the EtherCAT master.
+  Gets the status of the EtherCAT master. Takes the `:master` option.
 
   ## Examples
 
       iex> EthercatEx.status()
       %{state: :operational, slaves: [%{id: 1, state: :operational}, %{id: 2, state: :pre_operational}]}
   """
-  def status() do
-    # Retrieve the master and slave statuses
+  def status(opts \\ []) do
+    with {:ok, master} <- fetch_master(master_index(opts)),
+         {:ok, state} <- Nif.master_state(master),
+         {:ok, slaves} <- Nif.slaves(master) do
+      %{
+        state: master_state(state),
+        link_up: state.link_up,
+        slaves_responding: state.slaves_responding,
+        slaves: Enum.map(slaves, &Map.take(&1, [:id, :state]))
+      }
+    end
   end
 
   @doc """
   Resets a slave to a known state.
 
+  Takes the slave down to INIT and brings it back to OP, waiting for each step with
+  `EthercatEx.States`. On the way up the master applies the slave's configuration from
+  `configure_slave/3` again, startup SDOs and PDO mapping included, while every other slave
+  keeps cycling. See `EthercatEx.Recovery` to have this done on its own after a link loss.
+
   ## Parameters
 
     * `slave_id` - The ID of the slave to reset.
+    * `opts` - `:timeout` for each of the two transitions (default: `10_000`) and `:master`.
+
+  Returns `:ok` or `{:error, reason}` with the reason given by `EthercatEx.States.request/3`
+  for the slave.
 
   ## Examples
 
       iex> EthercatEx.reset_slave(1)
       :ok
   """
-  def reset_slave(slave_id) do
-    # Reset the specified slave
+  def reset_slave(slave_id, opts \\ []) do
+    with {:error, %{^slave_id => reason}} <- reset_steps(slave_id, opts) do
+      {:error, reason}
+    end
+  end
+
+  defp reset_steps(slave_id, opts) do
+    with :ok <- EthercatEx.States.request([slave_id], :init, opts) do
+      EthercatEx.States.request([slave_id], :operational, opts)
+    end
   end
 
   ### Advanced ###
@@ -141,23 +599,248 @@ defmodule EthercatEx do
   @doc """
   Sends a custom SDO (Service Data Object) request to a slave.
 
+  The transfer is done by the thread running the exchange, between two
+  frames, using one of the SDO requests reserved for the slave by
+  `configure_slave/3`. The calling process waits for the result; the
+  scheduler is not blocked meanwhile. The master must be active.
+
+  Reads return the value as an unsigned little-endian integer; use
+  `sdo_request_async/5` to get the raw binary.
+
   ## Parameters
 
     * `slave_id` - The ID of the slave to send the request to.
     * `index` - The object index.
     * `subindex` - The object subindex.
-    * `data` - The data to send (optional, for writes).
+    * `data` - The data to send (optional, for writes), as a binary or `{value, byte_size}`.
+    * `opts` - Options:
+      * `:timeout` - Time in milliseconds the slave has to answer (default: `1000`).
+      * `:master` - Index of the master the slave is on (default: `0`).
+
+  Returns `{:error, :queue_full}` if more transfers are queued for the slave
+  than it can take, `{:error, :too_large}` for data larger than `:sdo_size` and
+  `{:error, {:sdo_failed, abort_code}}` if the slave aborted the transfer or
+  did not answer in time. `abort_code` is the CoE abort code, or `0` when
+  there is none (a timeout) or the installed IgH master does not report it.
+  If no result came after twice `:timeout`, `{:error, :timeout}` is returned
+  and a result already in the mailbox for the request is dropped.
 
   ## Examples
 
       iex> EthercatEx.sdo_request(1, 0x6000, 0x01)
       {:ok, 0x1234}
 
-      iex> EthercatEx.sdo_request(1, 0x6000, 0x01, 0x5678)
+      iex> EthercatEx.sdo_request(1, 0x6000, 0x01, {0x5678, 2})
+      :ok
+  """
+  def sdo_request(slave_id, index, subindex, data \\ nil, opts \\ []) do
+    timeout = Keyword.get(opts, :timeout, 1000)
+
+    with {:ok, ref} <- sdo_request_async(slave_id, index, subindex, data, opts) do
+      receive do
+        {:sdo_done, ^ref, {:ok, value}} -> {:ok, :binary.decode_unsigned(value, :little)}
+        {:sdo_done, ^ref, result} -> result
+      after
+        # The request itself times out on the slave side; this only guards
+        # against an exchange that stopped running.
+        timeout * 2 ->
+          flush_ref(ref)
+          {:error, :timeout}
+      end
+    end
+  end
+
+  @doc """
+  Queues an SDO request and returns immediately.
+
+  Takes the same arguments as `sdo_request/5`. On success the calling
+  process later receives `{:sdo_done, ref, result}`, where `result` is
+  `{:ok, binary}` for reads, `:ok` for writes or `{:error, reason}`. Every
+  accepted request is answered, including when the master is shut down.
+
+  ## Examples
+
+      iex> {:ok, ref} = EthercatEx.sdo_request_async(1, 0x1018, 0x01)
+      iex> receive do: ({:sdo_done, ^ref, result} -> result)
+      {:ok, <<0x02, 0x00, 0x00, 0x00>>}
+  """
+  def sdo_request_async(slave_id, index, subindex, data \\ nil, opts \\ []) do
+    timeout = Keyword.get(opts, :timeout, 1000)
+    ref = make_ref()
+
+    result =
+      with {:ok, master} <- fetch_master(master_index(opts)) do
+        case data do
+          nil -> Nif.sdo_read(master, slave_id, index, subindex, timeout, ref)
+          data -> Nif.sdo_write(master, slave_id, index, subindex, sdo_data(data), timeout, ref)
+        end
+      end
+
+    with :ok <- result, do: {:ok, ref}
+  end
+
+  @doc """
+  Writes a file to a slave over FoE (File access over EtherCAT), e.g. a
+  firmware image.
+
+  `data` is a binary or an enumerable of binaries, such as a
+  `File.stream!/3`. It is copied chunk by chunk into the buffer reserved by
+  the `:foe_size` option of `configure_slave/3`, so the file is never held
+  whole by any process, and then sent by the thread running the exchange,
+  between two frames. Transfers to different slaves run in parallel. The
+  master must be active.
+
+  ## Options
+
+    * `:password` - FoE password the slave expects (default: `0`).
+    * `:timeout` - Time in milliseconds the slave has to answer (default: `3000`).
+    * `:on_progress` - Function called with the bytes sent so far and the file size, about
+      every 64 KiB.
+    * `:master` - Index of the master the slave is on (default: `0`).
+
+  Returns `{:error, :busy}` while another transfer uses the slave,
+  `{:error, :too_large}` for a file larger than `:foe_size`,
+  `{:error, :not_configured}` for a slave without FoE and
+  `{:error, {:foe_failed, code}}` if the slave rejected the file. If the
+  exchange has not finished the transfer after twice `:timeout`, it is
+  abandoned and `{:error, :timeout}` returned; the slave takes the next
+  transfer once the master is done with it.
+
+  ## Examples
+
+      iex> EthercatEx.foe_write(1, "firmware.efw", File.stream!("fw.efw", [], 65_536))
       :ok
   """
-  def sdo_request(slave_id, index, subindex, data \\ nil) do
-    # Handle SDO request (read/write)
+  def foe_write(slave_id, name, data, opts \\ []) do
+    ref = make_ref()
+
+    with {:ok, master} <- fetch_master(master_index(opts)),
+         {:ok, size} <- foe_load(master, slave_id, data) do
+      password = Keyword.get(opts, :password, 0)
+      timeout = Keyword.get(opts, :timeout, 3000)
+
+      case Nif.foe_write(master, slave_id, name, password, size, timeout, ref) do
+        :ok ->
+          await_foe(master, slave_id, ref, Keyword.get(opts, :on_progress), timeout)
+
+        error ->
+          Nif.foe_release(master, slave_id)
+          error
+      end
+    end
+  end
+
+  @doc """
+  Reads a file from a slave over FoE.
+
+  The file is received into the buffer reserved by the `:foe_size` option
+  of `configure_slave/3` and then copied into `collectable` in 64 KiB
+  chunks; pass a `File.stream!/3` to write it to disk without holding it in
+  memory. Returns `{:ok, collectable}`. Takes the options of `foe_write/4`;
+  `:on_progress` gets `nil` as the size, which is not known in advance.
+
+  ## Examples
+
+      iex> EthercatEx.foe_read(1, "log.txt")
+      {:ok, "..."}
+  """
+  def foe_read(slave_id, name, collectable \\ "", opts \\ []) do
+    ref = make_ref()
+    password = Keyword.get(opts, :password, 0)
+    timeout = Keyword.get(opts, :timeout, 3000)
+    on_progress = Keyword.get(opts, :on_progress)
+
+    with {:ok, master} <- fetch_master(master_index(opts)),
+         :ok <- Nif.foe_read(master, slave_id, name, password, timeout, ref),
+         {:ok, size} <- await_foe(master, slave_id, ref, on_progress, timeout) do
+      try do
+        {:ok, foe_unload(master, slave_id, size, collectable)}
+      after
+        Nif.foe_release(master, slave_id)
+      end
+    end
+  end
+
+  @doc """
+  Reads the same ESC register range from every configured slave at once.
+
+  The thread running the exchange starts one register request per slave in
+  the same cycle, so all of them travel in the acyclic datagrams of the
+  next few frames instead of one `ethercat reg_read` invocation per slave.
+  The master must be active. Slaves configured with `reg_size: 0` are left
+  out; `size` may not exceed the smallest `:reg_size` among the others.
+
+  Returns `{:ok, [{slave_id, binary | :error}]}` in slave order, the
+  binaries being parts of a single one. A slave that has not answered
+  within `:timeout`, e.g. one that dropped off the bus, is reported as
+  `:error` and does not hold up the others. Returns `{:error, :busy}` while
+  another register batch is running on the master.
+
+  ## Options
+
+    * `:timeout` - Time in milliseconds each slave has to answer (default: `1000`).
+    * `:master` - Index of the master (default: `0`).
+
+  ## Examples
+
+      # AL status and AL status code of every slave
+      iex> EthercatEx.read_registers(0x0130, 6)
+      {:ok, [{0, <<0x08, 0, 0, 0, 0, 0>>}, {1, <<0x08, 0, 0, 0, 0, 0>>}]}
+  """
+  def read_registers(address, size, opts \\ []) do
+    with {:ok, positions, data, failed} <-
+           register_batch(opts, &Nif.register_read(&1, address, size, &2, &3)) do
+      results =
+        positions
+        |> Enum.with_index()
+        |> Enum.map(fn {position, i} ->
+          if position in failed,
+            do: {position, :error},
+            else: {position, binary_part(data, i * size, size)}
+        end)
+
+      {:ok, results}
+    end
+  end
+
+  @doc """
+  Writes `data` to the same ESC registers of every configured slave at once.
+
+  Works like `read_registers/3`. Returns `{:error, {:register_failed,
+  slave_ids}}` if some slaves did not take the write.
+
+  ## Examples
+
+      # Clear the CRC error counters
+      iex> EthercatEx.write_registers(0x0300, <<0>>)
+      :ok
+  """
+  def write_registers(address, data, opts \\ []) when is_binary(data) do
+    case register_batch(opts, &Nif.register_write(&1, address, data, &2, &3)) do
+      {:ok, _positions, _data, []} -> :ok
+      {:ok, _positions, _data, failed} -> {:error, {:register_failed, failed}}
+      error -> error
+    end
+  end
+
+  @doc """
+  Reads the error counters of every configured slave in one register batch.
+
+  The native counterpart of `EthercatEx.Cli.diagnose_crc/0`. Returns
+  `{:ok, %{slave_id => counters}}`, where `counters` has `:ports`, a list of
+  four `%{invalid_frame: n, rx_error: n, forwarded: n, lost_link: n}`, and
+  `:processing_unit` and `:pdi` error counts. Slaves whose read failed are
+  left out. Takes the options of `read_registers/3`.
+  """
+  def crc_counters(opts \\ []) do
+    with {:ok, results} <- read_registers(0x0300, 0x14, opts) do
+      counters =
+        for {position, data} when is_binary(data) <- results,
+            into: %{},
+            do: {position, crc_counters_from(data)}
+
+      {:ok, counters}
+    end
   end
 
   ### Utilities ###
@@ -165,16 +848,283 @@ defmodule EthercatEx do
   @doc """
   Attaches a monitor to track events or errors from the EtherCAT master.
 
+  The thread running the exchange compares the bus state with the previous
+  cycle and `pid` receives a message only when something changed:
+
+    * `{:ethercat, :domain, %{domain: index, working_counter: wc, wc_state: :zero | :incomplete | :complete}}`
+    * `{:ethercat, :master, %{slaves_responding: n, al_states: [state], link_up: boolean}}`
+    * `{:ethercat, :slave, slave_id, %{online: boolean, operational: boolean, al_state: state}}`
+    * `{:ethercat, :reflex, rule_index}` when a rule of `set_reflexes/2` becomes active
+
+  Domain states are compared whenever the domain is exchanged, the master
+  state every cycle and configured slaves one per cycle in turn, so a lost
+  slave shows up as a master event within a cycle, as a domain event with
+  the next frame of its domain and as a slave event within one cycle per
+  configured slave. Messages are sent from a separate thread fed through a
+  lock-free queue, never from the cyclic thread itself.
+
+  Processes that exit are dropped automatically. Attaching twice has no
+  effect; see `detach_monitor/2`.
+
   ## Parameters
 
     * `pid` - The process to send notifications to.
+    * `opts` - `master: index` of the master to watch (default: `0`). A process
+      attached to several masters cannot tell their messages apart.
 
   ## Examples
 
       iex> EthercatEx.attach_monitor(self())
       :ok
   """
-  def attach_monitor(pid) do
-    # Allow monitoring of EtherCAT events
+  def attach_monitor(pid, opts \\ []) do
+    with {:ok, master} <- fetch_master(master_index(opts)) do
+      Nif.attach_monitor(master, pid)
+    end
+  end
+
+  @doc """
+  Stops sending bus state change messages to `pid`.
+  """
+  def detach_monitor(pid, opts \\ []) do
+    with {:ok, master} <- fetch_master(master_index(opts)) do
+      Nif.detach_monitor(master, pid)
+    end
+  end
+
+  @doc false
+  def fetch_master(index \\ 0) do
+    with {:ok, %{master: master}} <- fetch_entry(index), do: {:ok, master}
+  end
+
+  # Held masters as `[{index, master}]` in index order.
+  @doc false
+  def masters do
+    held = :persistent_term.get()
+    Enum.sort(for {{@master_key, index}, %{master: master}} <- held, do: {index, master})
+  end
+
+  defp fetch_entry(index) do
+    case :persistent_term.get(master_key(index), nil) do
+      nil -> {:error, :not_initialized}
+      entry -> {:ok, entry}
+    end
+  end
+
+  defp master_key(index), do: {@master_key, index}
+
+  # Serializes init/1 and shutdown/1 of one master within this node.
+  defp with_master_lock(index, fun) do
+    :global.trans({master_key(index), self()}, fun, [node()])
+  end
+
+  defp master_index(opts), do: Keyword.get(opts, :master, 0)
+
+  defp register_batch(opts, start) do
+    ref = make_ref()
+    timeout = Keyword.get(opts, :timeout, 1000)
+
+    with {:ok, master} <- fetch_master(master_index(opts)),
+         :ok <- start.(master, timeout, ref) do
+      receive do
+        {:register_done, ^ref, result} -> result
+      after
+        # As for `sdo_request/5`, the batch gives up on its slaves first;
+        # this only guards against an exchange that stopped running.
+        timeout * 2 ->
+          flush_ref(ref)
+          {:error, :timeout}
+      end
+    end
+  end
+
+  # ESC registers 0x0300-0x0313: per port an invalid frame and an RX error
+  # counter, then the forwarded RX error counters, the processing unit and
+  # PDI error counters and, after two reserved bytes, the lost link counters.
+  defp crc_counters_from(data) do
+    <<rx::binary-size(8), forwarded::binary-size(4), processing_unit, pdi, _::binary-size(2),
+      lost_link::binary-size(4)>> = data
+
+    ports =
+      for port <- 0..3 do
+        %{
+          invalid_frame: :binary.at(rx, 2 * port),
+          rx_error: :binary.at(rx, 2 * port + 1),
+          forwarded: :binary.at(forwarded, port),
+          lost_link: :binary.at(lost_link, port)
+        }
+      end
+
+    %{ports: ports, processing_unit: processing_unit, pdi: pdi}
+  end
+
+  @foe_chunk 65_536
+
+  # The first non-empty chunk reserves the slave; an empty file reserves it
+  # with an empty one. Failures after that give the reservation back.
+  defp foe_load(master, slave_id, data) do
+    chunks =
+      if is_binary(data),
+        do: foe_chunks(data),
+        else: Stream.reject(data, &(IO.iodata_length(&1) == 0))
+
+    chunks
+    |> Enum.reduce_while({:ok, 0}, fn chunk, {:ok, offset} ->
+      case Nif.foe_load(master, slave_id, offset, chunk) do
+        :ok ->
+          {:cont, {:ok, offset + IO.iodata_length(chunk)}}
+
+        error ->
+          if offset > 0, do: Nif.foe_release(master, slave_id)
+          {:halt, error}
+      end
+    end)
+    |> case do
+      {:ok, 0} -> with :ok <- Nif.foe_load(master, slave_id, 0, <<>>), do: {:ok, 0}
+      result -> result
+    end
   end
+
+  defp foe_chunks(<<chunk::binary-size(@foe_chunk), rest::binary>>),
+    do: [chunk | foe_chunks(rest)]
+
+  defp foe_chunks(<<>>), do: []
+  defp foe_chunks(rest), do: [rest]
+
+  defp foe_unload(master, slave_id, size, collectable) do
+    {acc, collect} = Collectable.into(collectable)
+
+    acc =
+      Enum.reduce(0..(size - 1)//@foe_chunk, acc, fn offset, acc ->
+        {:ok, chunk} = Nif.foe_unload(master, slave_id, offset, @foe_chunk)
+        collect.(acc, {:cont, chunk})
+      end)
+
+    collect.(acc, :done)
+  end
+
+  defp await_foe(master, slave_id, ref, on_progress, timeout) do
+    receive do
+      {:foe_progress, ^ref, bytes, total} ->
+        if on_progress, do: on_progress.(bytes, total)
+        await_foe(master, slave_id, ref, on_progress, timeout)
+
+      {:foe_done, ^ref, result} ->
+        result
+    after
+      # As for sdo_request/5, only guards against an exchange that stopped
+      # running; the slave side has its own timeout. Abandoning the transfer
+      # frees the slave for the next one.
+      timeout * 2 ->
+        Nif.foe_release(master, slave_id)
+        flush_ref(ref)
+        {:error, :timeout}
+    end
+  end
+
+  # Drops the messages a native engine sent for `ref` before the caller gave up on it.
+  defp flush_ref(ref) do
+    receive do
+      {_tag, ^ref, _result} -> flush_ref(ref)
+      {_tag, ^ref, _bytes, _total} -> flush_ref(ref)
+    after
+      0 -> :ok
+    end
+  end
+
+  defp sync_spec(%{index: index, direction: direction, pdos: pdos})
+       when direction in [:input, :output] do
+    {index, direction, Enum.map(pdos, fn %{index: pdo, entries: entries} -> {pdo, entries} end)}
+  end
+
+  # `{offset into the slave's inputs or outputs, byte size, little-endian mask}`
+  defp pdo_region(_master, _slave_id, %{offset: offset, mask: mask}, _direction)
+       when is_integer(offset) and offset >= 0 and is_integer(mask) and mask > 0 do
+    case byte_size(:binary.encode_unsigned(mask)) do
+      size when size > 8 -> {:error, :too_large}
+      size -> {:ok, {offset, size, mask}}
+    end
+  end
+
+  defp pdo_region(master, slave_id, {index, subindex}, direction) do
+    with {:ok, layout} <- Nif.slave_layout(master, slave_id) do
+      {start, _size} = if direction == :input, do: layout.inputs, else: layout.outputs
+
+      entry? = &(&1.direction == direction and &1.index == index and &1.subindex == subindex)
+
+      case Enum.find(layout.entries, entry?) do
+        nil ->
+          {:error, :unknown_entry}
+
+        %{offset: offset, bit_position: bit_position, bit_length: bit_length} ->
+          size = div(bit_position + bit_length + 7, 8)
+          mask = Bitwise.bsl(Bitwise.bsl(1, bit_length) - 1, bit_position)
+          if size > 8, do: {:error, :too_large}, else: {:ok, {offset - start, size, mask}}
+      end
+    end
+  end
+
+  defp reflex_specs(master, rules) do
+    rules
+    |> Enum.reduce_while({:ok, []}, fn rule, {:ok, specs} ->
+      %{when: {input_slave, input, op, expected}, set: {output_slave, output, value}} = rule
+
+      with {:ok, input_bits} <- pdo_bits(master, input_slave, input, :input),
+           {:ok, output_bits} <- pdo_bits(master, output_slave, output, :output) do
+        spec = {input_bits, op, expected, output_bits, value, Map.get(rule, :latch, false)}
+        {:cont, {:ok, [spec | specs]}}
+      else
+        error -> {:halt, error}
+      end
+    end)
+    |> case do
+      {:ok, specs} -> {:ok, Enum.reverse(specs)}
+      error -> error
+    end
+  end
+
+  defp pdo_bits(master, slave_id, entry, direction) do
+    with {:ok, {offset, size, mask}} <- pdo_region(master, slave_id, entry, direction) do
+      {:ok, {slave_id, offset, size, mask}}
+    end
+  end
+
+  defp dc_mode(false), do: false
+  defp dc_mode(true), do: :follow_reference
+  defp dc_mode(mode) when mode in [:follow_reference, :sync_reference], do: mode
+
+  defp dc_spec(nil), do: nil
+
+  defp dc_spec(%{assign_activate: assign_activate, sync0_cycle: sync0_cycle} = dc) do
+    {assign_activate, sync0_cycle, Map.get(dc, :sync0_shift, 0), Map.get(dc, :sync1_cycle, 0),
+     Map.get(dc, :sync1_shift, 0), Map.get(dc, :reference_clock, false)}
+  end
+
+  defp eoe_spec(nil), do: nil
+
+  defp eoe_spec(eoe) do
+    eoe = Map.new(eoe)
+
+    {Map.get(eoe, :mac), eoe_address(eoe[:ip]), eoe_address(eoe[:netmask]),
+     eoe_address(eoe[:gateway]), eoe_address(eoe[:dns]), Map.get(eoe, :hostname)}
+  end
+
+  defp eoe_address(nil), do: nil
+  defp eoe_address({a, b, c, d}), do: <<a, b, c, d>>
+
+  defp eoe_address(address) when is_binary(address) do
+    {:ok, tuple} = address |> String.to_charlist() |> :inet.parse_ipv4strict_address()
+    eoe_address(tuple)
+  end
+
+  defp startup_sdo({index, subindex, data}) when is_integer(subindex) or subindex == :complete,
+    do: {index, subindex, sdo_data(data)}
+
+  defp sdo_data({value, size}) when is_integer(value), do: <<value::little-size(size)-unit(8)>>
+  defp sdo_data(data) when is_binary(data), do: data
+
+  defp master_state(%{link_up: false}), do: :link_down
+  defp master_state(%{al_states: [state]}), do: state
+  defp master_state(%{al_states: []}), do: :unknown
+  defp master_state(%{al_states: _mixed}), do: :mixed
 end
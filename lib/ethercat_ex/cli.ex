@@ -1,10 +1,13 @@
 defmodule EthercatEx.Cli do
   @moduledoc """
-  A comprehensive Elixir wrapper for the EtherLab EtherCAT CLI, executing all commands within a GenServer.
+  A comprehensive Elixir wrapper for the EtherLab EtherCAT CLI, executing commands on a supervised worker pool.
 
   This module uses MuonTrap to execute `ethercat` commands, supporting all available commands for controlling
-  and monitoring EtherCAT slaves, such as Beckhoff IO modules. All commands are executed through the GenServer
-  to ensure state consistency and supervision. Designed for use in Nerves projects or other Elixir applications.
+  and monitoring EtherCAT slaves, such as Beckhoff IO modules. Commands run in supervised tasks spread over
+  two lanes: a fast lane for short queries and a transfer lane for long-running FoE, SII and SDO dictionary
+  transfers, so a firmware download never delays a `list_slaves/0` health check. Each lane runs a bounded
+  number of commands in parallel and queues the rest. Designed for use in Nerves projects or other Elixir
+  applications.
 
   ## Configuration
   Configure the `ethercat` binary path, ESI directory, and global options via application environment:
@@ -18,10 +21,29 @@ defmodule EthercatEx.Cli do
     force: false           # Force commands
   ```
 
+  ## Worker Pool
+  The number of concurrent `ethercat` processes per lane is set with `:fast_workers` (default: 4) and
+  `:transfer_workers` (default: 1 per master in `:master`, e.g. 3 for `"0-2"`).
+
+  ## Coprocess
+  With a single master index in `:master`, `slaves`, `pdos`, and `upload`/`download` with an integer
+  `--type` are answered by `ethercat_port`, a helper built with the NIF that links libethercat and
+  keeps the master device open, so they cost a pipe round trip instead of a fork and exec. The
+  helper serves one command at a time. Every other command, those arriving while it is busy or that
+  it takes over 2 seconds for, and all commands while it is unavailable, still run the `ethercat`
+  binary. PDO names are not available through libethercat and are empty in `list_pdos/1` results
+  from the helper.
+
+  ## Parsed Output
+  `list_slaves/0`, `list_pdos/1` and `list_sdos/1` return structs (`EthercatEx.Cli.Slave`,
+  `EthercatEx.Cli.Pdo`, `EthercatEx.Cli.SdoEntry`) instead of text. The output of these commands
+  is parsed while it is read from the `ethercat` process (see `EthercatEx.Cli.Parser`), so even
+  a multi-megabyte SDO dictionary is never held as one string.
+
   ## Periodic Execution
   To run commands periodically (e.g., polling slave states), start the GenServer with a `:poll` option:
   ```elixir
-  EthercatEx.Cli.start_link(poll: [command: "slaves", args: [], interval: 1000, callback: &IO.puts/1])
+  EthercatEx.Cli.start_link(poll: [command: "slaves", args: [], interval: 1000, callback: &IO.inspect/1])
   ```
 
   ## Example Usage
@@ -30,7 +52,7 @@ defmodule EthercatEx.Cli do
   {:ok, pid} = EthercatEx.Cli.start_link()
 
   # List all EtherCAT slaves
-  {:ok, slaves} = EthercatEx.Cli.list_slaves()
+  {:ok, [%EthercatEx.Cli.Slave{position: 0, state: :operational} | _]} = EthercatEx.Cli.list_slaves()
 
   # Read a digital input (e.g., Beckhoff EL1008)
   {:ok, value} = EthercatEx.Cli.read_sdo(0, "0x6000:01")
@@ -39,7 +61,7 @@ defmodule EthercatEx.Cli do
   :ok = EthercatEx.Cli.write_sdo(0, "0x7000:01", 1)
 
   # Start periodic polling of slaves
-  {:ok, pid} = EthercatEx.Cli.start_link(poll: [command: "slaves", interval: 1000, callback: &IO.puts/1])
+  {:ok, pid} = EthercatEx.Cli.start_link(poll: [command: "slaves", interval: 1000, callback: &IO.inspect/1])
   ```
 
   ## Notes
@@ -48,13 +70,18 @@ defmodule EthercatEx.Cli do
   - ESI files should be placed in the configured `esi_dir` for full functionality.
   """
 
-  use GenServer
+  use Supervisor
+  alias EthercatEx.Cli.{Coprocess, Lane, Parser, Poller}
+  alias EthercatEx.Inventory
   alias MuonTrap
 
+  @transfer_commands ~w[foe_read foe_write sii_read sii_write sdos]
+  @parsed_commands %{"slaves" => :slaves, "pdos" => :pdos, "sdos" => :sdos}
+
   # Client API
 
   @doc """
-  Starts the EthercatEx.Cli GenServer for executing `ethercat` commands.
+  Starts the EthercatEx.Cli supervisor and its worker lanes for executing `ethercat` commands.
 
   ## Options
     - `:binary_path` - Path to the `ethercat` binary.
@@ -63,12 +90,20 @@ defmodule EthercatEx.Cli do
     - `:verbose` - Enable verbose output (boolean).
     - `:quiet` - Enable quiet output (boolean).
     - `:force` - Force command execution (boolean).
+    - `:fast_workers` - Concurrent commands in the fast lane (integer).
+    - `:transfer_workers` - Concurrent FoE, SII and SDO dictionary transfers (integer).
+    - `:coprocess` - Serve commands from the persistent `ethercat_port` helper where it can
+      (boolean, default: `true`), or the path of the helper to use.
+    - `:inventory_interval` - How often `EthercatEx.Inventory` checks the bus for changes, in
+      milliseconds (default: 500).
+    - `:inventory_tool_interval` - The same while no master is held and it runs `ethercat master`
+      (default: 5000).
     - `:poll` - Periodic command execution, e.g., `[command: "slaves", args: [], interval: 1000, callback: &IO.puts/1]`.
 
   Returns `{:ok, pid}` or `{:error, reason}`.
   """
   def start_link(opts \\ []) do
-    GenServer.start_link(__MODULE__, opts, name: __MODULE__)
+    Supervisor.start_link(__MODULE__, opts, name: __MODULE__)
   end
 
   @doc """
@@ -81,10 +116,7 @@ defmodule EthercatEx.Cli do
   Returns `:ok` or `{:error, {code, reason}}`.
   """
   def write_alias(slave_position, alias) when is_integer(slave_position) and is_integer(alias) do
-    GenServer.call(
-      __MODULE__,
-      {:command, "alias", ["-p", to_string(slave_position), to_string(alias)]}
-    )
+    command("alias", ["-p", to_string(slave_position), to_string(alias)])
   end
 
   @doc """
@@ -93,16 +125,19 @@ defmodule EthercatEx.Cli do
   Returns `{:ok, output}` or `{:error, {code, reason}}`.
   """
   def list_configs do
-    GenServer.call(__MODULE__, {:command, "config", []})
+    command("config", [])
   end
 
   @doc """
   Performs CRC error register diagnosis.
 
+  Forks the tool, which reads the slaves one by one; on an active master
+  `EthercatEx.crc_counters/1` reads all of them in one register batch.
+
   Returns `{:ok, output}` or `{:error, {code, reason}}`.
   """
   def diagnose_crc do
-    GenServer.call(__MODULE__, {:command, "crc", []})
+    command("crc", [])
   end
 
   @doc """
@@ -111,7 +146,7 @@ defmodule EthercatEx.Cli do
   Returns `{:ok, c_code}` or `{:error, {code, reason}}`.
   """
   def generate_cstruct do
-    GenServer.call(__MODULE__, {:command, "cstruct", []})
+    command("cstruct", [])
   end
 
   @doc """
@@ -120,7 +155,7 @@ defmodule EthercatEx.Cli do
   Returns `{:ok, binary_data}` or `{:error, {code, reason}}`.
   """
   def get_domain_data do
-    GenServer.call(__MODULE__, {:command, "data", []})
+    command("data", [])
   end
 
   @doc """
@@ -132,7 +167,7 @@ defmodule EthercatEx.Cli do
   Returns `:ok` or `{:error, {code, reason}}`.
   """
   def set_debug_level(level) when is_integer(level) do
-    GenServer.call(__MODULE__, {:command, "debug", [to_string(level)]})
+    command("debug", [to_string(level)])
   end
 
   @doc """
@@ -141,34 +176,37 @@ defmodule EthercatEx.Cli do
   Returns `{:ok, output}` or `{:error, {code, reason}}`.
   """
   def list_domains do
-    GenServer.call(__MODULE__, {:command, "domains", []})
+    command("domains", [])
   end
 
   @doc """
   Writes an SDO entry to a slave.
 
+  Integer entries are served by the `ethercat_port` helper without a fork; for an entry of
+  1, 2, 4 or 8 bytes without `:type` it writes an unsigned integer of the entry's size.
+
   ## Parameters
     - `slave_position`: Integer position of the slave (e.g., 0).
-    - `sdo_address`: String SDO address (e.g., "0x7000:01").
+    - `sdo_address`: String SDO address with a hexadecimal subindex (e.g., "0x7000:01").
     - `value`: Integer or string value to write.
+    - `opts`: `type: "int16"` etc. to give the data type instead of looking it up.
 
   Returns `:ok` or `{:error, {code, reason}}`.
   """
-  def write_sdo(slave_position, sdo_address, value)
+  def write_sdo(slave_position, sdo_address, value, opts \\ [])
       when is_integer(slave_position) and is_binary(sdo_address) do
-    GenServer.call(
-      __MODULE__,
-      {:command, "download", ["-p", to_string(slave_position), sdo_address, to_string(value)]}
-    )
+    command("download", sdo_args(slave_position, sdo_address, opts) ++ [to_string(value)])
   end
 
   @doc """
   Displays Ethernet over EtherCAT (EoE) statistics.
 
+  `EthercatEx.Eoe.stats/1` reads the counters of the EoE interfaces without running the tool.
+
   Returns `{:ok, output}` or `{:error, {code, reason}}`.
   """
   def eoe_stats do
-    GenServer.call(__MODULE__, {:command, "eoe", []})
+    command("eoe", [])
   end
 
   @doc """
@@ -182,10 +220,7 @@ defmodule EthercatEx.Cli do
   """
   def foe_read(slave_position, filename)
       when is_integer(slave_position) and is_binary(filename) do
-    GenServer.call(
-      __MODULE__,
-      {:command, "foe_read", ["-p", to_string(slave_position), filename]}
-    )
+    command("foe_read", ["-p", to_string(slave_position), filename])
   end
 
   @doc """
@@ -199,24 +234,26 @@ defmodule EthercatEx.Cli do
   """
   def foe_write(slave_position, filename)
       when is_integer(slave_position) and is_binary(filename) do
-    GenServer.call(
-      __MODULE__,
-      {:command, "foe_write", ["-p", to_string(slave_position), filename]}
-    )
+    command("foe_write", ["-p", to_string(slave_position), filename])
   end
 
   @doc """
   Outputs the bus topology as a graph.
 
+  Cached by `EthercatEx.Inventory` until the bus changes.
+
   Returns `{:ok, graph_data}` or `{:error, {code, reason}}`.
   """
   def bus_topology do
-    GenServer.call(__MODULE__, {:command, "graph", []})
+    Inventory.fetch(:cli, :topology, fn -> command("graph", []) end)
   end
 
   @doc """
   Sets EoE IP parameters for a slave.
 
+  To have the master send them itself whenever it configures the slave, use the `:eoe` option
+  of `EthercatEx.configure_slave/3` instead.
+
   ## Parameters
     - `slave_position`: Integer position of the slave (e.g., 0).
     - `ip_params`: String IP parameters (e.g., "192.168.1.100").
@@ -225,7 +262,7 @@ defmodule EthercatEx.Cli do
   """
   def set_eoe_ip(slave_position, ip_params)
       when is_integer(slave_position) and is_binary(ip_params) do
-    GenServer.call(__MODULE__, {:command, "ip", ["-p", to_string(slave_position), ip_params]})
+    command("ip", ["-p", to_string(slave_position), ip_params])
   end
 
   @doc """
@@ -234,7 +271,7 @@ defmodule EthercatEx.Cli do
   Returns `{:ok, output}` or `{:error, {code, reason}}`.
   """
   def master_info do
-    GenServer.call(__MODULE__, {:command, "master", []})
+    command("master", [])
   end
 
   @doc """
@@ -243,10 +280,10 @@ defmodule EthercatEx.Cli do
   ## Parameters
     - `slave_position`: Integer position of the slave (e.g., 0).
 
-  Returns `{:ok, output}` or `{:error, {code, reason}}`.
+  Returns `{:ok, [%EthercatEx.Cli.Pdo{}]}` in sync manager order or `{:error, {code, reason}}`.
   """
   def list_pdos(slave_position) when is_integer(slave_position) do
-    GenServer.call(__MODULE__, {:command, "pdos", ["-p", to_string(slave_position)]})
+    command("pdos", ["-p", to_string(slave_position)])
   end
 
   @doc """
@@ -261,10 +298,7 @@ defmodule EthercatEx.Cli do
   """
   def read_register(slave_position, address, length)
       when is_integer(slave_position) and is_binary(address) and is_integer(length) do
-    GenServer.call(
-      __MODULE__,
-      {:command, "reg_read", ["-p", to_string(slave_position), address, to_string(length)]}
-    )
+    command("reg_read", ["-p", to_string(slave_position), address, to_string(length)])
   end
 
   @doc """
@@ -279,19 +313,20 @@ defmodule EthercatEx.Cli do
   """
   def write_register(slave_position, address, data)
       when is_integer(slave_position) and is_binary(address) do
-    GenServer.call(
-      __MODULE__,
-      {:command, "reg_write", ["-p", to_string(slave_position), address, data]}
-    )
+    command("reg_write", ["-p", to_string(slave_position), address, data])
   end
 
   @doc """
   Rescans the EtherCAT bus to load ESI files or detect new slaves.
 
+  Drops everything cached by `EthercatEx.Inventory`.
+
   Returns `:ok` or `{:error, {code, reason}}`.
   """
   def rescan do
-    GenServer.call(__MODULE__, {:command, "rescan", []})
+    with :ok <- command("rescan", []) do
+      Inventory.invalidate()
+    end
   end
 
   @doc """
@@ -300,10 +335,10 @@ defmodule EthercatEx.Cli do
   ## Parameters
     - `slave_position`: Integer position of the slave (e.g., 0).
 
-  Returns `{:ok, output}` or `{:error, {code, reason}}`.
+  Returns `{:ok, [%EthercatEx.Cli.SdoEntry{}]}`, one per object entry, or `{:error, {code, reason}}`.
   """
   def list_sdos(slave_position) when is_integer(slave_position) do
-    GenServer.call(__MODULE__, {:command, "sdos", ["-p", to_string(slave_position)]})
+    command("sdos", ["-p", to_string(slave_position)])
   end
 
   @doc """
@@ -315,7 +350,7 @@ defmodule EthercatEx.Cli do
   Returns `{:ok, output}` or `{:error, {code, reason}}`.
   """
   def read_sii(slave_position) when is_integer(slave_position) do
-    GenServer.call(__MODULE__, {:command, "sii_read", ["-p", to_string(slave_position)]})
+    command("sii_read", ["-p", to_string(slave_position)])
   end
 
   @doc """
@@ -328,16 +363,18 @@ defmodule EthercatEx.Cli do
   Returns `:ok` or `{:error, {code, reason}}`.
   """
   def write_sii(slave_position, data) when is_integer(slave_position) and is_binary(data) do
-    GenServer.call(__MODULE__, {:command, "sii_write", ["-p", to_string(slave_position), data]})
+    command("sii_write", ["-p", to_string(slave_position), data])
   end
 
   @doc """
   Displays slaves on the EtherCAT bus.
 
-  Returns `{:ok, output}` or `{:error, {code, reason}}`.
+  Cached by `EthercatEx.Inventory` until the bus changes.
+
+  Returns `{:ok, [%EthercatEx.Cli.Slave{}]}` in bus order or `{:error, {code, reason}}`.
   """
   def list_slaves do
-    GenServer.call(__MODULE__, {:command, "slaves", []})
+    Inventory.slaves(:cli, & &1.position, fn -> command("slaves", []) end)
   end
 
   @doc """
@@ -350,7 +387,7 @@ defmodule EthercatEx.Cli do
   Returns `{:ok, output}` or `{:error, {code, reason}}`.
   """
   def read_soe(slave_position, idn) when is_integer(slave_position) and is_binary(idn) do
-    GenServer.call(__MODULE__, {:command, "soe_read", ["-p", to_string(slave_position), idn]})
+    command("soe_read", ["-p", to_string(slave_position), idn])
   end
 
   @doc """
@@ -365,39 +402,47 @@ defmodule EthercatEx.Cli do
   """
   def write_soe(slave_position, idn, value)
       when is_integer(slave_position) and is_binary(idn) do
-    GenServer.call(
-      __MODULE__,
-      {:command, "soe_write", ["-p", to_string(slave_position), idn, value]}
-    )
+    command("soe_write", ["-p", to_string(slave_position), idn, value])
   end
 
   @doc """
   Requests application-layer states for slaves.
 
+  Only asks the master for the transition; see `EthercatEx.States` to wait until the slaves are
+  there.
+
   ## Parameters
     - `state`: String state to request (e.g., "INIT", "PREOP", "SAFEOP", "OP").
+    - `slave_position`: Integer position of a single slave, or `nil` for all of them.
 
   Returns `:ok` or `{:error, {code, reason}}`.
   """
-  def request_state(state) when is_binary(state) do
-    GenServer.call(__MODULE__, {:command, "states", [state]})
+  def request_state(state, slave_position \\ nil)
+
+  def request_state(state, nil) when is_binary(state) do
+    command("states", [state])
+  end
+
+  def request_state(state, slave_position) when is_binary(state) and is_integer(slave_position) do
+    command("states", ["-p", to_string(slave_position), state])
   end
 
   @doc """
   Reads an SDO entry from a slave.
 
+  Integer entries are served by the `ethercat_port` helper without a fork; without `:type`
+  an entry of 1, 2, 4 or 8 bytes is read as an unsigned integer of that size.
+
   ## Parameters
     - `slave_position`: Integer position of the slave (e.g., 0).
-    - `sdo_address`: String SDO address (e.g., "0x6000:01").
+    - `sdo_address`: String SDO address with a hexadecimal subindex (e.g., "0x6000:01").
+    - `opts`: `type: "int16"` etc. to give the data type instead of looking it up.
 
   Returns `{:ok, value}` or `{:error, {code, reason}}`.
   """
-  def read_sdo(slave_position, sdo_address)
+  def read_sdo(slave_position, sdo_address, opts \\ [])
       when is_integer(slave_position) and is_binary(sdo_address) do
-    GenServer.call(
-      __MODULE__,
-      {:command, "upload", ["-p", to_string(slave_position), sdo_address]}
-    )
+    command("upload", sdo_args(slave_position, sdo_address, opts))
   end
 
   @doc """
@@ -406,22 +451,68 @@ defmodule EthercatEx.Cli do
   Returns `{:ok, version}` or `{:error, {code, reason}}`.
   """
   def version do
-    GenServer.call(__MODULE__, {:command, "version", []})
+    command("version", [])
   end
 
   @doc """
   Generates slave information XML.
 
+  Cached by `EthercatEx.Inventory` until the bus changes.
+
   Returns `{:ok, xml}` or `{:error, {code, reason}}`.
   """
   def generate_xml do
-    GenServer.call(__MODULE__, {:command, "xml", []})
+    Inventory.fetch(:cli, :xml, fn -> command("xml", []) end)
   end
 
-  # Server Callbacks
+  # Supervisor Callbacks
 
-  @doc false
+  @impl Supervisor
   def init(opts) do
+    config = config(opts)
+    transfer_workers = Keyword.get(opts, :transfer_workers, master_count(config.master))
+
+    poller =
+      case Keyword.get(opts, :poll) do
+        nil -> []
+        poll -> [{Poller, poll}]
+      end
+
+    coprocess =
+      case Keyword.get(opts, :coprocess, true) do
+        false -> []
+        true -> [{Coprocess, master: config.master}]
+        path -> [{Coprocess, master: config.master, path: path}]
+      end
+
+    children =
+      [
+        {Task.Supervisor, name: EthercatEx.Cli.TaskSupervisor},
+        {Lane,
+         name: EthercatEx.Cli.FastLane, config: config, size: Keyword.get(opts, :fast_workers, 4)},
+        {Lane, name: EthercatEx.Cli.TransferLane, config: config, size: transfer_workers},
+        {Inventory,
+         interval: Keyword.get(opts, :inventory_interval, 500),
+         tool_interval: Keyword.get(opts, :inventory_tool_interval, 5_000)}
+      ] ++ coprocess ++ poller
+
+    Supervisor.init(children, strategy: :one_for_all)
+  end
+
+  @doc false
+  # Routes a command to its lane: FoE, SII and SDO dictionary transfers may
+  # take minutes and get no timeout, everything else uses the fast lane.
+  def command(command, args) when command in @transfer_commands do
+    GenServer.call(EthercatEx.Cli.TransferLane, {:command, command, args}, :infinity)
+  end
+
+  def command(command, args) do
+    GenServer.call(EthercatEx.Cli.FastLane, {:command, command, args})
+  end
+
+  # Private Functions
+
+  defp config(opts) do
     binary_path =
       Keyword.get(
         opts,
@@ -436,59 +527,76 @@ defmodule EthercatEx.Cli do
     verbose = Keyword.get(opts, :verbose, Application.get_env(:ethercat_ex, :verbose, false))
     quiet = Keyword.get(opts, :quiet, Application.get_env(:ethercat_ex, :quiet, false))
     force = Keyword.get(opts, :force, Application.get_env(:ethercat_ex, :force, false))
-    poll = Keyword.get(opts, :poll, nil)
 
-    state = %{
+    %{
       binary_path: binary_path,
       esi_dir: esi_dir,
       master: master,
       verbose: verbose,
       quiet: quiet,
       force: force,
-      poll: poll
+      base_args: base_args(master, verbose, quiet, force)
     }
+  end
 
-    # Schedule periodic command if specified
-    if poll do
-      schedule_poll(poll)
-    end
+  # The tool takes index and subindex as two arguments; "0x6000:01" reads
+  # like the ESI, with a hexadecimal subindex.
+  defp sdo_args(slave_position, sdo_address, opts) do
+    type = if type = Keyword.get(opts, :type), do: ["-t", type], else: []
 
-    {:ok, state}
-  end
+    address =
+      case String.split(sdo_address, ":", parts: 2) do
+        [index, "0x" <> _ = subindex] -> [index, subindex]
+        [index, subindex] -> [index, "0x" <> subindex]
+        [address] -> [address]
+      end
 
-  @doc false
-  def handle_call({:command, command, args}, _from, state) do
-    result = run_command(command, args, state)
-    {:reply, result, state}
+    ["-p", to_string(slave_position)] ++ type ++ address
   end
 
-  @doc false
-  def handle_info(:poll, %{poll: poll} = state) do
-    command = Keyword.get(poll, :command)
-    args = Keyword.get(poll, :args, [])
-    callback = Keyword.get(poll, :callback, fn _ -> :ok end)
-
-    case run_command(command, args, state) do
-      {:ok, output} -> callback.(output)
-      # Log error if needed
-      {:error, _} -> :ok
-    end
+  # "-" selects all masters; ranges such as "0-2" count each one.
+  defp master_count(master) do
+    case String.split(master, "-") do
+      [first, last] when first != "" and last != "" ->
+        max(String.to_integer(last) - String.to_integer(first) + 1, 1)
 
-    schedule_poll(poll)
-    {:noreply, state}
+      _ ->
+        1
+    end
   end
 
-  # Private Functions
-
-  defp run_command(command, args, state) do
-    base_args = ["-m", state.master]
-    base_args = if state.verbose, do: base_args ++ ["-v"], else: base_args
-    base_args = if state.quiet, do: base_args ++ ["-q"], else: base_args
-    base_args = if state.force, do: base_args ++ ["-f"], else: base_args
+  defp base_args(master, verbose, quiet, force) do
+    flags = [{verbose, "-v"}, {quiet, "-q"}, {force, "-f"}]
+    ["-m", master | for({true, flag} <- flags, do: flag)]
+  end
 
-    all_args = base_args ++ [command | args]
+  @doc false
+  # Runs a command on `EthercatEx.Cli.Coprocess` if it serves it, and forks
+  # the tool otherwise. Both produce the same output format.
+  def run_command(command, args, state) do
+    into =
+      case Map.fetch(@parsed_commands, command) do
+        {:ok, kind} -> Parser.new(kind)
+        :error -> ""
+      end
+
+    result =
+      case Coprocess.run(state.master, command, args) do
+        {output, code} ->
+          {Enum.into([output], into), code}
+
+        :unsupported ->
+          all_args = state.base_args ++ [command | args]
+          MuonTrap.cmd(state.binary_path, all_args, stderr_to_stdout: true, into: into)
+      end
+
+    case result do
+      {%Parser{} = parser, code} ->
+        case Parser.finish(parser) do
+          {items, _unparsed} when code == 0 -> {:ok, items}
+          {_items, unparsed} -> {:error, {code, unparsed}}
+        end
 
-    case MuonTrap.cmd(state.binary_path, all_args, stderr_to_stdout: true) do
       {output, 0} ->
         if command in [
              "download",
@@ -508,9 +616,4 @@ defmodule EthercatEx.Cli do
         {:error, {code, String.trim(error)}}
     end
   end
-
-  defp schedule_poll(poll) do
-    interval = Keyword.get(poll, :interval, 1000)
-    Process.send_after(self(), :poll, interval)
-  end
 end
@@ -0,0 +1,131 @@
+defmodule EthercatEx.Cli.Coprocess do
+  @moduledoc false
+  # Owns the `ethercat_port` helper (c_src/port/ethercat_port.cpp), which
+  # keeps the master device open and answers `ethercat` tool commands over
+  # a {:packet, 4} port, so `EthercatEx.Cli.run_command/3` does not fork a
+  # tool process per call.
+  #
+  # The helper runs one request at a time. Rather than queueing the fast
+  # lane's workers behind a slow one, a request arriving while another is
+  # in flight comes back as `:unsupported` and is run through the tool, as
+  # are commands the helper does not serve and every command while it is
+  # not running. A request the helper has not answered within `:timeout` ms
+  # goes to the tool as well; the helper counts as busy until its reply
+  # arrives. A helper that exits is respawned on demand, at most every
+  # @respawn_interval ms, so a missing master device does not cost a spawn
+  # per call.
+
+  use GenServer
+
+  @unsupported 255
+  @respawn_interval 5_000
+
+  def start_link(opts) do
+    GenServer.start_link(__MODULE__, opts, name: __MODULE__)
+  end
+
+  @doc """
+  Runs `command` on the helper for `master` (the master option of the tool,
+  e.g. `"0"`). Returns `{output, exit_code}` like `MuonTrap.cmd/3`, or
+  `:unsupported`.
+  """
+  def run(master, command, args) do
+    case Process.whereis(__MODULE__) do
+      nil -> :unsupported
+      # Always answered, at the latest once the request timed out.
+      pid -> GenServer.call(pid, {:run, master, [command | args]}, :infinity)
+    end
+  end
+
+  @impl GenServer
+  def init(opts) do
+    path =
+      Keyword.get_lazy(opts, :path, fn ->
+        Application.app_dir(:ethercat_ex, "priv/ethercat_port")
+      end)
+
+    state = %{
+      path: path,
+      master: Keyword.fetch!(opts, :master),
+      timeout: Keyword.get(opts, :timeout, 2_000),
+      port: nil,
+      retry_at: System.monotonic_time(:millisecond),
+      # %{from: caller, or nil once answered, timer: reference} while the
+      # helper works on a request
+      in_flight: nil
+    }
+
+    {:ok, state}
+  end
+
+  @impl GenServer
+  def handle_call({:run, master, argv}, from, %{master: master, in_flight: nil} = state) do
+    case ensure_port(state) do
+      %{port: nil} = state ->
+        {:reply, :unsupported, state}
+
+      %{port: port} = state ->
+        Port.command(port, Enum.map(argv, &[&1, 0]))
+        timer = Process.send_after(self(), {:timeout, from}, state.timeout)
+        {:noreply, %{state | in_flight: %{from: from, timer: timer}}}
+    end
+  end
+
+  def handle_call({:run, _master, _argv}, _from, state), do: {:reply, :unsupported, state}
+
+  @impl GenServer
+  def handle_info({port, {:data, <<status, output::binary>>}}, %{port: port} = state) do
+    reply = if status == @unsupported, do: :unsupported, else: {output, status}
+    {:noreply, answer(state, reply)}
+  end
+
+  def handle_info({port, {:exit_status, _status}}, %{port: port} = state) do
+    # Whatever was in flight is retried through the tool.
+    state = answer(state, :unsupported)
+    retry_at = System.monotonic_time(:millisecond) + @respawn_interval
+    {:noreply, %{state | port: nil, retry_at: retry_at}}
+  end
+
+  def handle_info({:timeout, from}, %{in_flight: %{from: from} = in_flight} = state) do
+    GenServer.reply(from, :unsupported)
+    {:noreply, %{state | in_flight: %{in_flight | from: nil}}}
+  end
+
+  def handle_info(_message, state), do: {:noreply, state}
+
+  defp answer(%{in_flight: nil} = state, _reply), do: state
+
+  defp answer(%{in_flight: %{from: from, timer: timer}} = state, reply) do
+    Process.cancel_timer(timer)
+    if from, do: GenServer.reply(from, reply)
+    %{state | in_flight: nil}
+  end
+
+  defp ensure_port(%{port: nil} = state) do
+    now = System.monotonic_time(:millisecond)
+
+    cond do
+      now < state.retry_at ->
+        state
+
+      not single_master?(state.master) or not File.exists?(state.path) ->
+        # Never going to work; stop looking.
+        %{state | retry_at: :infinity}
+
+      true ->
+        port =
+          Port.open({:spawn_executable, state.path}, [
+            :binary,
+            :exit_status,
+            packet: 4,
+            args: [state.master]
+          ])
+
+        %{state | port: port}
+    end
+  end
+
+  defp ensure_port(state), do: state
+
+  defp single_master?(master), do: match?({_index, ""}, Integer.parse(master))
+end
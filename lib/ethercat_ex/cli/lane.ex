@@ -0,0 +1,77 @@
+defmodule EthercatEx.Cli.Lane do
+  @moduledoc false
+  # A bounded pool of `ethercat` command workers.
+  #
+  # Each command runs in its own task under `EthercatEx.Cli.TaskSupervisor`,
+  # so the lane process itself never blocks. At most `:size` commands run at
+  # once; further callers queue in arrival order and are answered as soon as
+  # their command completes.
+
+  use GenServer
+
+  alias EthercatEx.Cli
+
+  def child_spec(opts) do
+    %{id: Keyword.fetch!(opts, :name), start: {__MODULE__, :start_link, [opts]}}
+  end
+
+  def start_link(opts) do
+    GenServer.start_link(__MODULE__, opts, name: Keyword.fetch!(opts, :name))
+  end
+
+  @impl GenServer
+  def init(opts) do
+    state = %{
+      config: Keyword.fetch!(opts, :config),
+      size: max(Keyword.fetch!(opts, :size), 1),
+      running: %{},
+      queue: :queue.new()
+    }
+
+    {:ok, state}
+  end
+
+  @impl GenServer
+  def handle_call({:command, _command, _args} = request, from, state) do
+    if map_size(state.running) < state.size do
+      {:noreply, start(request, from, state)}
+    else
+      {:noreply, %{state | queue: :queue.in({request, from}, state.queue)}}
+    end
+  end
+
+  @impl GenServer
+  def handle_info({ref, result}, state) when is_map_key(state.running, ref) do
+    Process.demonitor(ref, [:flush])
+    {:noreply, finish(ref, result, state)}
+  end
+
+  def handle_info({:DOWN, ref, :process, _pid, reason}, state)
+      when is_map_key(state.running, ref) do
+    {:noreply, finish(ref, {:error, {:crashed, reason}}, state)}
+  end
+
+  def handle_info(_message, state), do: {:noreply, state}
+
+  defp start({:command, command, args}, from, state) do
+    config = state.config
+
+    task =
+      Task.Supervisor.async_nolink(EthercatEx.Cli.TaskSupervisor, fn ->
+        Cli.run_command(command, args, config)
+      end)
+
+    %{state | running: Map.put(state.running, task.ref, from)}
+  end
+
+  defp finish(ref, result, state) do
+    {from, running} = Map.pop(state.running, ref)
+    GenServer.reply(from, result)
+    state = %{state | running: running}
+
+    case :queue.out(state.queue) do
+      {{:value, {request, next}}, queue} -> start(request, next, %{state | queue: queue})
+      {:empty, _queue} -> state
+    end
+  end
+end
@@ -0,0 +1,325 @@
+defmodule EthercatEx.Cli.Parser do
+  @moduledoc """
+  Single-pass parsers for the text printed by `ethercat slaves`, `pdos` and `sdos`.
+
+  Output is consumed line by line as it arrives and each line is taken apart
+  with binary pattern matches, without regexes or intermediate strings. A
+  parser is a `Collectable`, so `EthercatEx.Cli` collects command output
+  straight into it and never builds the full text, and `stream/2` parses a
+  stream of chunks lazily:
+
+      File.stream!("sdos.txt", 65_536)
+      |> EthercatEx.Cli.Parser.stream(:sdos)
+      |> Enum.filter(&(&1.data_type == "uint16"))
+
+  Parsed names are copied out of the chunks they were read from, so holding
+  on to results does not keep the output alive. Lines that match no known
+  format are kept (up to a bound) as the error text of failed commands.
+  """
+
+  alias EthercatEx.Cli.{Pdo, SdoEntry, Slave}
+
+  defstruct [:kind, rest: "", state: nil, items: [], unparsed: [], unparsed_count: 0]
+
+  @type kind :: :slaves | :pdos | :sdos
+  @type t :: %__MODULE__{kind: kind()}
+
+  @max_unparsed 64
+
+  @doc """
+  Returns an empty parser for the output of `ethercat <kind>`.
+  """
+  @spec new(kind()) :: t()
+  def new(kind) when kind in [:slaves, :pdos, :sdos], do: %__MODULE__{kind: kind}
+
+  @doc """
+  Parses complete output, given as iodata.
+
+  ## Examples
+
+      iex> EthercatEx.Cli.Parser.parse(:slaves, "0  0:0  PREOP  +  EK1100 EtherCAT Coupler\\n")
+      [%EthercatEx.Cli.Slave{position: 0, alias: 0, relative_position: 0,
+        state: :pre_operational, error: false, name: "EK1100 EtherCAT Coupler"}]
+  """
+  @spec parse(kind(), iodata()) :: [Slave.t() | Pdo.t() | SdoEntry.t()]
+  def parse(kind, output) do
+    {items, _unparsed} = kind |> new() |> feed(output) |> finish()
+    items
+  end
+
+  @doc """
+  Lazily parses a stream of output chunks. Chunks may split lines anywhere.
+  """
+  @spec stream(Enumerable.t(), kind()) :: Enumerable.t()
+  def stream(chunks, kind) do
+    chunks
+    |> Stream.concat([:eof])
+    |> Stream.transform(new(kind), fn
+      :eof, parser ->
+        {items, _unparsed} = finish(parser)
+        {items, new(kind)}
+
+      chunk, parser ->
+        parser = feed(parser, chunk)
+        {Enum.reverse(parser.items), %{parser | items: []}}
+    end)
+  end
+
+  @doc """
+  Feeds a chunk of output to the parser.
+  """
+  @spec feed(t(), iodata()) :: t()
+  def feed(%__MODULE__{} = parser, chunk) do
+    data = IO.iodata_to_binary([parser.rest | chunk])
+    lines(data, %{parser | rest: ""})
+  end
+
+  @doc """
+  Parses whatever is left and returns the items in output order together
+  with the lines that matched no known format.
+  """
+  @spec finish(t()) :: {[Slave.t() | Pdo.t() | SdoEntry.t()], String.t()}
+  def finish(%__MODULE__{} = parser) do
+    parser = parser |> line(parser.rest) |> close_pdo()
+    {Enum.reverse(parser.items), parser.unparsed |> Enum.reverse() |> Enum.join("\n")}
+  end
+
+  defp lines(data, parser) do
+    case :binary.match(data, "\n") do
+      {at, 1} ->
+        <<line::binary-size(at), ?\n, rest::binary>> = data
+        lines(rest, line(parser, line))
+
+      :nomatch ->
+        %{parser | rest: :binary.copy(data)}
+    end
+  end
+
+  defp line(parser, line) do
+    case skip_spaces(line) do
+      "" ->
+        parser
+
+      _line ->
+        case parse_line(parser.kind, line, parser.state) do
+          {:item, item, state} -> %{parser | items: [item | parser.items], state: state}
+          {:state, state} -> %{parser | state: state}
+          :error -> unparsed(parser, line)
+        end
+    end
+  end
+
+  defp unparsed(%{unparsed_count: count} = parser, _line) when count >= @max_unparsed, do: parser
+
+  defp unparsed(parser, line) do
+    %{parser | unparsed: [copy(line) | parser.unparsed], unparsed_count: parser.unparsed_count + 1}
+  end
+
+  # A PDO is complete once the next PDO or sync manager starts; the state
+  # is `{sync_manager, pdo}` with the entries of `pdo` in reverse order.
+  defp close_pdo(%{kind: :pdos, state: {sm, %Pdo{} = pdo}} = parser) do
+    pdo = %{pdo | entries: Enum.reverse(pdo.entries)}
+    %{parser | items: [pdo | parser.items], state: {sm, nil}}
+  end
+
+  defp close_pdo(parser), do: parser
+
+  ## ethercat slaves
+  #
+  #   0  0:0  PREOP  +  EK1100 EtherCAT-Koppler (2A E-Bus)
+
+  defp parse_line(:slaves, line, state) do
+    with {position, rest} <- integer(skip_spaces(line)),
+         {alias, <<?:, rest::binary>>} <- integer(skip_spaces(rest)),
+         {relative, rest} <- integer(rest),
+         {al_state, rest} <- word(skip_spaces(rest)),
+         <<flag, rest::binary>> when flag in [?+, ?E] <- skip_spaces(rest) do
+      slave = %Slave{
+        position: position,
+        alias: alias,
+        relative_position: relative,
+        state: al_state(al_state),
+        error: flag == ?E,
+        name: copy(skip_spaces(rest))
+      }
+
+      {:item, slave, state}
+    else
+      _ -> :error
+    end
+  end
+
+  ## ethercat pdos
+  #
+  #   SM2: PhysAddr 0x1100, DefaultSize    0, ControlRegister 0x24, Enable 1
+  #     RxPDO 0x1600 "Channel 1"
+  #       PDO entry 0x7000:01,  1 bit, "Output"
+
+  defp parse_line(:pdos, <<"SM", rest::binary>>, state) do
+    case integer(rest) do
+      {sm, <<?:, _rest::binary>>} -> next_pdo(state, {sm, nil})
+      _ -> :error
+    end
+  end
+
+  defp parse_line(:pdos, line, {sm, pdo} = state) do
+    case skip_spaces(line) do
+      <<"PDO entry ", rest::binary>> when pdo != nil ->
+        with {index, <<?:, rest::binary>>} <- hex(rest),
+             {subindex, <<?,, rest::binary>>} <- hex_digits(rest),
+             {bits, <<" bit,", rest::binary>>} <- integer(skip_spaces(rest)),
+             {:ok, name} <- quoted(skip_spaces(rest)) do
+          entry = %{index: index, subindex: subindex, bit_length: bits, name: name}
+          {:state, {sm, %{pdo | entries: [entry | pdo.entries]}}}
+        else
+          _ -> :error
+        end
+
+      <<x, "xPDO ", rest::binary>> when x in [?R, ?T] ->
+        with {index, rest} <- hex(rest), {:ok, name} <- quoted(skip_spaces(rest)) do
+          direction = if x == ?R, do: :output, else: :input
+          next = %Pdo{sync_manager: sm, direction: direction, index: index, name: name}
+          next_pdo(state, {sm, next})
+        else
+          _ -> :error
+        end
+
+      _ ->
+        :error
+    end
+  end
+
+  ## ethercat sdos
+  #
+  #   SDO 0x1018, "Identity"
+  #     0x1018:01, r-r-r-, uint32, 32 bit, "Vendor ID"
+
+  defp parse_line(:sdos, <<"SDO ", rest::binary>>, _state) do
+    with {_index, <<?,, rest::binary>>} <- hex(rest),
+         {:ok, name} <- quoted(skip_spaces(rest)) do
+      {:state, name}
+    else
+      _ -> :error
+    end
+  end
+
+  defp parse_line(:sdos, line, object_name) do
+    with {index, <<?:, rest::binary>>} <- hex(skip_spaces(line)),
+         {subindex, <<", ", access::binary-size(6), ", ", rest::binary>>} <- hex_digits(rest),
+         {data_type, rest} <- until_comma(rest),
+         {bits, <<" bit,", rest::binary>>} <- integer(skip_spaces(rest)),
+         {:ok, name} <- quoted(skip_spaces(rest)) do
+      entry = %SdoEntry{
+        index: index,
+        subindex: subindex,
+        object_name: object_name,
+        access: copy(access),
+        data_type: copy(data_type),
+        bit_length: bits,
+        name: name
+      }
+
+      {:item, entry, object_name}
+    else
+      _ -> :error
+    end
+  end
+
+  defp parse_line(_kind, _line, _state), do: :error
+
+  # Emits the PDO being collected, if any, and moves on to `next`.
+  defp next_pdo(state, next) do
+    case close_pdo(%__MODULE__{kind: :pdos, state: state}) do
+      %{items: [pdo]} -> {:item, pdo, next}
+      %{items: []} -> {:state, next}
+    end
+  end
+
+  ## Lexing
+
+  defp skip_spaces(<<c, rest::binary>>) when c in [?\s, ?\t, ?\r], do: skip_spaces(rest)
+  defp skip_spaces(rest), do: rest
+
+  defp integer(data), do: integer(data, 0, false)
+
+  defp integer(<<c, rest::binary>>, acc, _digits?) when c in ?0..?9,
+    do: integer(rest, acc * 10 + c - ?0, true)
+
+  defp integer(rest, acc, true), do: {acc, rest}
+  defp integer(_rest, _acc, false), do: :error
+
+  defp hex(<<"0x", rest::binary>>), do: hex_digits(rest)
+  defp hex(_data), do: :error
+
+  defp hex_digits(data), do: hex_digits(data, 0, false)
+
+  defp hex_digits(<<c, rest::binary>>, acc, _digits?) when c in ?0..?9,
+    do: hex_digits(rest, acc * 16 + c - ?0, true)
+
+  defp hex_digits(<<c, rest::binary>>, acc, _digits?) when c in ?a..?f,
+    do: hex_digits(rest, acc * 16 + c - ?a + 10, true)
+
+  defp hex_digits(<<c, rest::binary>>, acc, _digits?) when c in ?A..?F,
+    do: hex_digits(rest, acc * 16 + c - ?A + 10, true)
+
+  defp hex_digits(rest, acc, true), do: {acc, rest}
+  defp hex_digits(_rest, _acc, false), do: :error
+
+  defp word(data) do
+    case :binary.match(data, " ") do
+      {at, 1} when at > 0 -> {binary_part(data, 0, at), binary_part(data, at, byte_size(data) - at)}
+      _ -> :error
+    end
+  end
+
+  defp until_comma(data) do
+    case :binary.match(data, ",") do
+      {at, 1} -> {binary_part(data, 0, at), binary_part(data, at + 1, byte_size(data) - at - 1)}
+      :nomatch -> :error
+    end
+  end
+
+  # The closing quote is the last character of the line; names may contain
+  # quotes themselves.
+  defp quoted(<<?", rest::binary>>) do
+    name = skip_trailing(rest)
+    size = byte_size(name)
+
+    if size > 0 and :binary.last(name) == ?",
+      do: {:ok, copy(binary_part(name, 0, size - 1))},
+      else: :error
+  end
+
+  defp quoted(_data), do: :error
+
+  defp skip_trailing(data) do
+    size = byte_size(data)
+
+    if size > 0 and :binary.last(data) in [?\s, ?\r],
+      do: skip_trailing(binary_part(data, 0, size - 1)),
+      else: data
+  end
+
+  defp copy(data), do: :binary.copy(data)
+
+  defp al_state("INIT"), do: :init
+  defp al_state("PREOP"), do: :pre_operational
+  defp al_state("BOOT"), do: :bootstrap
+  defp al_state("SAFEOP"), do: :safe_operational
+  defp al_state("OP"), do: :operational
+  defp al_state(_state), do: :unknown
+end
+
+defimpl Collectable, for: EthercatEx.Cli.Parser do
+  alias EthercatEx.Cli.Parser
+
+  def into(parser) do
+    collector = fn
+      parser, {:cont, chunk} -> Parser.feed(parser, chunk)
+      parser, :done -> parser
+      _parser, :halt -> :ok
+    end
+
+    {parser, collector}
+  end
+end
@@ -0,0 +1,27 @@
+defmodule EthercatEx.Cli.Pdo do
+  @moduledoc """
+  A PDO as listed by `ethercat pdos`, see `EthercatEx.Cli.list_pdos/1`.
+
+  `:direction` is `:output` for RxPDOs and `:input` for TxPDOs, matching the
+  sync manager directions of `EthercatEx.configure_slave/2`. Entries are
+  maps with `:index`, `:subindex`, `:bit_length` and `:name`; gaps have index
+  `0`.
+  """
+
+  defstruct [:sync_manager, :direction, :index, :name, entries: []]
+
+  @type entry :: %{
+          index: non_neg_integer(),
+          subindex: non_neg_integer(),
+          bit_length: non_neg_integer(),
+          name: String.t()
+        }
+
+  @type t :: %__MODULE__{
+          sync_manager: non_neg_integer(),
+          direction: :input | :output,
+          index: non_neg_integer(),
+          name: String.t(),
+          entries: [entry()]
+        }
+end
@@ -0,0 +1,40 @@
+defmodule EthercatEx.Cli.Poller do
+  @moduledoc false
+  # Runs the `:poll` command of `EthercatEx.Cli.start_link/1` periodically
+  # through the regular command lanes.
+
+  use GenServer
+
+  alias EthercatEx.Cli
+
+  def start_link(poll) do
+    GenServer.start_link(__MODULE__, poll)
+  end
+
+  @impl GenServer
+  def init(poll) do
+    schedule_poll(poll)
+    {:ok, poll}
+  end
+
+  @impl GenServer
+  def handle_info(:poll, poll) do
+    command = Keyword.get(poll, :command)
+    args = Keyword.get(poll, :args, [])
+    callback = Keyword.get(poll, :callback, fn _ -> :ok end)
+
+    case Cli.command(command, args) do
+      {:ok, output} -> callback.(output)
+      # Log error if needed
+      {:error, _} -> :ok
+    end
+
+    schedule_poll(poll)
+    {:noreply, poll}
+  end
+
+  defp schedule_poll(poll) do
+    interval = Keyword.get(poll, :interval, 1000)
+    Process.send_after(self(), :poll, interval)
+  end
+end
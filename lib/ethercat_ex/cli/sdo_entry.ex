@@ -0,0 +1,23 @@
+defmodule EthercatEx.Cli.SdoEntry do
+  @moduledoc """
+  One entry of a slave's object dictionary as listed by `ethercat sdos`, see
+  `EthercatEx.Cli.list_sdos/1`.
+
+  `:object_name` is the name of the object the entry belongs to. `:access`
+  is the six character access string of the CLI: read and write flags for
+  PREOP, SAFEOP and OP, e.g. `"rwr-r-"`. `:data_type` is the CLI's type name
+  such as `"uint16"`, or `"type 0x0025"` for types it does not know.
+  """
+
+  defstruct [:index, :subindex, :object_name, :access, :data_type, :bit_length, :name]
+
+  @type t :: %__MODULE__{
+          index: non_neg_integer(),
+          subindex: non_neg_integer(),
+          object_name: String.t(),
+          access: String.t(),
+          data_type: String.t(),
+          bit_length: non_neg_integer(),
+          name: String.t()
+        }
+end
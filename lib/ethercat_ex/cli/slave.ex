@@ -0,0 +1,20 @@
+defmodule EthercatEx.Cli.Slave do
+  @moduledoc """
+  One line of `ethercat slaves` output, see `EthercatEx.Cli.list_slaves/0`.
+
+  `:state` uses the same atoms as `EthercatEx.status/0`; `:error` is `true`
+  when the slave reports the AL error flag.
+  """
+
+  defstruct [:position, :alias, :relative_position, :state, :error, :name]
+
+  @type t :: %__MODULE__{
+          position: non_neg_integer(),
+          alias: non_neg_integer(),
+          relative_position: non_neg_integer(),
+          state:
+            :init | :pre_operational | :bootstrap | :safe_operational | :operational | :unknown,
+          error: boolean(),
+          name: String.t()
+        }
+end
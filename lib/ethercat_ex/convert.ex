@@ -0,0 +1,182 @@
+defmodule EthercatEx.Convert do
+  @moduledoc """
+  Converts many process data entries to floats in one native call.
+
+  A conversion is prepared once from the entries of interest and then run on
+  whole domain images, returning a packed binary of native-endian float64
+  values, one per entry in the order given. It loads directly as a tensor:
+
+      {:ok, conv} =
+        EthercatEx.Convert.prepare([
+          {1, {0x6000, 0x11}, :int16},
+          {1, {0x6010, 0x11}, :int16},
+          {2, {0x6000, 0x01}, :bit}
+        ])
+
+      {:ok, values} = EthercatEx.Convert.read_f64(conv)
+      Nx.from_binary(values, :f64)
+
+  Preparing sorts the entries into runs of the same type lying back to back
+  in the image, converted as one contiguous loop, and per-type tables for
+  the rest, so running a conversion costs a few tight native loops however
+  many entries it has, instead of a binary match per entry in Elixir.
+
+  Types are `:bit`, `:uint8`, `:int8`, `:uint16`, `:int16`, `:uint32`,
+  `:int32`, `:uint64`, `:int64`, `:real32` and `:real64`; `:bit` converts to
+  `0.0` or `1.0`.
+  """
+
+  alias EthercatEx.Nif
+
+  defstruct [:plan, :domain, :count]
+
+  @type t :: %__MODULE__{plan: reference(), domain: non_neg_integer(), count: non_neg_integer()}
+
+  @types [
+    :bit,
+    :uint8,
+    :int8,
+    :uint16,
+    :int16,
+    :uint32,
+    :int32,
+    :uint64,
+    :int64,
+    :real32,
+    :real64
+  ]
+  @codes @types |> Enum.with_index() |> Map.new()
+  @bit_lengths %{
+    bit: 1,
+    uint8: 8,
+    int8: 8,
+    uint16: 16,
+    int16: 16,
+    uint32: 32,
+    int32: 32,
+    uint64: 64,
+    int64: 64,
+    real32: 32,
+    real64: 64
+  }
+
+  @doc """
+  Prepares a conversion.
+
+  Each entry is one of:
+
+    * `{slave_id, {index, subindex}, type}` - A PDO entry registered by
+      `EthercatEx.configure_slave/3`, looked up in the slave's layout. All of
+      them must be in the same domain, and the entry's bit length must match
+      `type`.
+    * `{offset, type}` or `{offset, bit_position, :bit}` - A byte offset into
+      the image of the domain given by the `:domain` option.
+
+  ## Options
+
+    * `:domain` - Domain of the offset entries (default: `0`).
+    * `:master` - Index of the master (default: `0`).
+
+  Returns `{:error, :unknown_entry}` for an entry the slave does not have,
+  `{:error, :size_mismatch}` for a type that does not fit the entry and
+  `{:error, :mixed_domains}` for entries from several domains.
+  """
+  def prepare(entries, opts \\ []) do
+    with {:ok, domain, specs} <- resolve(entries, opts) do
+      {:ok, plan} = Nif.convert_prepare(specs)
+      {:ok, %__MODULE__{plan: plan, domain: domain, count: length(specs)}}
+    end
+  end
+
+  @doc """
+  Runs a prepared conversion on a domain image, e.g. one from
+  `EthercatEx.Recorder.read/1`.
+
+  Returns the float64 binary, or `{:error, :size_mismatch}` if the image
+  does not reach every entry.
+  """
+  def to_f64(%__MODULE__{plan: plan}, image) when is_binary(image) do
+    Nif.convert_f64(plan, image)
+  end
+
+  @doc """
+  Runs a prepared conversion on the current image of its domain.
+
+  Returns `{:ok, binary}`. Takes the `:master` option of `prepare/2`.
+  """
+  def read_f64(%__MODULE__{domain: domain} = conv, opts \\ []) do
+    with {:ok, master} <- EthercatEx.fetch_master(Keyword.get(opts, :master, 0)),
+         {:ok, image} <- Nif.domain_image(master, domain) do
+      case to_f64(conv, image) do
+        values when is_binary(values) -> {:ok, values}
+        error -> error
+      end
+    end
+  end
+
+  defp resolve(entries, opts) do
+    default_domain = Keyword.get(opts, :domain, 0)
+
+    entries
+    |> Enum.reduce_while({:ok, nil, [], %{}}, fn entry, {:ok, domain, specs, layouts} ->
+      case resolve_entry(entry, layouts, opts) do
+        {:ok, entry_domain, spec, layouts} ->
+          entry_domain = entry_domain || default_domain
+
+          if domain in [nil, entry_domain],
+            do: {:cont, {:ok, entry_domain, [spec | specs], layouts}},
+            else: {:halt, {:error, :mixed_domains}}
+
+        error ->
+          {:halt, error}
+      end
+    end)
+    |> case do
+      {:ok, domain, specs, _layouts} -> {:ok, domain || default_domain, Enum.reverse(specs)}
+      error -> error
+    end
+  end
+
+  defp resolve_entry({offset, type}, layouts, _opts) when is_integer(offset) and type != :bit,
+    do: resolve_entry({offset, 0, type}, layouts, nil)
+
+  defp resolve_entry({offset, bit_position, type}, layouts, _opts)
+       when is_integer(offset) and offset >= 0 and bit_position in 0..7 and
+              is_map_key(@codes, type) do
+    {:ok, nil, {offset, bit_position, @codes[type]}, layouts}
+  end
+
+  defp resolve_entry({slave_id, {index, subindex}, type}, layouts, opts)
+       when is_map_key(@codes, type) do
+    with {:ok, layout, layouts} <- fetch_layout(slave_id, layouts, opts) do
+      expected = Map.fetch!(@bit_lengths, type)
+
+      case Enum.find(layout.entries, &(&1.index == index and &1.subindex == subindex)) do
+        nil ->
+          {:error, :unknown_entry}
+
+        %{bit_length: bit_length} when bit_length != expected ->
+          {:error, :size_mismatch}
+
+        %{bit_position: bit_position} when type != :bit and bit_position != 0 ->
+          {:error, :size_mismatch}
+
+        %{offset: offset, bit_position: bit_position} ->
+          {:ok, layout.domain, {offset, bit_position, @codes[type]}, layouts}
+      end
+    end
+  end
+
+  defp fetch_layout(slave_id, layouts, opts) do
+    case layouts do
+      %{^slave_id => layout} ->
+        {:ok, layout, layouts}
+
+      _ ->
+        with {:ok, master} <- EthercatEx.fetch_master(Keyword.get(opts, :master, 0)),
+             {:ok, layout} <- Nif.slave_layout(master, slave_id) do
+          {:ok, layout, Map.put(layouts, slave_id, layout)}
+        end
+    end
+  end
+end
@@ -0,0 +1,103 @@
+defmodule EthercatEx.DeltaStream do
+  @moduledoc """
+  Delta-compressed stream of the process image.
+
+  While streaming, every cycle's domain images are queued by the thread running the exchange
+  and sent to a process in batches, one `{:ethercat_stream, batch}` message per `:batch`
+  cycles. Within a batch each image is XOR'd against the one before it and only the changed
+  runs are kept, so an image that did not change costs two bytes, its cycle delta and a run
+  count of zero, as long as no more than 127 cycles were dropped before it. Every batch
+  decodes on its own with `decode/1`:
+
+      :ok = EthercatEx.DeltaStream.start(self(), batch: 100)
+
+      receive do
+        {:ethercat_stream, batch} ->
+          for {cycle, image} <- EthercatEx.DeltaStream.decode(batch), do: ...
+      end
+
+  The receiver must be a local process. To feed a remote node, forward the batches unchanged,
+  e.g. `send({:historian, node}, {:ethercat_stream, batch})`, and decode them there; the batch
+  is the compact wire format.
+
+  Images are the domain images back to back, in domain order, as in `EthercatEx.Recorder`.
+  Cycles the stream could not keep up with are dropped rather than delaying the exchange; the
+  cycle numbers show the gap.
+  """
+
+  import Bitwise
+
+  alias EthercatEx.Nif
+
+  @doc """
+  Starts streaming to `pid`, replacing any stream in progress. The master must be active. The
+  stream stops by itself when `pid` exits.
+
+  ## Options
+
+    * `:batch` - (Optional) Cycles per message, from 1 to 256 (default: `100`).
+    * `:master` - (Optional) Index of the master (default: `0`).
+  """
+  def start(pid, opts \\ []) do
+    with {:ok, master} <- EthercatEx.fetch_master(Keyword.get(opts, :master, 0)) do
+      Nif.stream_start(master, pid, Keyword.get(opts, :batch, 100))
+    end
+  end
+
+  @doc """
+  Stops streaming; cycles not sent yet are discarded. Takes the `:master` option.
+  """
+  def stop(opts \\ []) do
+    with {:ok, master} <- EthercatEx.fetch_master(Keyword.get(opts, :master, 0)) do
+      Nif.stream_stop(master)
+    end
+  end
+
+  @doc """
+  Decodes a batch into `[{cycle, image}]`, oldest first.
+
+  A batch is a version byte followed by LEB128 varints: image size, frame count and the cycle
+  of the first frame, then per frame the cycle delta, the run count and per run the count of
+  unchanged bytes since the previous run, the run length and the XOR bytes of the run.
+  """
+  def decode(<<1, rest::binary>>) do
+    {size, rest} = varint(rest)
+    {count, rest} = varint(rest)
+    {cycle, rest} = varint(rest)
+
+    frames(count, cycle, :binary.copy(<<0>>, size), [], rest)
+  end
+
+  defp frames(0, _cycle, _image, acc, <<>>), do: Enum.reverse(acc)
+
+  defp frames(count, cycle, image, acc, rest) do
+    {delta, rest} = varint(rest)
+    {runs, rest} = varint(rest)
+    {image, rest} = apply_runs(runs, image, 0, [], rest)
+    frames(count - 1, cycle + delta, image, [{cycle + delta, image} | acc], rest)
+  end
+
+  defp apply_runs(0, image, position, acc, rest) do
+    tail = binary_part(image, position, byte_size(image) - position)
+    {IO.iodata_to_binary(Enum.reverse([tail | acc])), rest}
+  end
+
+  defp apply_runs(runs, image, position, acc, rest) do
+    {zeros, rest} = varint(rest)
+    {length, rest} = varint(rest)
+    <<xor::binary-size(length), rest::binary>> = rest
+    at = position + zeros
+    bits = length * 8
+    <<old::size(bits)>> = binary_part(image, at, length)
+    <<mask::size(bits)>> = xor
+    acc = [<<bxor(old, mask)::size(bits)>>, binary_part(image, position, zeros) | acc]
+    apply_runs(runs - 1, image, at + length, acc, rest)
+  end
+
+  defp varint(<<0::1, value::7, rest::binary>>), do: {value, rest}
+
+  defp varint(<<1::1, low::7, rest::binary>>) do
+    {high, rest} = varint(rest)
+    {bor(low, high <<< 7), rest}
+  end
+end
@@ -0,0 +1,109 @@
+defmodule EthercatEx.Eoe do
+  @moduledoc """
+  Throughput of the Ethernet over EtherCAT (EoE) interfaces, without running the tool.
+
+  The master creates one network interface per EoE-capable slave, named `eoe<master>s<position>`
+  or `eoe<master>a<alias>` for a slave with an alias. `stats/1` reads their counters from
+  `/sys/class/net`, and `throughput/2` turns two samples into rates:
+
+      {:ok, before} = EthercatEx.Eoe.stats()
+      Process.sleep(1000)
+      {:ok, now} = EthercatEx.Eoe.stats()
+      EthercatEx.Eoe.throughput(before, now)
+      #=> %{"eoe0s3" => %{rx_rate: 1200.0, tx_rate: 48_000.0, tx_dropped: 0}}
+
+  Frames the interface could not queue, because the master lets EoE into the cycle more
+  slowly than it arrives, show in `:tx_dropped`; see the `:acyclic_budget` option of
+  `EthercatEx.activate/1` for how much it lets in.
+  """
+
+  @counters ~w(rx_bytes tx_bytes rx_packets tx_packets rx_dropped tx_dropped rx_errors tx_errors)a
+
+  @doc """
+  Returns `{:ok, [interface]}` with a map per EoE interface of the master.
+
+  Each map has `:interface`, `:slave` (`{:position, position}` or `{:alias, alias}`), `:up`,
+  `:queue_len` (frames the interface queues), `:sampled_at` (monotonic time in ms) and the
+  counters #{Enum.map_join(@counters, ", ", &"`#{inspect(&1)}`")}.
+
+  ## Options
+
+    * `:master` - Index of the master (default: `0`).
+    * `:sysfs` - Directory of the network interfaces (default: `"/sys/class/net"`).
+  """
+  def stats(opts \\ []) do
+    index = Keyword.get(opts, :master, 0)
+    root = Keyword.get(opts, :sysfs, "/sys/class/net")
+
+    with {:ok, names} <- File.ls(root) do
+      sampled_at = System.monotonic_time(:millisecond)
+
+      interfaces =
+        for name <- Enum.sort(names),
+            {^index, slave} <- [parse_name(name)],
+            %{} = stats <- [read_interface(Path.join(root, name))],
+            do: Map.merge(stats, %{interface: name, slave: slave, sampled_at: sampled_at})
+
+      {:ok, interfaces}
+    end
+  end
+
+  @doc """
+  Returns the receive and transmit rates in bytes per second, and the frames dropped, of every
+  interface found in both samples from `stats/1`.
+  """
+  def throughput(before, now) do
+    before = Map.new(before, &{&1.interface, &1})
+
+    for %{interface: name} = current <- now, %{} = previous <- [before[name]], into: %{} do
+      seconds = max(current.sampled_at - previous.sampled_at, 1) / 1000
+
+      {name,
+       %{
+         rx_rate: (current.rx_bytes - previous.rx_bytes) / seconds,
+         tx_rate: (current.tx_bytes - previous.tx_bytes) / seconds,
+         tx_dropped: current.tx_dropped - previous.tx_dropped
+       }}
+    end
+  end
+
+  defp parse_name(name) do
+    case Regex.run(~r/^eoe(\d+)([sa])(\d+)$/, name, capture: :all_but_first) do
+      [master, kind, address] ->
+        kind = if kind == "s", do: :position, else: :alias
+        {String.to_integer(master), {kind, String.to_integer(address)}}
+
+      nil ->
+        nil
+    end
+  end
+
+  # nil for an interface that went away while being read.
+  defp read_interface(dir) do
+    with {:ok, queue_len} <- read_integer(Path.join(dir, "tx_queue_len")),
+         {:ok, operstate} <- File.read(Path.join(dir, "operstate")),
+         {:ok, counters} <- read_counters(Path.join(dir, "statistics")) do
+      Map.merge(counters, %{queue_len: queue_len, up: String.trim(operstate) == "up"})
+    else
+      _ -> nil
+    end
+  end
+
+  defp read_counters(dir) do
+    Enum.reduce_while(@counters, {:ok, %{}}, fn counter, {:ok, acc} ->
+      case read_integer(Path.join(dir, Atom.to_string(counter))) do
+        {:ok, value} -> {:cont, {:ok, Map.put(acc, counter, value)}}
+        error -> {:halt, error}
+      end
+    end)
+  end
+
+  defp read_integer(path) do
+    with {:ok, text} <- File.read(path) do
+      case Integer.parse(String.trim(text)) do
+        {value, ""} -> {:ok, value}
+        _ -> {:error, :invalid}
+      end
+    end
+  end
+end
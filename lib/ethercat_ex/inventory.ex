@@ -0,0 +1,221 @@
+defmodule EthercatEx.Inventory do
+  @moduledoc """
+  Cache of the slave inventory and bus topology.
+
+  `EthercatEx.scan/1`, `EthercatEx.Cli.list_slaves/0`, `EthercatEx.Cli.bus_topology/0` and
+  `EthercatEx.Cli.generate_xml/0` serve their results from an ETS table with
+  `read_concurrency`, so repeated calls neither fork `ethercat` nor reread the SII. Slaves are
+  stored one row per `{master, position}`; `master` is `{:nif, index}` for the masters held by
+  `EthercatEx` and `:cli` for results of the `ethercat` tool.
+
+  The cache is filled on first use and dropped as a whole only when the bus changes: when the
+  link goes up or down, when the number of responding slaves changes, or after
+  `EthercatEx.Cli.rescan/0`. The bus is watched by polling `ecrt_master_state()` through the
+  NIF for every held master, and `ethercat master` when none is. The tool is run less often, in
+  a task of its own, so a slow or failing `ethercat` never holds up the cache.
+
+  Cached slaves describe the bus as it was when they were loaded; in particular their AL
+  `:state` is not refreshed. Use `EthercatEx.status/1` for live states.
+
+  Started by `EthercatEx.Cli.start_link/1`. Without it running, every call goes to the bus.
+
+  ## Options
+    - `:interval` - Bus polling interval in milliseconds (default: 500).
+    - `:tool_interval` - Polling interval in milliseconds while no master is held and the
+      `ethercat` tool is polled instead (default: 5000).
+  """
+
+  use GenServer
+
+  alias EthercatEx.{Cli, Nif}
+
+  @table __MODULE__
+
+  def start_link(opts \\ []) do
+    GenServer.start_link(__MODULE__, opts, name: __MODULE__)
+  end
+
+  @doc """
+  Returns the slaves of `master` in position order, loading them with `loader` on a miss.
+
+  `loader` returns `{:ok, slaves}` or an error, which is returned as is and not cached.
+  `position` extracts the bus position of a slave.
+  """
+  def slaves(master, position, loader) do
+    with_table(loader, fn ->
+      case :ets.lookup(@table, {master, :slaves}) do
+        [_complete] ->
+          match = [{{{master, :"$1"}, :"$2"}, [{:is_integer, :"$1"}], [:"$2"]}]
+          {:ok, :ets.select(@table, match)}
+
+        [] ->
+          load(loader, fn slaves ->
+            rows = Enum.map(slaves, &{{master, position.(&1)}, &1})
+            [{{master, :slaves}, length(slaves)} | rows]
+          end)
+      end
+    end)
+  end
+
+  @doc """
+  Returns the cached slave at `position` of `master`, or `:error` if the inventory of `master`
+  is not loaded or has no such slave.
+  """
+  def slave(master, position) do
+    case :ets.whereis(@table) != :undefined and :ets.lookup(@table, {master, position}) do
+      [{_key, slave}] -> {:ok, slave}
+      _ -> :error
+    end
+  end
+
+  @doc """
+  Returns the value stored under `key` for `master`, loading it with `loader` on a miss.
+  """
+  def fetch(master, key, loader) when is_atom(key) do
+    with_table(loader, fn ->
+      case :ets.lookup(@table, {master, key}) do
+        [{_key, value}] -> {:ok, value}
+        [] -> load(loader, &[{{master, key}, &1}])
+      end
+    end)
+  end
+
+  @doc """
+  Drops everything cached.
+  """
+  def invalidate do
+    if Process.whereis(__MODULE__), do: GenServer.call(__MODULE__, :invalidate), else: :ok
+  end
+
+  @impl GenServer
+  def init(opts) do
+    :ets.new(@table, [:ordered_set, :protected, :named_table, read_concurrency: true])
+    :ets.insert(@table, {:generation, 0})
+    state = %{
+      interval: Keyword.get(opts, :interval, 500),
+      tool_interval: Keyword.get(opts, :tool_interval, 5_000),
+      generation: 0,
+      bus: nil,
+      # Monitor reference of the running `ethercat master` poll
+      poll: nil
+    }
+
+    {:ok, state, {:continue, :watch}}
+  end
+
+  @impl GenServer
+  def handle_continue(:watch, state) do
+    handle_info(:watch, state)
+  end
+
+  @impl GenServer
+  def handle_call(:invalidate, _from, state) do
+    {:reply, :ok, clear(state)}
+  end
+
+  # Loads that started before an invalidation are dropped.
+  def handle_call({:put, generation, rows}, _from, %{generation: generation} = state) do
+    :ets.insert(@table, rows)
+    {:reply, :ok, state}
+  end
+
+  def handle_call({:put, _stale, _rows}, _from, state) do
+    {:reply, :ok, state}
+  end
+
+  @impl GenServer
+  def handle_info(:watch, state) do
+    case EthercatEx.masters() do
+      [] ->
+        Process.send_after(self(), :watch, state.tool_interval)
+        {:noreply, poll_tool(state)}
+
+      masters ->
+        Process.send_after(self(), :watch, state.interval)
+        {:noreply, update(state, nif_bus_state(masters))}
+    end
+  end
+
+  def handle_info({ref, result}, %{poll: ref} = state) do
+    Process.demonitor(ref, [:flush])
+
+    case result do
+      {:ok, output} -> {:noreply, update(%{state | poll: nil}, cli_bus_state(output))}
+      {:error, _reason} -> {:noreply, %{state | poll: nil}}
+    end
+  end
+
+  def handle_info({:DOWN, ref, :process, _pid, _reason}, %{poll: ref} = state) do
+    {:noreply, %{state | poll: nil}}
+  end
+
+  def handle_info(_message, state), do: {:noreply, state}
+
+  defp update(state, nil), do: state
+  defp update(%{bus: bus} = state, bus), do: state
+  defp update(%{bus: nil} = state, bus), do: %{state | bus: bus}
+  defp update(state, bus), do: %{clear(state) | bus: bus}
+
+  # `ethercat master` goes through the fast lane, which may take seconds
+  # or exit on a timeout; neither reaches this process.
+  defp poll_tool(%{poll: nil} = state) do
+    task =
+      Task.Supervisor.async_nolink(EthercatEx.Cli.TaskSupervisor, fn ->
+        try do
+          Cli.master_info()
+        catch
+          :exit, reason -> {:error, reason}
+        end
+      end)
+
+    %{state | poll: task.ref}
+  end
+
+  defp poll_tool(state), do: state
+
+  defp clear(state) do
+    generation = state.generation + 1
+    :ets.delete_all_objects(@table)
+    :ets.insert(@table, {:generation, generation})
+    %{state | generation: generation}
+  end
+
+  defp with_table(loader, cached) do
+    if :ets.whereis(@table) == :undefined, do: loader.(), else: cached.()
+  end
+
+  # Loaders run in the caller, so a slow bus query never blocks readers of
+  # other keys.
+  defp load(loader, rows) do
+    [{:generation, generation}] = :ets.lookup(@table, :generation)
+
+    with {:ok, value} <- loader.() do
+      :ok = GenServer.call(__MODULE__, {:put, generation, rows.(value)})
+      {:ok, value}
+    end
+  end
+
+  # `{link_up, slaves_responding}` of every held master in index order; nil
+  # when one cannot be read.
+  defp nif_bus_state(masters) do
+    states = Enum.map(masters, fn {_index, master} -> Nif.master_state(master) end)
+
+    if Enum.all?(states, &match?({:ok, _state}, &1)) do
+      for {:ok, %{link_up: link_up, slaves_responding: responding}} <- states,
+          do: {link_up, responding}
+    end
+  end
+
+  # From the `ethercat master` lines "  Slaves: 3" and "      Link: UP".
+  defp cli_bus_state(output) do
+    output
+    |> String.split("\n")
+    |> Enum.reduce({false, 0}, fn line, {link_up, responding} = acc ->
+      case String.trim(line) do
+        "Slaves: " <> count -> {link_up, count |> Integer.parse() |> elem(0)}
+        "Link: UP" -> {true, responding}
+        _ -> acc
+      end
+    end)
+  end
+end
@@ -0,0 +1,118 @@
+defmodule EthercatEx.Nif do
+  @moduledoc false
+  # Low-level bindings to libethercat, implemented in `c_src/`.
+  #
+  # A master is an opaque NIF resource returned by `request_master/1`. The
+  # underlying `ecrt_master_t` is released by `release_master/1` or, at the
+  # latest, when the resource is garbage collected. Functions return
+  # `{:error, {code, reason}}` for errno failures reported by libethercat and
+  # `{:error, atom}` for misuse such as calling into a released master.
+
+  @on_load :load_nif
+
+  def load_nif do
+    path = :filename.join(:code.priv_dir(:ethercat_ex), ~c"ethercat_nif")
+    :erlang.load_nif(path, 0)
+  end
+
+  def request_master(_index), do: :erlang.nif_error(:nif_not_loaded)
+  def release_master(_master), do: :erlang.nif_error(:nif_not_loaded)
+  # `cyclic` is nil for BEAM-driven cycling via cycle/1, or
+  # `{period_ns, sched_fifo_priority, cpu, dc, clock, lock_memory, acyclic_bytes}`
+  # with cpu -1 for no pinning, dc `false`, `:follow_reference` or
+  # `:sync_reference`, clock `:monotonic` or `:virtual`, lock_memory a
+  # boolean and acyclic_bytes the acyclic traffic per cycle, 0 for no budget.
+  def activate(_master, _cyclic), do: :erlang.nif_error(:nif_not_loaded)
+  def master_info(_master), do: :erlang.nif_error(:nif_not_loaded)
+  def master_state(_master), do: :erlang.nif_error(:nif_not_loaded)
+  def slave_info(_master, _position), do: :erlang.nif_error(:nif_not_loaded)
+  def slaves(_master), do: :erlang.nif_error(:nif_not_loaded)
+  # Reset-on-read counters and `[{highest_value_ns, count}]` histograms of
+  # the cyclic thread, plus `time`, the deadline of its latest cycle in ns
+  # on its clock; see EthercatEx.Telemetry.
+  def cycle_stats(_master), do: :erlang.nif_error(:nif_not_loaded)
+  # Allocates as if on the cyclic thread: aborts the VM in a build with
+  # ETHERCAT_RT_CHECKS=1, returns `:disabled` otherwise. For tests only.
+  def rt_check_trap, do: :erlang.nif_error(:nif_not_loaded)
+  # Registered pids receive `{:ethercat, :domain | :master, info}` and
+  # `{:ethercat, :slave, position, info}` on state changes.
+  def attach_monitor(_master, _pid), do: :erlang.nif_error(:nif_not_loaded)
+  def detach_monitor(_master, _pid), do: :erlang.nif_error(:nif_not_loaded)
+
+  # Domain 0 exists from the start; returns `{:ok, index}` of a domain
+  # queued on the cycles where `rem(cycle, every) == phase`.
+  def create_domain(_master, _every, _phase), do: :erlang.nif_error(:nif_not_loaded)
+
+  # `spec` is a map with the keys `domain`, `alias`, `position`, `vendor_id`,
+  # `product_code`, `sdo_requests`, `sdo_size`, `foe_size`, `reg_size`, `dc` as nil or
+  # `{assign_activate, sync0_cycle, sync0_shift, sync1_cycle, sync1_shift, reference_clock}`,
+  # `startup_sdos` as
+  # `[{index, subindex | :complete, binary}]` and `sync_managers` as
+  # `[{sm_index, :input | :output, [{pdo_index, [{index, subindex, bit_length}]}]}]`.
+  def configure_slave(_master, _spec), do: :erlang.nif_error(:nif_not_loaded)
+  def slave_layout(_master, _position), do: :erlang.nif_error(:nif_not_loaded)
+
+  # Process data binaries returned by these are copies: of the mapped domain
+  # memory without a cyclic task, of its latest published image with one.
+  def domain_image(_master, _domain), do: :erlang.nif_error(:nif_not_loaded)
+  def read_pdo(_master, _position), do: :erlang.nif_error(:nif_not_loaded)
+  def write_pdo(_master, _position, _outputs), do: :erlang.nif_error(:nif_not_loaded)
+  def cycle(_master), do: :erlang.nif_error(:nif_not_loaded)
+
+  # Queue a transfer and return :ok at once; the caller later receives
+  # `{:sdo_done, ref, {:ok, binary} | :ok | {:error, reason}}`.
+  def sdo_read(_master, _position, _index, _subindex, _timeout_ms, _ref),
+    do: :erlang.nif_error(:nif_not_loaded)
+
+  def sdo_write(_master, _position, _index, _subindex, _data, _timeout_ms, _ref),
+    do: :erlang.nif_error(:nif_not_loaded)
+
+  # The slave's FoE buffer is filled with foe_load/4 before foe_write/7 and
+  # drained with foe_unload/4 after foe_read/6 until foe_release/2, which
+  # only the process that reserved the slave may call. The caller receives
+  # `{:foe_progress, ref, bytes, total | nil}` and then
+  # `{:foe_done, ref, :ok | {:ok, size} | {:error, reason}}`.
+  def foe_load(_master, _position, _offset, _data), do: :erlang.nif_error(:nif_not_loaded)
+
+  def foe_write(_master, _position, _file, _password, _size, _timeout_ms, _ref),
+    do: :erlang.nif_error(:nif_not_loaded)
+
+  def foe_read(_master, _position, _file, _password, _timeout_ms, _ref),
+    do: :erlang.nif_error(:nif_not_loaded)
+
+  def foe_unload(_master, _position, _offset, _max), do: :erlang.nif_error(:nif_not_loaded)
+  def foe_release(_master, _position), do: :erlang.nif_error(:nif_not_loaded)
+
+  # One batch over every slave with a register request; the caller receives
+  # `{:register_done, ref, {:ok, positions, data, failed} | {:error, :closed}}`
+  # with `data` holding `size` bytes per position, in order. Requests still
+  # busy after `timeout_ms` are listed in `failed`.
+  def register_read(_master, _address, _size, _timeout_ms, _ref),
+    do: :erlang.nif_error(:nif_not_loaded)
+
+  def register_write(_master, _address, _data, _timeout_ms, _ref),
+    do: :erlang.nif_error(:nif_not_loaded)
+
+  # `pid` receives `{:pdo_changed, position, tag, value}` whenever the bits
+  # under `mask` of the `size` bytes at `offset` of the slave's inputs change.
+  def subscribe_pdo(_master, _pid, _position, _offset, _size, _mask, _tag),
+    do: :erlang.nif_error(:nif_not_loaded)
+
+  def unsubscribe_pdo(_master, _subscription), do: :erlang.nif_error(:nif_not_loaded)
+
+  # Records every cycle into a ring file of `capacity` records; see
+  # EthercatEx.Recorder for the layout.
+  def recorder_start(_master, _path, _capacity), do: :erlang.nif_error(:nif_not_loaded)
+  def recorder_freeze(_master, _after), do: :erlang.nif_error(:nif_not_loaded)
+  def recorder_stop(_master), do: :erlang.nif_error(:nif_not_loaded)
+
+  # `pid` receives `{:ethercat_stream, batch}` for every `batch` cycles; see
+  # EthercatEx.DeltaStream for the encoding.
+  def stream_start(_master, _pid, _batch), do: :erlang.nif_error(:nif_not_loaded)
+  def stream_stop(_master), do: :erlang.nif_error(:nif_not_loaded)
+
+  # `rules` are `{input, :== | :!=, expected, output, value, latch}` with
+  # `input` and `output` as `{position, offset, size, mask}`, offsets
+  # relative to the slave's inputs or outputs respectively.
+  def set_reflexes(_master, _rules), do: :erlang.nif_error(:nif_not_loaded)
+end
@@ -0,0 +1,213 @@
+defmodule EthercatEx.Pdo do
+  @moduledoc """
+  Generates process data decoders and encoders for one device at compile time.
+
+  The PDO layout is read from `ethercat cstruct` output (see `EthercatEx.Cli.generate_cstruct/0`
+  and `mix ethercat.gen.pdo`) and compiled into plain binary patterns with constant offsets, so
+  decoding a slave's slice of the process image needs no runtime lookups:
+
+      defmodule MyApp.Pdo.EL1008 do
+        use EthercatEx.Pdo,
+          cstruct: "priv/ethercat/cstruct.c",
+          position: 1,
+          names: %{{0x6000, 0x01} => :input_1, {0x6010, 0x01} => :input_2}
+      end
+
+      %{inputs: inputs} = EthercatEx.read_pdo(1)
+      %{input_1: 1, input_2: 0} = MyApp.Pdo.EL1008.decode_inputs(inputs)
+
+  ## Options
+
+    * `:cstruct` - (Required) Path of the `ethercat cstruct` output, relative to the project root.
+      It is tracked as an external resource, so the module recompiles when it changes.
+    * `:position` - (Required) Position of the slave whose layout to use.
+    * `:names` - (Optional) Map from `{index, subindex}` to the key used for that entry.
+      Entries without a name are keyed by `{index, subindex}`.
+
+  ## Generated functions
+
+    * `config/0` - Map for `EthercatEx.configure_slave/2`.
+    * `input_size/0`, `output_size/0` - Byte sizes of the slave's input and output slices.
+    * `decode_inputs/1` - Decodes an inputs binary into a map of unsigned integers.
+    * `encode_outputs/1` - Encodes a map holding every output key into an outputs binary.
+
+  EtherCAT packs entries little-endian and LSB-first. Byte-aligned entries are matched directly;
+  runs of bit-sized entries are matched as one little-endian integer and split with constant
+  shifts and masks.
+  """
+
+  alias EthercatEx.Pdo.Cstruct
+
+  defmacro __using__(opts) do
+    path = Keyword.fetch!(opts, :cstruct)
+    position = Keyword.fetch!(opts, :position)
+    {names, _} = opts |> Keyword.get(:names, Macro.escape(%{})) |> Code.eval_quoted()
+
+    slave =
+      path
+      |> File.read!()
+      |> Cstruct.parse()
+      |> Enum.find(&(&1.position == position)) ||
+        raise ArgumentError, "no slave at position #{position} in #{path}"
+
+    inputs = segments(slave, :input, names)
+    outputs = segments(slave, :output, names)
+
+    config = Map.take(slave, [:vendor_id, :product_code, :sync_managers])
+
+    quote do
+      @external_resource unquote(path)
+
+      @doc "Slave configuration for `EthercatEx.configure_slave/2`."
+      def config, do: unquote(Macro.escape(config))
+
+      @doc "Size of the slave's inputs in bytes."
+      def input_size, do: unquote(segments_size(inputs))
+
+      @doc "Size of the slave's outputs in bytes."
+      def output_size, do: unquote(segments_size(outputs))
+
+      unquote(decoder(inputs))
+      unquote(encoder(outputs))
+    end
+  end
+
+  # A direction's data as a list of segments, each a whole number of bytes
+  # except where noted:
+  #
+  #   {:field, key, bits}      - byte-aligned entry, bits a multiple of 8
+  #   {:skip, bits}            - byte-aligned gap
+  #   {:span, bits, fields}    - packed entries, fields as [{key, shift, bits}]
+  #
+  # Entries follow each other in sync manager, PDO and entry order, which is
+  # how the master lays them out in the domain.
+  @doc false
+  def segments(slave, direction, names) do
+    entries =
+      for %{direction: ^direction, pdos: pdos} <- slave.sync_managers,
+          %{entries: entries} <- pdos,
+          {index, subindex, bits} <- entries,
+          bits > 0 do
+        key = if index == 0, do: :gap, else: Map.get(names, {index, subindex}, {index, subindex})
+        {key, bits}
+      end
+
+    entries
+    |> Enum.reduce({[], nil, 0}, &add_entry/2)
+    |> close_span()
+    |> elem(0)
+    |> Enum.reverse()
+  end
+
+  defp add_entry({key, bits}, {segments, nil, offset})
+       when rem(offset, 8) == 0 and rem(bits, 8) == 0 do
+    segment = if key == :gap, do: {:skip, bits}, else: {:field, key, bits}
+    {[segment | segments], nil, offset + bits}
+  end
+
+  defp add_entry({key, bits}, {segments, nil, offset}) do
+    add_entry({key, bits}, {segments, {offset, []}, offset})
+  end
+
+  defp add_entry({key, bits}, {segments, {start, fields}, offset}) do
+    fields = if key == :gap, do: fields, else: [{key, offset - start, bits} | fields]
+    acc = {segments, {start, fields}, offset + bits}
+    if rem(offset + bits, 8) == 0, do: close_span(acc), else: acc
+  end
+
+  defp close_span({segments, nil, offset}), do: {segments, nil, offset}
+
+  defp close_span({segments, {start, fields}, offset}) do
+    bits = div(offset - start + 7, 8) * 8
+    {[{:span, bits, Enum.reverse(fields)} | segments], nil, start + bits}
+  end
+
+  defp segments_size(segments) do
+    segments
+    |> Enum.map(fn
+      {:field, _key, bits} -> bits
+      {:skip, bits} -> bits
+      {:span, bits, _fields} -> bits
+    end)
+    |> Enum.sum()
+    |> div(8)
+  end
+
+  defp decoder(segments) do
+    {patterns, pairs} =
+      segments
+      |> Enum.with_index()
+      |> Enum.map(fn
+        {{:field, key, bits}, i} ->
+          var = Macro.var(:"field#{i}", __MODULE__)
+          {quote(do: unquote(var) :: little - size(unquote(bits))), [{key, var}]}
+
+        {{:skip, bits}, _i} ->
+          {quote(do: _ :: size(unquote(bits))), []}
+
+        {{:span, bits, []}, _i} ->
+          {quote(do: _ :: size(unquote(bits))), []}
+
+        {{:span, bits, fields}, i} ->
+          var = Macro.var(:"span#{i}", __MODULE__)
+
+          pairs =
+            for {key, shift, size} <- fields do
+              mask = Bitwise.bsl(1, size) - 1
+              {key, quote(do: Bitwise.band(Bitwise.bsr(unquote(var), unquote(shift)), unquote(mask)))}
+            end
+
+          {quote(do: unquote(var) :: little - size(unquote(bits))), pairs}
+      end)
+      |> Enum.unzip()
+
+    patterns = patterns ++ [quote(do: _ :: bitstring)]
+    map = {:%{}, [], Enum.concat(pairs)}
+
+    quote do
+      @doc "Decodes the slave's inputs binary; trailing bytes are ignored."
+      def decode_inputs(<<unquote_splicing(patterns)>>), do: unquote(map)
+    end
+  end
+
+  defp encoder(segments) do
+    keys =
+      Enum.flat_map(segments, fn
+        {:field, key, _bits} -> [key]
+        {:skip, _bits} -> []
+        {:span, _bits, fields} -> Enum.map(fields, &elem(&1, 0))
+      end)
+
+    vars =
+      keys
+      |> Enum.with_index()
+      |> Map.new(fn {key, i} -> {key, Macro.var(:"out#{i}", __MODULE__)} end)
+
+    parts =
+      Enum.map(segments, fn
+        {:field, key, bits} ->
+          quote(do: unquote(vars[key]) :: little - size(unquote(bits)))
+
+        {:skip, bits} ->
+          quote(do: 0 :: size(unquote(bits)))
+
+        {:span, bits, fields} ->
+          value =
+            fields
+            |> Enum.map(fn {key, shift, size} ->
+              mask = Bitwise.bsl(1, size) - 1
+              quote(do: Bitwise.bsl(Bitwise.band(unquote(vars[key]), unquote(mask)), unquote(shift)))
+            end)
+            |> Enum.reduce(0, &quote(do: Bitwise.bor(unquote(&2), unquote(&1))))
+
+          quote(do: unquote(value) :: little - size(unquote(bits)))
+      end)
+
+    pattern = {:%{}, [], Enum.map(keys, &{&1, vars[&1]})}
+
+    quote do
+      @doc "Encodes the slave's outputs; the map must hold every output key."
+      def encode_outputs(unquote(pattern)), do: <<unquote_splicing(parts)>>
+    end
+  end
+end
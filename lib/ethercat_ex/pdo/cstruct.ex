@@ -0,0 +1,170 @@
+defmodule EthercatEx.Pdo.Cstruct do
+  @moduledoc """
+  Parses the C code printed by `ethercat cstruct` (see `EthercatEx.Cli.generate_cstruct/0`).
+
+  Each slave becomes a map whose `:sync_managers` use the same shape as the
+  `:sync_managers` option of `EthercatEx.configure_slave/2`:
+
+      %{
+        position: 0,
+        name: "EL2004",
+        vendor_id: 0x00000002,
+        product_code: 0x07D43052,
+        revision: 0x00100000,
+        sync_managers: [
+          %{index: 0, direction: :output, watchdog: :enable,
+            pdos: [%{index: 0x1600, name: "Channel 1", entries: [{0x7000, 0x01, 1}]}]}
+        ],
+        entry_names: %{{0x7000, 0x01} => "Output"}
+      }
+  """
+
+  @header ~r/^\/\* Master \d+, Slave (\d+), "(.*)"/
+  @identity ~r/^\s*\* (Vendor ID|Product code|Revision number):\s*(0x[0-9a-fA-F]+)/
+  @array ~r/^ec_(pdo_entry_info|pdo_info|sync_info)_t slave_\d+_\w+\[\] = \{/
+  @entry ~r/^\s*\{(0x[0-9a-fA-F]+), (0x[0-9a-fA-F]+), (\d+)\},?(?:\s*\/\* (.*) \*\/)?/
+  @pdo ~r/^\s*\{(0x[0-9a-fA-F]+), (\d+), (?:slave_\d+_pdo_entries \+ (\d+)|NULL)\},?(?:\s*\/\* (.*) \*\/)?/
+  @sync ~r/^\s*\{(\d+), EC_DIR_(INPUT|OUTPUT), (\d+), (?:slave_\d+_pdos \+ (\d+)|NULL), EC_WD_(\w+)\}/
+
+  @doc """
+  Parses `ethercat cstruct` output into one map per slave, in bus order.
+  """
+  def parse(source) when is_binary(source) do
+    source
+    |> String.split("\n")
+    |> Enum.reduce({[], nil}, &parse_line/2)
+    |> finish_slave()
+    |> elem(0)
+    |> Enum.reverse()
+  end
+
+  defp parse_line(line, {slaves, slave} = acc) do
+    cond do
+      match = Regex.run(@header, line) ->
+        [_, position, name] = match
+        {slaves, _} = finish_slave(acc)
+
+        {slaves,
+         %{
+           position: String.to_integer(position),
+           name: name,
+           vendor_id: nil,
+           product_code: nil,
+           revision: nil,
+           section: nil,
+           entries: [],
+           pdos: [],
+           syncs: []
+         }}
+
+      slave == nil ->
+        acc
+
+      match = Regex.run(@identity, line) ->
+        [_, field, value] = match
+        key = %{"Vendor ID" => :vendor_id, "Product code" => :product_code}
+        {slaves, Map.put(slave, Map.get(key, field, :revision), hex(value))}
+
+      match = Regex.run(@array, line) ->
+        [_, section] = match
+        {slaves, %{slave | section: section}}
+
+      true ->
+        {slaves, parse_item(slave.section, line, slave)}
+    end
+  end
+
+  defp parse_item("pdo_entry_info", line, slave) do
+    case Regex.run(@entry, line) do
+      [_, index, subindex, bits | name] ->
+        entry = {{hex(index), hex(subindex), String.to_integer(bits)}, List.first(name)}
+        %{slave | entries: [entry | slave.entries]}
+
+      nil ->
+        slave
+    end
+  end
+
+  defp parse_item("pdo_info", line, slave) do
+    case Regex.run(@pdo, line) do
+      [_, index, count | rest] ->
+        {first, name} = pdo_rest(rest)
+        %{slave | pdos: [{hex(index), String.to_integer(count), first, name} | slave.pdos]}
+
+      nil ->
+        slave
+    end
+  end
+
+  defp parse_item("sync_info", line, slave) do
+    case Regex.run(@sync, line) do
+      [_, index, dir, count, first, watchdog] ->
+        sync =
+          {String.to_integer(index), direction(dir), String.to_integer(count), offset(first),
+           watchdog(watchdog)}
+
+        %{slave | syncs: [sync | slave.syncs]}
+
+      nil ->
+        slave
+    end
+  end
+
+  defp parse_item(_section, _line, slave), do: slave
+
+  defp finish_slave({slaves, nil}), do: {slaves, nil}
+
+  defp finish_slave({slaves, slave}) do
+    entries = Enum.reverse(slave.entries)
+    pdos = Enum.reverse(slave.pdos)
+
+    pdos =
+      Enum.map(pdos, fn {index, count, first, name} ->
+        %{
+          index: index,
+          name: name,
+          entries: entries |> Enum.slice(first, count) |> Enum.map(&elem(&1, 0))
+        }
+      end)
+
+    sync_managers =
+      slave.syncs
+      |> Enum.reverse()
+      |> Enum.map(fn {index, direction, count, first, watchdog} ->
+        %{
+          index: index,
+          direction: direction,
+          watchdog: watchdog,
+          pdos: Enum.slice(pdos, first, count)
+        }
+      end)
+
+    entry_names =
+      for {{index, subindex, _bits}, name} <- entries, index != 0, name != nil, into: %{} do
+        {{index, subindex}, name}
+      end
+
+    slave =
+      slave
+      |> Map.drop([:section, :entries, :pdos, :syncs])
+      |> Map.merge(%{sync_managers: sync_managers, entry_names: entry_names})
+
+    {[slave | slaves], nil}
+  end
+
+  defp pdo_rest([]), do: {0, nil}
+  defp pdo_rest([first]), do: {offset(first), nil}
+  defp pdo_rest([first, name]), do: {offset(first), name}
+
+  defp offset(""), do: 0
+  defp offset(value), do: String.to_integer(value)
+
+  defp direction("INPUT"), do: :input
+  defp direction("OUTPUT"), do: :output
+
+  defp watchdog("ENABLE"), do: :enable
+  defp watchdog("DISABLE"), do: :disable
+  defp watchdog(_), do: :default
+
+  defp hex("0x" <> digits), do: String.to_integer(digits, 16)
+end
@@ -0,0 +1,101 @@
+defmodule EthercatEx.Recorder do
+  @moduledoc """
+  Post-mortem recorder of the process image.
+
+  While recording, the thread running the exchange appends every cycle's domain images to a
+  pre-allocated ring file that is memory-mapped into the process, together with the cycle
+  number and a `CLOCK_REALTIME` timestamp. A record is a plain memory copy, without a system
+  call, so recording can stay on at full cycle rate. The ring holds the last `:records`
+  cycles; since the kernel writes the mapping back itself, the file survives a crash of the
+  VM.
+
+  When a fault is detected, `freeze/1` records a few more cycles and stops, so the file holds
+  the window around the trigger; `read/1` decodes it:
+
+      :ok = EthercatEx.Recorder.start("/var/log/ethercat.rec", records: 10_000)
+      # ... on a fault:
+      :ok = EthercatEx.Recorder.freeze(after: 500)
+      {:ok, %{records: records}} = EthercatEx.Recorder.read("/var/log/ethercat.rec")
+
+  The file is in host byte order: a 4096 byte header (magic `"ECATREC1"`, version, record
+  size, image size, capacity, records written, frozen flag and the offset and size of each
+  domain), followed by the records.
+  """
+
+  alias EthercatEx.Nif
+
+  @magic "ECATREC1"
+  @header_size 4096
+
+  @doc """
+  Starts recording into `path`, which is created or truncated. The master must be active.
+
+  ## Options
+
+    * `:records` - (Optional) Ring capacity in cycles (default: `10_000`, 10 s at 1 kHz).
+    * `:master` - (Optional) Index of the master (default: `0`).
+  """
+  def start(path, opts \\ []) do
+    with {:ok, master} <- EthercatEx.fetch_master(Keyword.get(opts, :master, 0)) do
+      Nif.recorder_start(master, path, Keyword.get(opts, :records, 10_000))
+    end
+  end
+
+  @doc """
+  Stops the recording after `:after` more cycles (default: `0`), keeping the window around the
+  moment of the call. Freezing an already frozen recorder has no effect. Takes the `:master`
+  option.
+  """
+  def freeze(opts \\ []) do
+    with {:ok, master} <- EthercatEx.fetch_master(Keyword.get(opts, :master, 0)) do
+      Nif.recorder_freeze(master, Keyword.get(opts, :after, 0))
+    end
+  end
+
+  @doc """
+  Stops recording and closes the file, which stays on disk. Takes the `:master` option.
+  """
+  def stop(opts \\ []) do
+    with {:ok, master} <- EthercatEx.fetch_master(Keyword.get(opts, :master, 0)) do
+      Nif.recorder_stop(master)
+    end
+  end
+
+  @doc """
+  Decodes a recording file, oldest record first.
+
+  Returns `{:ok, %{frozen: boolean, records: records}}` where each record is
+  `%{cycle: n, time: ns_since_epoch, domains: [image]}`, with one binary per domain in domain
+  order; slave offsets from `EthercatEx.layout/2` apply to the image of their domain. Works on
+  a file left behind by a crashed VM; a file still being recorded may hold a torn newest
+  record, so freeze first.
+  """
+  def read(path) do
+    with {:ok, data} <- File.read(path), do: decode(data)
+  end
+
+  @doc false
+  def decode(
+        <<@magic, 1::native-32, record_size::native-32, _image_size::native-64,
+          capacity::native-64, head::native-64, frozen::native-32, domain_count::native-32,
+          table::binary-size(domain_count * 16), _rest::binary>> = data
+      )
+      when byte_size(data) >= @header_size + capacity * record_size do
+    domains = for <<offset::native-64, size::native-64 <- table>>, do: {offset, size}
+    count = min(head, capacity)
+
+    records =
+      for seq <- (head - count)..(head - 1)//1 do
+        at = @header_size + rem(seq, capacity) * record_size
+        <<cycle::native-64, time::native-signed-64, image::binary>> =
+          binary_part(data, at, record_size)
+
+        images = for {offset, size} <- domains, do: binary_part(image, offset, size)
+        %{cycle: cycle, time: time, domains: images}
+      end
+
+    {:ok, %{frozen: frozen != 0, records: records}}
+  end
+
+  def decode(_data), do: {:error, :invalid_recording}
+end
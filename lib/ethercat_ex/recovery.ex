@@ -0,0 +1,172 @@
+defmodule EthercatEx.Recovery do
+  @moduledoc """
+  Brings slaves back to OP after they drop out, without restarting the master.
+
+  The thread running the exchange reports every change of a configured slave's state (see
+  `EthercatEx.attach_monitor/2`). This process follows those reports and, when a slave stops
+  being operational, because its link went down or it fell back to SAFEOP with an error,
+  waits for `:grace` milliseconds; a slave the master recovers itself, which it does for a
+  slave that merely reappears on the bus, needs nothing more. One still not operational is reset
+  with `EthercatEx.reset_slave/2` once it is online, which has the master apply its cached
+  configuration again, and retried with a doubling delay until it is back. Every slave is
+  recovered on its own, in the background, while the others keep cycling.
+
+  Add it to a supervision tree after the master is active:
+
+      children = [{EthercatEx.Recovery, master: 0}]
+
+  It emits `:telemetry` events with metadata `%{master: index, slave: slave_id}`:
+
+    * `[:ethercat_ex, :slave, :lost]` when a slave stops being operational; a slave that
+      has not reached OP yet is still coming up and is left alone
+    * `[:ethercat_ex, :slave, :recovered]` with measurement `:duration` in milliseconds
+    * `[:ethercat_ex, :slave, :recovery_failed]` with measurement `:attempt` and
+      `:reason` in the metadata, before each retry
+
+  ## Options
+    - `:master` - Index of the master (default: `0`).
+    - `:grace` - Time in milliseconds to leave a slave to the master before resetting it
+      (default: `2000`).
+    - `:timeout` - Time in milliseconds each state transition of a reset may take
+      (default: `10_000`).
+    - `:max_delay` - Longest delay in milliseconds between two resets of a slave
+      (default: `30_000`).
+    - `:name` - Registered name (default: `EthercatEx.Recovery`).
+  """
+
+  use GenServer
+
+  @lost [:ethercat_ex, :slave, :lost]
+  @recovered [:ethercat_ex, :slave, :recovered]
+  @failed [:ethercat_ex, :slave, :recovery_failed]
+
+  def start_link(opts \\ []) do
+    GenServer.start_link(__MODULE__, opts, name: Keyword.get(opts, :name, __MODULE__))
+  end
+
+  @doc """
+  Returns the slaves being recovered, as `%{slave_id => attempts}`.
+  """
+  def recovering(server \\ __MODULE__), do: GenServer.call(server, :recovering)
+
+  @impl GenServer
+  def init(opts) do
+    index = Keyword.get(opts, :master, 0)
+
+    # Resets run unlinked under a supervisor of their own, so a crashing one
+    # arrives as :DOWN and is retried like any failure.
+    with {:ok, _master} <- EthercatEx.fetch_master(index),
+         {:ok, tasks} <- Task.Supervisor.start_link(),
+         :ok <- EthercatEx.attach_monitor(self(), master: index) do
+      state = %{
+        master: index,
+        tasks: tasks,
+        grace: Keyword.get(opts, :grace, 2000),
+        timeout: Keyword.get(opts, :timeout, 10_000),
+        max_delay: Keyword.get(opts, :max_delay, 30_000),
+        # Slaves reported in OP at least once; before that, not being
+        # operational is just the bring-up.
+        seen_op: MapSet.new(),
+        # slave_id => %{since:, online:, attempts:, task:}
+        lost: %{}
+      }
+
+      {:ok, state}
+    else
+      {:error, reason} -> {:stop, reason}
+    end
+  end
+
+  @impl GenServer
+  def handle_call(:recovering, _from, state) do
+    {:reply, Map.new(state.lost, fn {id, slave} -> {id, slave.attempts} end), state}
+  end
+
+  @impl GenServer
+  def handle_info({:ethercat, :slave, id, %{operational: true}}, state) do
+    state = %{state | seen_op: MapSet.put(state.seen_op, id)}
+
+    case Map.pop(state.lost, id) do
+      {nil, _lost} ->
+        {:noreply, state}
+
+      {slave, lost} ->
+        duration = System.monotonic_time(:millisecond) - slave.since
+        :telemetry.execute(@recovered, %{duration: duration}, metadata(state, id))
+        {:noreply, %{state | lost: lost}}
+    end
+  end
+
+  def handle_info({:ethercat, :slave, id, %{online: online}}, state) do
+    case state.lost do
+      %{^id => slave} ->
+        {:noreply, put_in(state.lost[id], %{slave | online: online})}
+
+      _ ->
+        if MapSet.member?(state.seen_op, id) do
+          :telemetry.execute(@lost, %{}, metadata(state, id))
+          Process.send_after(self(), {:check, id}, state.grace)
+          since = System.monotonic_time(:millisecond)
+          slave = %{since: since, online: online, attempts: 0, task: nil}
+          {:noreply, put_in(state.lost[id], slave)}
+        else
+          {:noreply, state}
+        end
+    end
+  end
+
+  def handle_info({:ethercat, _kind, _event}, state), do: {:noreply, state}
+
+  def handle_info({:check, id}, state) do
+    case state.lost do
+      %{^id => %{task: nil, online: true} = slave} ->
+        opts = [master: state.master, timeout: state.timeout]
+        reset = fn -> {id, EthercatEx.reset_slave(id, opts)} end
+        task = Task.Supervisor.async_nolink(state.tasks, reset)
+        {:noreply, put_in(state.lost[id], %{slave | task: task.ref})}
+
+      %{^id => %{task: nil}} ->
+        # Nothing to reset without a link; the master takes the slave back
+        # up itself once it reappears.
+        Process.send_after(self(), {:check, id}, state.grace)
+        {:noreply, state}
+
+      _ ->
+        {:noreply, state}
+    end
+  end
+
+  def handle_info({ref, {id, result}}, state) when is_reference(ref) do
+    Process.demonitor(ref, [:flush])
+
+    case state.lost do
+      %{^id => %{task: ^ref} = slave} -> {:noreply, reset_done(state, id, slave, result)}
+      _ -> {:noreply, state}
+    end
+  end
+
+  def handle_info({:DOWN, ref, :process, _pid, reason}, state) do
+    case Enum.find(state.lost, fn {_id, slave} -> slave.task == ref end) do
+      {id, slave} -> {:noreply, reset_done(state, id, slave, {:error, reason})}
+      nil -> {:noreply, state}
+    end
+  end
+
+  # The slave's own report of OP ends the recovery; a successful reset only
+  # means it got there at some point, so it is checked again.
+  defp reset_done(state, id, slave, :ok) do
+    Process.send_after(self(), {:check, id}, state.grace)
+    put_in(state.lost[id], %{slave | task: nil})
+  end
+
+  defp reset_done(state, id, slave, {:error, reason}) do
+    attempts = slave.attempts + 1
+    metadata = Map.put(metadata(state, id), :reason, reason)
+    :telemetry.execute(@failed, %{attempt: attempts}, metadata)
+    delay = min(state.grace * Integer.pow(2, attempts), state.max_delay)
+    Process.send_after(self(), {:check, id}, delay)
+    put_in(state.lost[id], %{slave | task: nil, attempts: attempts})
+  end
+
+  defp metadata(state, id), do: %{master: state.master, slave: id}
+end
@@ -0,0 +1,184 @@
+defmodule EthercatEx.Snapshot do
+  @moduledoc """
+  Saves a resolved slave configuration so the next start can skip discovery.
+
+  Working out PDO layouts from SII and ESI data (`EthercatEx.Cli.rescan/0`,
+  `EthercatEx.Cli.list_pdos/1`, `mix ethercat.gen.pdo`, ...) takes seconds. A snapshot holds
+  what that ends in: the `{slave_id, config}` pairs given to `EthercatEx.configure_slaves/2`,
+  with PDO mappings, startup SDOs and DC settings, together with the identity of every slave
+  as seen by `EthercatEx.scan/1` and the layout the master gave it. On the next start the
+  identities are checked against the bus, which takes one native call, and when nothing
+  changed the configuration is applied as is:
+
+      {:ok, :warm} =
+        EthercatEx.Snapshot.warm_start("/data/ethercat.snapshot", fn ->
+          # Slow path, only taken when the bus changed or there is no snapshot yet.
+          discover_slave_configs()
+        end)
+
+      :ok = EthercatEx.activate()
+
+  The file is `"ECATSNP1"`, a CRC-32 of the rest and the snapshot as a compressed external
+  term.
+  """
+
+  alias EthercatEx.Nif
+
+  @magic "ECATSNP1"
+  @version 1
+  @identity_keys [:vendor_id, :product_code, :revision]
+
+  defstruct version: @version, slaves: [], identities: %{}, layouts: %{}
+
+  @type t :: %__MODULE__{
+          version: pos_integer(),
+          slaves: [{non_neg_integer(), map()}],
+          identities: %{non_neg_integer() => map()},
+          layouts: %{non_neg_integer() => map()}
+        }
+
+  @doc """
+  Configures the slaves from the snapshot at `path` if the bus still matches it, and otherwise
+  from `discover`, a function returning `{slave_id, config}` pairs, saving a new snapshot.
+
+  Returns `{:ok, :warm}` or `{:ok, :cold}` for the path taken, or `{:error, reason}`.
+
+  ## Options
+
+    * `:domains` - Options for `EthercatEx.create_domain/1`, one list per domain beyond `0`,
+      created in order on either path before the slaves are configured.
+    * `:master` - Index of the master (default: `0`).
+  """
+  def warm_start(path, discover, opts \\ []) do
+    with :ok <- create_domains(opts) do
+      case load(path) do
+        {:ok, snapshot} ->
+          case apply_snapshot(snapshot, opts) do
+            :ok -> {:ok, :warm}
+            {:error, {:changed, _slave_ids}} -> cold_start(path, discover, opts)
+            error -> error
+          end
+
+        {:error, _reason} ->
+          cold_start(path, discover, opts)
+      end
+    end
+  end
+
+  @doc """
+  Builds a snapshot of `slaves`, as given to `EthercatEx.configure_slaves/2`, once they have
+  been configured. Takes the `:master` option.
+  """
+  def capture(slaves, opts \\ []) do
+    with {:ok, master} <- EthercatEx.fetch_master(Keyword.get(opts, :master, 0)),
+         {:ok, bus} <- Nif.slaves(master),
+         {:ok, layouts} <- layouts(master, slaves) do
+      identities = Map.new(bus, &{&1.id, Map.take(&1, @identity_keys)})
+
+      {:ok,
+       %__MODULE__{
+         slaves: Enum.map(slaves, fn {id, config} -> {id, Map.new(config)} end),
+         identities: Map.take(identities, Enum.map(slaves, &elem(&1, 0))),
+         layouts: layouts
+       }}
+    end
+  end
+
+  @doc """
+  Configures the slaves of `snapshot`.
+
+  Nothing is configured and `{:error, {:changed, slave_ids}}` is returned if any slave of the
+  snapshot is missing from the bus or has another vendor, product code or revision. Returns
+  `{:error, {:layout_changed, slave_ids}}` if the master placed PDO entries elsewhere than when
+  the snapshot was taken, which means the domains were created differently. Takes the
+  `:master` option.
+  """
+  def apply_snapshot(%__MODULE__{} = snapshot, opts \\ []) do
+    with {:ok, master} <- EthercatEx.fetch_master(Keyword.get(opts, :master, 0)),
+         :ok <- check_identities(master, snapshot),
+         :ok <- EthercatEx.configure_slaves(snapshot.slaves, opts),
+         {:ok, layouts} <- layouts(master, snapshot.slaves) do
+      case for {id, layout} <- layouts, snapshot.layouts[id] != layout, do: id do
+        [] -> :ok
+        changed -> {:error, {:layout_changed, changed}}
+      end
+    end
+  end
+
+  @doc "Encodes a snapshot as saved by `save/2`."
+  def encode(%__MODULE__{} = snapshot) do
+    term = :erlang.term_to_binary(Map.from_struct(snapshot), [:compressed, :deterministic])
+    <<@magic, :erlang.crc32(term)::32, term::binary>>
+  end
+
+  @doc "Decodes a binary from `encode/1`. Returns `{:ok, snapshot}` or `{:error, :invalid}`."
+  def decode(<<@magic, crc::32, term::binary>>) do
+    with ^crc <- :erlang.crc32(term),
+         %{version: @version} = fields <- :erlang.binary_to_term(term, [:safe]) do
+      {:ok, struct(__MODULE__, fields)}
+    else
+      _ -> {:error, :invalid}
+    end
+  rescue
+    ArgumentError -> {:error, :invalid}
+  end
+
+  def decode(_binary), do: {:error, :invalid}
+
+  @doc "Writes a snapshot to `path`, replacing the file atomically."
+  def save(path, %__MODULE__{} = snapshot) do
+    tmp = path <> ".tmp"
+
+    with :ok <- File.write(tmp, encode(snapshot), [:sync]) do
+      File.rename(tmp, path)
+    end
+  end
+
+  @doc "Reads a snapshot from `path`."
+  def load(path) do
+    with {:ok, binary} <- File.read(path), do: decode(binary)
+  end
+
+  defp cold_start(path, discover, opts) do
+    slaves = discover.()
+
+    with :ok <- EthercatEx.configure_slaves(slaves, opts),
+         {:ok, snapshot} <- capture(slaves, opts),
+         :ok <- save(path, snapshot) do
+      {:ok, :cold}
+    end
+  end
+
+  defp create_domains(opts) do
+    opts
+    |> Keyword.get(:domains, [])
+    |> Enum.reduce_while(:ok, fn domain_opts, :ok ->
+      domain_opts = Keyword.put_new(domain_opts, :master, Keyword.get(opts, :master, 0))
+
+      case EthercatEx.create_domain(domain_opts) do
+        {:ok, _index} -> {:cont, :ok}
+        error -> {:halt, error}
+      end
+    end)
+  end
+
+  defp check_identities(master, snapshot) do
+    with {:ok, bus} <- Nif.slaves(master) do
+      seen = Map.new(bus, &{&1.id, Map.take(&1, @identity_keys)})
+
+      case for {id, identity} <- snapshot.identities, seen[id] != identity, do: id do
+        [] -> :ok
+        changed -> {:error, {:changed, Enum.sort(changed)}}
+      end
+    end
+  end
+
+  defp layouts(master, slaves) do
+    Enum.reduce_while(slaves, {:ok, %{}}, fn {id, _config}, {:ok, acc} ->
+      case Nif.slave_layout(master, id) do
+        {:ok, layout} -> {:cont, {:ok, Map.put(acc, id, layout)}}
+        error -> {:halt, error}
+      end
+    end)
+  end
+end
@@ -0,0 +1,175 @@
+defmodule EthercatEx.States do
+  @moduledoc """
+  Brings slaves to an AL state and waits until they are there.
+
+  All transitions are requested at once, each slave through its own `ethercat states -p`
+  call (or one call for the whole bus), spread over the workers of the `EthercatEx.Cli` fast
+  lane rather than one after the other. The wait then follows the slave configuration states that
+  the thread running the exchange compares every cycle (see `EthercatEx.attach_monitor/2`), so a
+  slave counts as done as soon as the cyclic thread sees it in the target state. Slaves still
+  missing after 250 ms without news are also looked up directly, which covers slaves that are
+  not configured and so not watched by the cyclic thread.
+
+      :ok = EthercatEx.States.request(:all, :operational, timeout: 5000)
+
+      {:error, %{7 => {:timeout, :safe_operational}}} =
+        EthercatEx.States.request_groups([
+          {[0, 1, 2], :operational},
+          {[7], :operational},
+          {[8, 9], :pre_operational}
+        ])
+
+  libethercat has no call for requesting a slave's AL state from the application, which is why
+  the requests go through the `ethercat` tool; `EthercatEx.Cli` must be running. The master must
+  be active for the cyclic thread to watch the slaves.
+  """
+
+  alias EthercatEx.{Cli, Nif}
+
+  @cli_states %{
+    init: "INIT",
+    pre_operational: "PREOP",
+    bootstrap: "BOOT",
+    safe_operational: "SAFEOP",
+    operational: "OP"
+  }
+  @poll_interval 250
+
+  @type state :: :init | :pre_operational | :bootstrap | :safe_operational | :operational
+
+  @doc """
+  Requests `state` for `slaves`, a list of slave ids or `:all`, and waits for them.
+
+  ## Options
+
+    * `:timeout` - Time in milliseconds each slave has to reach its state after its request
+      was sent (default: `10_000`).
+    * `:master` - Index of the master (default: `0`).
+
+  Returns `:ok` once every slave is there, or `{:error, %{slave_id => reason}}` for the
+  slaves that are not, with `reason` either `{:timeout, last_seen_state}` or the error of
+  the request.
+  """
+  @spec request([non_neg_integer()] | :all, state(), keyword()) :: :ok | {:error, map()}
+  def request(slaves, state, opts \\ []), do: request_groups([{slaves, state}], opts)
+
+  @doc """
+  Like `request/3` for several groups of slaves with their own target states, all requested
+  in parallel. A slave listed in several groups gets the state of the last one.
+  """
+  @spec request_groups([{[non_neg_integer()] | :all, state()}], keyword()) ::
+          :ok | {:error, map()}
+  def request_groups(groups, opts \\ []) do
+    index = Keyword.get(opts, :master, 0)
+    timeout = Keyword.get(opts, :timeout, 10_000)
+
+    with {:ok, master} <- EthercatEx.fetch_master(index),
+         {:ok, targets} <- targets(master, groups) do
+      # The monitor attached for the wait goes away with this process, and
+      # one the caller attached itself is left alone.
+      fn -> orchestrate(master, index, groups, targets, timeout) end
+      |> Task.async()
+      |> Task.await(:infinity)
+    end
+  end
+
+  defp targets(master, groups) do
+    Enum.reduce_while(groups, {:ok, %{}}, fn {slaves, state}, {:ok, acc} ->
+      Map.fetch!(@cli_states, state)
+
+      case slave_ids(master, slaves) do
+        {:ok, ids} -> {:cont, {:ok, Enum.reduce(ids, acc, &Map.put(&2, &1, state))}}
+        error -> {:halt, error}
+      end
+    end)
+  end
+
+  defp slave_ids(master, :all) do
+    with {:ok, slaves} <- Nif.slaves(master), do: {:ok, Enum.map(slaves, & &1.id)}
+  end
+
+  defp slave_ids(_master, ids) when is_list(ids), do: {:ok, ids}
+
+  defp orchestrate(master, index, groups, targets, timeout) do
+    :ok = EthercatEx.attach_monitor(self(), master: index)
+    {pending, errors} = send_requests(groups, targets, timeout)
+    await(poll(pending, master), errors, master)
+  end
+
+  # Returns the slaves to wait for, as slave_id => {target, deadline,
+  # last_seen}, and the ones whose request failed.
+  defp send_requests([{:all, state}], targets, timeout) do
+    sent_at = System.monotonic_time(:millisecond)
+
+    case Cli.request_state(@cli_states[state]) do
+      :ok -> {Map.new(targets, fn {id, _} -> {id, {state, sent_at + timeout, nil}} end), %{}}
+      error -> {%{}, Map.new(targets, fn {id, _} -> {id, error} end)}
+    end
+  end
+
+  defp send_requests(_groups, targets, timeout) do
+    targets
+    |> Task.async_stream(
+      fn {id, state} ->
+        result = Cli.request_state(@cli_states[state], id)
+        {id, state, result, System.monotonic_time(:millisecond)}
+      end,
+      max_concurrency: max(map_size(targets), 1),
+      timeout: :infinity
+    )
+    |> Enum.reduce({%{}, %{}}, fn
+      {:ok, {id, state, :ok, sent_at}}, {pending, errors} ->
+        {Map.put(pending, id, {state, sent_at + timeout, nil}), errors}
+
+      {:ok, {id, _state, error, _sent_at}}, {pending, errors} ->
+        {pending, Map.put(errors, id, error)}
+    end)
+  end
+
+  defp await(pending, errors, _master) when map_size(pending) == 0 do
+    if errors == %{}, do: :ok, else: {:error, errors}
+  end
+
+  defp await(pending, errors, master) do
+    now = System.monotonic_time(:millisecond)
+    {expired, pending} = Map.split_with(pending, &(elem(elem(&1, 1), 1) <= now))
+
+    errors =
+      Enum.reduce(expired, errors, fn {id, {_, _, seen}}, acc ->
+        Map.put(acc, id, {:timeout, seen})
+      end)
+
+    wait =
+      pending
+      |> Enum.map(fn {_id, {_, deadline, _}} -> deadline - now end)
+      |> Enum.min(fn -> 0 end)
+      |> min(@poll_interval)
+
+    receive do
+      {:ethercat, :slave, id, %{al_state: state}} ->
+        await(observe(pending, id, state), errors, master)
+
+      {:ethercat, _kind, _event} ->
+        await(pending, errors, master)
+    after
+      wait -> await(poll(pending, master), errors, master)
+    end
+  end
+
+  defp observe(pending, id, state) do
+    case pending do
+      %{^id => {^state, _, _}} -> Map.delete(pending, id)
+      %{^id => {target, deadline, _}} -> Map.put(pending, id, {target, deadline, state})
+      _ -> pending
+    end
+  end
+
+  defp poll(pending, master) do
+    Enum.reduce(pending, pending, fn {id, _}, acc ->
+      case Nif.slave_info(master, id) do
+        {:ok, %{state: state}} -> observe(acc, id, state)
+        _ -> acc
+      end
+    end)
+  end
+end
@@ -0,0 +1,111 @@
+defmodule EthercatEx.Telemetry do
+  @moduledoc """
+  Publishes the timing statistics of the cyclic threads as `:telemetry` events.
+
+  The cyclic thread records every cycle into histograms in native memory, without allocating
+  or locking. This process drains them every `:interval` milliseconds and emits
+
+    * `[:ethercat_ex, :cycle, :stats]` with measurements
+      * `:cycles`, `:deadline_misses` (cycles that ended after the next deadline) and
+        `:wc_incomplete` (cycles in which a domain's working counter was not complete) since the
+        last event
+      * `:working_counter` of domain `0` in the latest cycle and `:dc_error`, master minus reference clock
+        time in ns (`0` without distributed clocks)
+      * `:latency_p50`, `:latency_p99`, `:latency_p999`, `:latency_max`: wake-up latency in ns
+        from the deadline to the moment the thread ran
+      * `:duration_p50`, `:duration_p99`, `:duration_p999`, `:duration_max`: time from
+        receive to send in ns
+
+      and metadata `%{master: index, latency: histogram, duration: histogram}`, the histograms
+      each a list of `{highest_value_ns, count}` buckets for custom percentiles.
+
+  One event is emitted per master active with a `:cycle_time`, each with the statistics of
+  that master's own thread only; nothing is emitted while there is none. Percentiles are
+  bucket upper bounds with about 3% precision. Values of 134 ms and more share a last,
+  overflow bucket whose bound is the largest of them, so `:latency_max` and
+  `:duration_max` stay exact for stalls.
+
+  Add it to a supervision tree after the master is set up:
+
+      children = [{EthercatEx.Telemetry, interval: 1000}]
+
+  Statistics are reset when read, so run one process per master with the `:master` option to
+  publish masters at different intervals:
+
+      children = [
+        {EthercatEx.Telemetry, master: 0, interval: 1000, name: :telemetry0},
+        {EthercatEx.Telemetry, master: 1, interval: 100, name: :telemetry1}
+      ]
+
+  ## Options
+    - `:interval` - Publishing interval in milliseconds (default: 1000).
+    - `:master` - Index of the only master to publish (default: all held masters).
+    - `:name` - Registered name (default: `EthercatEx.Telemetry`).
+  """
+
+  use GenServer
+
+  alias EthercatEx.Nif
+
+  @event [:ethercat_ex, :cycle, :stats]
+
+  def start_link(opts \\ []) do
+    GenServer.start_link(__MODULE__, opts, name: Keyword.get(opts, :name, __MODULE__))
+  end
+
+  @doc """
+  Returns the value below which `percentile` percent of the samples in `histogram` fall, or
+  `0` for an empty histogram.
+  """
+  def percentile([], _percentile), do: 0
+
+  def percentile(histogram, percentile) do
+    total = Enum.reduce(histogram, 0, fn {_value, count}, sum -> sum + count end)
+    rank = max(Float.ceil(total * percentile / 100), 1)
+
+    Enum.reduce_while(histogram, 0, fn {value, count}, seen ->
+      if seen + count >= rank, do: {:halt, value}, else: {:cont, seen + count}
+    end)
+  end
+
+  @impl GenServer
+  def init(opts) do
+    interval = Keyword.get(opts, :interval, 1000)
+    :timer.send_interval(interval, :publish)
+    {:ok, Keyword.get(opts, :master, :all)}
+  end
+
+  @impl GenServer
+  def handle_info(:publish, only) do
+    for {index, master} <- EthercatEx.masters(), only in [:all, index] do
+      with {:ok, stats} <- Nif.cycle_stats(master) do
+        metadata = stats |> Map.take([:latency, :duration]) |> Map.put(:master, index)
+        :telemetry.execute(@event, measurements(stats), metadata)
+      end
+    end
+
+    {:noreply, only}
+  end
+
+  defp measurements(stats) do
+    stats
+    |> Map.take([:cycles, :deadline_misses, :wc_incomplete, :working_counter, :dc_error])
+    |> Map.merge(summary(:latency, stats.latency))
+    |> Map.merge(summary(:duration, stats.duration))
+  end
+
+  defp summary(name, histogram) do
+    max =
+      case List.last(histogram) do
+        {value, _count} -> value
+        nil -> 0
+      end
+
+    %{
+      :"#{name}_p50" => percentile(histogram, 50),
+      :"#{name}_p99" => percentile(histogram, 99),
+      :"#{name}_p999" => percentile(histogram, 99.9),
+      :"#{name}_max" => max
+    }
+  end
+end
@@ -0,0 +1,96 @@
+defmodule Mix.Tasks.Ethercat.Gen.Pdo do
+  @shortdoc "Generates EthercatEx.Pdo modules for the devices on the bus"
+
+  @moduledoc """
+  Generates one `EthercatEx.Pdo` module per device type found in `ethercat cstruct` output.
+
+      mix ethercat.gen.pdo --namespace MyApp.Pdo
+
+  The cstruct output is stored at `priv/ethercat/cstruct.c` (the generated modules compile
+  their layouts from it) and each module is written to `lib/<namespace path>/<device>.ex`.
+  Existing module files are left untouched so that entry `:names` added by hand survive
+  regeneration.
+
+  ## Options
+
+    * `--namespace` - (Required) Module namespace of the generated modules.
+    * `--cstruct` - Read the cstruct output from this file instead of running
+      `EthercatEx.Cli.generate_cstruct/0` against the live bus.
+    * `--force` - Overwrite existing module files.
+  """
+
+  use Mix.Task
+
+  alias EthercatEx.Pdo.Cstruct
+
+  @cstruct_path "priv/ethercat/cstruct.c"
+
+  @impl Mix.Task
+  def run(args) do
+    {opts, _rest} =
+      OptionParser.parse!(args, strict: [namespace: :string, cstruct: :string, force: :boolean])
+
+    namespace = Keyword.get(opts, :namespace) || Mix.raise("--namespace is required")
+    source = read_cstruct(opts[:cstruct])
+
+    File.mkdir_p!(Path.dirname(@cstruct_path))
+    File.write!(@cstruct_path, source)
+    Mix.shell().info("* writing #{@cstruct_path}")
+
+    source
+    |> Cstruct.parse()
+    |> Enum.uniq_by(&{&1.vendor_id, &1.product_code, &1.revision})
+    |> Enum.each(&generate(&1, namespace, opts[:force]))
+  end
+
+  defp read_cstruct(nil) do
+    Mix.Task.run("app.start")
+
+    case EthercatEx.Cli.start_link() do
+      {:ok, _pid} -> :ok
+      {:error, {:already_started, _pid}} -> :ok
+    end
+
+    case EthercatEx.Cli.generate_cstruct() do
+      {:ok, source} -> source
+      {:error, {code, reason}} -> Mix.raise("ethercat cstruct failed (#{code}): #{reason}")
+    end
+  end
+
+  defp read_cstruct(path), do: File.read!(path)
+
+  defp generate(slave, namespace, force) do
+    device = module_part(slave.name)
+    module = Module.concat(namespace, device)
+    path = Path.join(["lib", Macro.underscore(namespace), Macro.underscore(device) <> ".ex"])
+
+    if File.exists?(path) and not force do
+      Mix.shell().info("* skipping #{path} (exists)")
+    else
+      File.mkdir_p!(Path.dirname(path))
+
+      File.write!(path, """
+      defmodule #{inspect(module)} do
+        @moduledoc \"\"\"
+        Process data of #{slave.name} (vendor #{hex(slave.vendor_id)}, product #{hex(slave.product_code)}).
+
+        Generated by `mix ethercat.gen.pdo`.
+        \"\"\"
+
+        use EthercatEx.Pdo, cstruct: #{inspect(@cstruct_path)}, position: #{slave.position}
+      end
+      """)
+
+      Mix.shell().info("* creating #{path}")
+    end
+  end
+
+  defp module_part(name) do
+    case name |> String.replace(~r/[^A-Za-z0-9]+/, "_") |> Macro.camelize() do
+      <<first, _::binary>> = part when first in ?A..?Z -> part
+      part -> "Slave" <> part
+    end
+  end
+
+  defp hex(value), do: "0x" <> String.pad_leading(Integer.to_string(value, 16), 8, "0")
+end
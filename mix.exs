@@ -8,7 +8,9 @@ defmodule EthercatEx.MixProject do
       elixir: "~> 1.17",
       start_permanent: Mix.env() == :prod,
       deps: deps(),
-      compilers: Mix.compilers()
+      compilers: [:elixir_make] ++ Mix.compilers(),
+      make_targets: ["all"],
+      make_clean: ["clean"]
     ]
   end
 
@@ -20,7 +22,11 @@ defmodule EthercatEx.MixProject do
 
   defp deps do
     [
-      {:muontrap, "~> 1.0"}
+      {:benchee, "~> 1.3", only: :dev},
+      {:benchee_json, "~> 1.0", only: :dev},
+      {:elixir_make, "~> 0.9", runtime: false},
+      {:muontrap, "~> 1.0"},
+      {:telemetry, "~> 1.0"}
     ]
   end
 end
@@ -0,0 +1,96 @@
+defmodule EthercatEx.Cli.CoprocessTest do
+  use ExUnit.Case, async: false
+
+  alias EthercatEx.Cli.Coprocess
+
+  @moduletag :tmp_dir
+
+  # A stand-in for ethercat_port: answers `slaves` with one line in the
+  # tool's format, one upload and one download of an SDO entry given
+  # exactly as the tool takes them, anything else with the unsupported
+  # status, and exits on `crash`. `hang` is answered after half a second.
+  @helper """
+  read_frame() { head -c 4 | od -An -tu1 | awk '{print $1*16777216+$2*65536+$3*256+$4}'; }
+  while len=$(read_frame) && [ -n "$len" ]; do
+    line=$(head -c "$len" | tr '\\0' ' ')
+    case "${line% }" in
+      slaves) out='0  0:0  PREOP  +  EK1100'; status='\\000' ;;
+      'upload -p 2 0x6000 0x11') out='0x0005 5'; status='\\000' ;;
+      'download -p 2 -t int16 0x7000 0x01 -3') out=''; status='\\000' ;;
+      crash) exit 3 ;;
+      hang) sleep 0.5; out=''; status='\\000' ;;
+      *) out=''; status='\\377' ;;
+    esac
+    n=$((${#out} + 1))
+    printf "$(printf '\\\\%03o\\\\%03o\\\\%03o\\\\%03o' $((n >> 24)) $((n >> 16 & 255)) $((n >> 8 & 255)) $((n & 255)))"
+    printf "$status%s" "$out"
+  done
+  """
+
+  setup %{tmp_dir: dir} do
+    path = Path.join(dir, "ethercat_port")
+    File.write!(path, "#!/bin/sh\n" <> @helper)
+    File.chmod!(path, 0o755)
+    {:ok, path: path}
+  end
+
+  describe "Coprocess.run/3" do
+    setup %{path: path} do
+      start_supervised!({Coprocess, master: "0", path: path, timeout: 200})
+      :ok
+    end
+
+    test "returns the helper's output and status" do
+      assert Coprocess.run("0", "slaves", []) == {"0  0:0  PREOP  +  EK1100", 0}
+    end
+
+    test "passes on commands the helper does not serve" do
+      assert Coprocess.run("0", "sii_read", ["-p", "0"]) == :unsupported
+    end
+
+    test "serves only its own master" do
+      assert Coprocess.run("1", "slaves", []) == :unsupported
+    end
+
+    test "answers in-flight requests with :unsupported when the helper exits" do
+      assert Coprocess.run("0", "crash", []) == :unsupported
+      # Not respawned right away.
+      assert Coprocess.run("0", "slaves", []) == :unsupported
+    end
+
+    test "passes on requests while the helper is busy, and ones it takes too long for" do
+      hang = Task.async(fn -> Coprocess.run("0", "hang", []) end)
+      Process.sleep(50)
+      assert Coprocess.run("0", "slaves", []) == :unsupported
+      assert Task.await(hang) == :unsupported
+
+      # Busy until the late answer arrives.
+      assert Coprocess.run("0", "slaves", []) == :unsupported
+      Process.sleep(400)
+      assert Coprocess.run("0", "slaves", []) == {"0  0:0  PREOP  +  EK1100", 0}
+    end
+  end
+
+  # With a tool that always fails, only answers from the helper succeed.
+  describe "SDO access through EthercatEx.Cli" do
+    setup %{path: path} do
+      tool = System.find_executable("false")
+      start_supervised!({EthercatEx.Cli, master: "0", coprocess: path, binary_path: tool})
+
+      :ok
+    end
+
+    test "read_sdo/3 passes index and hexadecimal subindex as the tool takes them" do
+      assert EthercatEx.Cli.read_sdo(2, "0x6000:11") == {:ok, "0x0005 5"}
+    end
+
+    test "write_sdo/4 passes the type given" do
+      assert EthercatEx.Cli.write_sdo(2, "0x7000:01", -3, type: "int16") == :ok
+    end
+
+    test "commands the helper does not serve go to the tool" do
+      assert {:error, {1, _output}} = EthercatEx.Cli.read_sdo(2, "0x6000:12")
+    end
+  end
+
+end
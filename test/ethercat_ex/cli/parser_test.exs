@@ -0,0 +1,96 @@
+defmodule EthercatEx.Cli.ParserTest do
+  use ExUnit.Case, async: true
+
+  alias EthercatEx.Cli.{Parser, Pdo, SdoEntry, Slave}
+
+  doctest EthercatEx.Cli.Parser
+
+  @slaves """
+  0  0:0  PREOP  +  EK1100 EtherCAT-Koppler (2A E-Bus)
+  1  0:1  OP     +  EL1004 4K. Dig. Eingang 24V, 3ms
+  2  5:0  SAFEOP E  EL3102 2K. Ana. Eingang +/-10V
+  """
+
+  @pdos """
+  SM0: PhysAddr 0x1000, DefaultSize    0, ControlRegister 0x26, Enable 1
+  SM2: PhysAddr 0x1100, DefaultSize    0, ControlRegister 0x24, Enable 1
+    RxPDO 0x1600 "Channel 1"
+      PDO entry 0x7000:01,  1 bit, "Output"
+      PDO entry 0x0000:00,  7 bit, ""
+  SM3: PhysAddr 0x1180, DefaultSize    6, ControlRegister 0x20, Enable 1
+    TxPDO 0x1a00 "TxPDO-Map Status"
+      PDO entry 0x6041:00, 16 bit, "Statusword"
+    TxPDO 0x1a01 "TxPDO-Map Position"
+      PDO entry 0x6064:00, 32 bit, "Position actual value"
+  """
+
+  @sdos """
+  SDO 0x1000, "Device type"
+    0x1000:00, r-r-r-, uint32, 32 bit, "Device type"
+  SDO 0x1018, "Identity"
+    0x1018:00, r-r-r-, uint8, 8 bit, "SubIndex 000"
+    0x1018:01, r-r-r-, uint32, 32 bit, "Vendor ID"
+  SDO 0x8010, "AI Settings"
+    0x8010:0a, rwrwrw, type 0x0800, 16 bit, "Filter "settings""
+  """
+
+  describe "slaves" do
+    test "parses position, address, state, error flag and name" do
+      assert [ek1100, el1004, el3102] = Parser.parse(:slaves, @slaves)
+
+      assert %Slave{position: 0, alias: 0, relative_position: 0, state: :pre_operational} = ek1100
+      assert ek1100.name == "EK1100 EtherCAT-Koppler (2A E-Bus)"
+      assert %Slave{position: 1, state: :operational, error: false} = el1004
+      assert %Slave{position: 2, alias: 5, state: :safe_operational, error: true} = el3102
+    end
+  end
+
+  describe "pdos" do
+    test "groups entries by PDO and keeps gaps" do
+      assert [rx, status, position] = Parser.parse(:pdos, @pdos)
+
+      assert %Pdo{sync_manager: 2, direction: :output, index: 0x1600, name: "Channel 1"} = rx
+      assert [%{index: 0x7000, subindex: 1, bit_length: 1}, %{index: 0, bit_length: 7, name: ""}] =
+               rx.entries
+
+      assert %Pdo{sync_manager: 3, direction: :input, index: 0x1A00} = status
+      assert [%{index: 0x6064, subindex: 0, bit_length: 32}] = position.entries
+    end
+  end
+
+  describe "sdos" do
+    test "carries the object name into each entry" do
+      assert [device, subindex0, vendor, filter] = Parser.parse(:sdos, @sdos)
+
+      assert %SdoEntry{index: 0x1000, subindex: 0, object_name: "Device type"} = device
+      assert %SdoEntry{index: 0x1018, subindex: 0, data_type: "uint8", bit_length: 8} = subindex0
+      assert %SdoEntry{subindex: 1, access: "r-r-r-", name: "Vendor ID"} = vendor
+
+      assert %SdoEntry{index: 0x8010, subindex: 0x0A, access: "rwrwrw", data_type: "type 0x0800"} =
+               filter
+
+      assert filter.name == ~s(Filter "settings")
+    end
+
+    test "streams chunks split at arbitrary points" do
+      chunks = for <<byte::binary-size(1) <- @sdos>>, do: byte
+
+      assert chunks |> Parser.stream(:sdos) |> Enum.to_list() == Parser.parse(:sdos, @sdos)
+    end
+
+    test "collects output as a Collectable" do
+      output = ["SDO 0x1000, \"Dev", "ice type\"\n  0x1000:00, r-r-r-, uint32, 32 bit, \"x\""]
+      parser = Enum.into(output, Parser.new(:sdos))
+
+      assert {[%SdoEntry{object_name: "Device type", name: "x"}], ""} = Parser.finish(parser)
+    end
+  end
+
+  test "keeps unrecognized lines as error text" do
+    assert {[], "Failed to open master device /dev/EtherCAT0: No such file or directory"} =
+             :slaves
+             |> Parser.new()
+             |> Parser.feed("Failed to open master device /dev/EtherCAT0: No such file or directory\n")
+             |> Parser.finish()
+  end
+end
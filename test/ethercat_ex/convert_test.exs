@@ -0,0 +1,38 @@
+defmodule EthercatEx.ConvertTest do
+  use ExUnit.Case, async: true
+
+  alias EthercatEx.Convert
+
+  # Offset entries need no master, only the NIF.
+  @moduletag :fake_bus
+
+  test "converts runs, scattered entries and bits in entry order" do
+    image =
+      <<-5::little-16, 7::little-16, 300::little-16, 0xAB, 0, 1.5::little-float-32,
+        -70_000::little-32, 0b100>>
+
+    {:ok, conv} =
+      Convert.prepare([
+        {0, :int16},
+        {2, :int16},
+        {4, :int16},
+        {12, :int32},
+        {8, :real32},
+        {16, 2, :bit},
+        {16, 1, :bit},
+        {6, :uint8}
+      ])
+
+    values = for <<value::native-float-64 <- Convert.to_f64(conv, image)>>, do: value
+    assert values == [-5.0, 7.0, 300.0, -70_000.0, 1.5, 1.0, 0.0, 171.0]
+  end
+
+  test "rejects an image that does not reach every entry" do
+    {:ok, conv} = Convert.prepare([{2, :uint32}])
+    assert Convert.to_f64(conv, <<0, 0, 0, 0, 0>>) == {:error, :size_mismatch}
+  end
+
+  test "offset entries are in the domain given by :domain" do
+    assert {:ok, %Convert{domain: 1, count: 1}} = Convert.prepare([{0, :uint8}], domain: 1)
+  end
+end
@@ -0,0 +1,31 @@
+defmodule EthercatEx.DeltaStreamTest do
+  use ExUnit.Case, async: true
+
+  alias EthercatEx.DeltaStream
+
+  describe "decode/1" do
+    test "rebuilds each frame from the runs of the previous one" do
+      batch =
+        IO.iodata_to_binary([
+          # version, 4 byte image, 3 frames, first cycle 300 as a two byte varint
+          <<1, 4, 3, 0xAC, 0x02>>,
+          # cycle 300: bytes 1 and 2 set
+          <<0, 1, 1, 2, 0xAA, 0xBB>>,
+          # cycle 301: unchanged
+          <<1, 0>>,
+          # cycle 303: byte 0 flipped, byte 3 set
+          <<2, 2, 0, 1, 0xFF, 2, 1, 0x01>>
+        ])
+
+      assert DeltaStream.decode(batch) == [
+               {300, <<0, 0xAA, 0xBB, 0>>},
+               {301, <<0, 0xAA, 0xBB, 0>>},
+               {303, <<0xFF, 0xAA, 0xBB, 0x01>>}
+             ]
+    end
+
+    test "decodes an empty image" do
+      assert DeltaStream.decode(<<1, 0, 2, 7, 0, 0, 1, 0>>) == [{7, <<>>}, {8, <<>>}]
+    end
+  end
+end
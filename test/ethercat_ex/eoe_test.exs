@@ -0,0 +1,40 @@
+defmodule EthercatEx.EoeTest do
+  use ExUnit.Case, async: true
+
+  alias EthercatEx.Eoe
+
+  defp interface(root, name, counters \\ %{}) do
+    stats = Path.join([root, name, "statistics"])
+    File.mkdir_p!(stats)
+    File.write!(Path.join([root, name, "tx_queue_len"]), "100\n")
+    File.write!(Path.join([root, name, "operstate"]), "up\n")
+
+    for counter <- ~w(rx_bytes tx_bytes rx_packets tx_packets rx_dropped tx_dropped rx_errors
+                      tx_errors) do
+      File.write!(Path.join(stats, counter), "#{Map.get(counters, counter, 0)}\n")
+    end
+  end
+
+  @tag :tmp_dir
+  test "stats/1 lists the EoE interfaces of one master", %{tmp_dir: root} do
+    interface(root, "eoe0s3", %{"tx_bytes" => 4096, "tx_dropped" => 2})
+    interface(root, "eoe0a1000")
+    interface(root, "eoe1s0")
+    interface(root, "eth0")
+
+    assert {:ok, [by_alias, by_position]} = Eoe.stats(sysfs: root)
+    assert %{interface: "eoe0a1000", slave: {:alias, 1000}, up: true, queue_len: 100} = by_alias
+    assert %{interface: "eoe0s3", slave: {:position, 3}, tx_bytes: 4096, tx_dropped: 2} =
+             by_position
+
+    assert {:ok, [%{interface: "eoe1s0"}]} = Eoe.stats(sysfs: root, master: 1)
+  end
+
+  test "throughput/2 computes rates between two samples" do
+    before = [%{interface: "eoe0s3", sampled_at: 0, rx_bytes: 0, tx_bytes: 1000, tx_dropped: 1}]
+    now = [%{interface: "eoe0s3", sampled_at: 500, rx_bytes: 250, tx_bytes: 3000, tx_dropped: 4}]
+
+    assert %{"eoe0s3" => %{rx_rate: 500.0, tx_rate: 4000.0, tx_dropped: 3}} =
+             Eoe.throughput(before, now)
+  end
+end
@@ -0,0 +1,65 @@
+defmodule EthercatEx.FoeTest do
+  use ExUnit.Case
+
+  alias EthercatEx.Nif
+
+  # The reservation of a slave's FoE buffer, driven through the NIFs against
+  # a configured but absent slave; no transfer needs to complete.
+  @moduletag :fake_bus
+
+  setup do
+    :ok = EthercatEx.init(interface: "sim")
+    on_exit(fn -> EthercatEx.shutdown() end)
+
+    :ok = EthercatEx.configure_slave(0, %{vendor_id: 0x2, product_code: 0x1, foe_size: 1024})
+    :ok = EthercatEx.activate(cycle_time: 1000, clock: :virtual)
+    {:ok, master} = EthercatEx.fetch_master()
+    {:ok, master: master}
+  end
+
+  defp in_other_process(fun), do: fun |> Task.async() |> Task.await()
+
+  test "a first chunk reserves the slave until it is released", %{master: master} do
+    assert Nif.foe_load(master, 0, 0, "abc") == :ok
+    assert Nif.foe_load(master, 0, 3, "def") == :ok
+    assert in_other_process(fn -> Nif.foe_load(master, 0, 0, "x") end) == {:error, :busy}
+
+    assert Nif.foe_release(master, 0) == :ok
+    assert in_other_process(fn -> Nif.foe_load(master, 0, 0, "x") end) == :ok
+  end
+
+  test "only the process holding the slave releases it", %{master: master} do
+    assert Nif.foe_load(master, 0, 0, "abc") == :ok
+    assert in_other_process(fn -> Nif.foe_release(master, 0) end) == {:error, :not_owner}
+    assert Nif.foe_load(master, 0, 3, "def") == :ok
+    assert Nif.foe_release(master, 0) == :ok
+  end
+
+  test "a file larger than the buffer does not reserve the slave", %{master: master} do
+    assert Nif.foe_load(master, 0, 0, :binary.copy(<<0>>, 1025)) == {:error, :too_large}
+    assert in_other_process(fn -> Nif.foe_load(master, 0, 0, "x") end) == :ok
+  end
+
+  test "a slave left reserved by a dead process is taken over", %{master: master} do
+    test = self()
+    {pid, monitor} = spawn_monitor(fn -> send(test, Nif.foe_load(master, 0, 0, "abc")) end)
+    assert_receive :ok
+    assert_receive {:DOWN, ^monitor, :process, ^pid, :normal}
+
+    assert Nif.foe_load(master, 0, 0, "x") == :ok
+  end
+
+  test "calls out of phase are rejected", %{master: master} do
+    assert Nif.foe_load(master, 0, 16, "abc") == {:error, :no_transfer}
+    assert Nif.foe_unload(master, 0, 0, 64) == {:error, :no_transfer}
+    assert Nif.foe_release(master, 0) == {:error, :no_transfer}
+    assert Nif.foe_load(master, 1, 0, "abc") == {:error, :not_configured}
+  end
+
+  test "the public API reports a busy slave", %{master: master} do
+    assert Nif.foe_load(master, 0, 0, "abc") == :ok
+    task = Task.async(fn -> EthercatEx.foe_write(0, "firmware.efw", "data") end)
+    assert Task.await(task) == {:error, :busy}
+    assert in_other_process(fn -> EthercatEx.foe_read(0, "log.txt") end) == {:error, :busy}
+  end
+end
@@ -0,0 +1,78 @@
+defmodule EthercatEx.PdoTest do
+  use ExUnit.Case, async: true
+
+  alias EthercatEx.Pdo.Cstruct
+
+  @cstruct "test/fixtures/cstruct.c"
+
+  defmodule DigitalIn do
+    use EthercatEx.Pdo,
+      cstruct: "test/fixtures/cstruct.c",
+      position: 1,
+      names: %{{0x6000, 0x01} => :in1, {0x6030, 0x01} => :in4}
+  end
+
+  defmodule AnalogIn do
+    use EthercatEx.Pdo,
+      cstruct: "test/fixtures/cstruct.c",
+      position: 2,
+      names: %{
+        {0x3101, 0x01} => :status,
+        {0x3101, 0x02} => :value,
+        {0x7000, 0x01} => :enable,
+        {0x7000, 0x02} => :mode
+      }
+  end
+
+  describe "Cstruct.parse/1" do
+    test "reads identity, sync managers and entry names" do
+      [digital, analog] = @cstruct |> File.read!() |> Cstruct.parse()
+
+      assert %{position: 1, name: "EL1004", vendor_id: 2, product_code: 0x03EC3052} = digital
+      assert [%{index: 0, direction: :input, watchdog: :disable, pdos: pdos}] =
+               digital.sync_managers
+
+      assert Enum.map(pdos, & &1.entries) == [
+               [{0x6000, 1, 1}],
+               [{0x6010, 1, 1}],
+               [{0x6020, 1, 1}],
+               [{0x6030, 1, 1}]
+             ]
+
+      assert [_, _, %{index: 2, direction: :output, pdos: [control]}, %{index: 3}] =
+               analog.sync_managers
+
+      assert control.entries == [{0x7000, 1, 1}, {0x0000, 0, 3}, {0x7000, 2, 4}]
+      assert analog.entry_names[{0x3101, 0x02}] == "Value"
+    end
+  end
+
+  describe "generated modules" do
+    test "decode packed bit inputs LSB first" do
+      assert DigitalIn.input_size() == 1
+      assert DigitalIn.output_size() == 0
+
+      assert DigitalIn.decode_inputs(<<0b1001>>) == %{
+               :in1 => 1,
+               {0x6010, 1} => 0,
+               {0x6020, 1} => 0,
+               :in4 => 1
+             }
+    end
+
+    test "decode byte-aligned little-endian inputs" do
+      assert AnalogIn.input_size() == 3
+      assert AnalogIn.decode_inputs(<<0x41, 0x34, 0x12>>) == %{status: 0x41, value: 0x1234}
+    end
+
+    test "encode outputs around gaps" do
+      assert AnalogIn.output_size() == 1
+      assert AnalogIn.encode_outputs(%{enable: 1, mode: 0b1010}) == <<0b1010_0001>>
+    end
+
+    test "config/0 is accepted by configure_slave/2" do
+      assert %{vendor_id: 2, product_code: 0x0C1E3052, sync_managers: [_, _, _, _]} =
+               AnalogIn.config()
+    end
+  end
+end
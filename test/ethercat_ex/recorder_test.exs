@@ -0,0 +1,61 @@
+defmodule EthercatEx.RecorderTest do
+  use ExUnit.Case, async: true
+
+  alias EthercatEx.Recorder
+
+  # A ring of `capacity` records of two domains, 2 and 1 bytes, after `head`
+  # cycles; cycle n carries the bytes n, n + 1 and n + 2.
+  defp recording(capacity, head, frozen \\ 0) do
+    record_size = 24
+    table = <<0::native-64, 2::native-64, 2::native-64, 1::native-64>>
+
+    header =
+      <<"ECATREC1", 1::native-32, record_size::native-32, 3::native-64, capacity::native-64,
+        head::native-64, frozen::native-32, 2::native-32, table::binary>>
+
+    slots =
+      for slot <- 0..(capacity - 1), into: %{} do
+        {slot, :binary.copy(<<0>>, record_size)}
+      end
+
+    slots =
+      Enum.reduce(0..(head - 1)//1, slots, fn cycle, slots ->
+        record =
+          <<cycle::native-64, 1_000 + cycle::native-signed-64, cycle, cycle + 1, cycle + 2,
+            0::40>>
+
+        Map.put(slots, rem(cycle, capacity), record)
+      end)
+
+    padding = :binary.copy(<<0>>, 4096 - byte_size(header))
+    IO.iodata_to_binary([header, padding | Enum.map(0..(capacity - 1), &slots[&1])])
+  end
+
+  describe "decode/1" do
+    test "returns the records of a wrapped ring oldest first" do
+      {:ok, %{frozen: true, records: records}} = Recorder.decode(recording(3, 5, 1))
+
+      assert Enum.map(records, & &1.cycle) == [2, 3, 4]
+      assert hd(records) == %{cycle: 2, time: 1_002, domains: [<<2, 3>>, <<4>>]}
+    end
+
+    test "returns only the records written so far" do
+      {:ok, %{frozen: false, records: records}} = Recorder.decode(recording(4, 2))
+
+      assert Enum.map(records, & &1.cycle) == [0, 1]
+    end
+
+    test "returns no records for a fresh file" do
+      assert Recorder.decode(recording(4, 0)) == {:ok, %{frozen: false, records: []}}
+    end
+
+    test "rejects truncated and foreign files" do
+      data = recording(4, 2)
+
+      assert Recorder.decode(binary_part(data, 0, byte_size(data) - 1)) ==
+               {:error, :invalid_recording}
+
+      assert Recorder.decode("not a recording") == {:error, :invalid_recording}
+    end
+  end
+end
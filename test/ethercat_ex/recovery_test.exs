@@ -0,0 +1,47 @@
+defmodule EthercatEx.RecoveryTest do
+  use ExUnit.Case
+
+  alias EthercatEx.Recovery
+
+  # Slave reports are sent to the process directly; slave 0 is configured
+  # but absent, and the grace period is long enough that no reset starts.
+  @moduletag :fake_bus
+
+  setup do
+    :ok = EthercatEx.init(interface: "sim")
+    on_exit(fn -> EthercatEx.shutdown() end)
+
+    :ok = EthercatEx.configure_slaves([{0, %{vendor_id: 0x2, product_code: 0x1}}])
+    :ok = EthercatEx.activate(cycle_time: 1000, clock: :virtual)
+
+    test = self()
+    handler = "recovery-test-#{inspect(test)}"
+    lost = [:ethercat_ex, :slave, :lost]
+    :ok = :telemetry.attach(handler, lost, fn _, _, meta, _ -> send(test, {:lost, meta}) end, nil)
+    on_exit(fn -> :telemetry.detach(handler) end)
+
+    recovery = start_supervised!({Recovery, grace: 60_000})
+    {:ok, recovery: recovery}
+  end
+
+  test "a slave still coming up is not lost", %{recovery: recovery} do
+    send(recovery, report(false, false))
+    send(recovery, report(true, false))
+
+    assert Recovery.recovering() == %{}
+    refute_received {:lost, _}
+  end
+
+  test "a slave leaving OP is lost", %{recovery: recovery} do
+    send(recovery, report(true, true))
+    send(recovery, report(false, false))
+
+    assert Recovery.recovering() == %{0 => 0}
+    assert_received {:lost, %{master: 0, slave: 0}}
+  end
+
+  defp report(online, operational) do
+    state = if operational, do: :operational, else: :init
+    {:ethercat, :slave, 0, %{online: online, operational: operational, al_state: state}}
+  end
+end
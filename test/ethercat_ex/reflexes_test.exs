@@ -0,0 +1,68 @@
+defmodule EthercatEx.ReflexesTest do
+  use ExUnit.Case
+
+  # One absent slave with a byte of inputs and a byte of outputs. Its
+  # inputs read as zero on the simulated bus, so a rule on `== 0` is
+  # active from the first cycle.
+  @moduletag :fake_bus
+
+  @slave %{
+    vendor_id: 0x2,
+    product_code: 0x1,
+    sync_managers: [
+      %{index: 2, direction: :output, pdos: [%{index: 0x1600, entries: [{0x7000, 0x01, 8}]}]},
+      %{index: 3, direction: :input, pdos: [%{index: 0x1A00, entries: [{0x6000, 0x01, 8}]}]}
+    ]
+  }
+
+  @force %{when: {0, {0x6000, 0x01}, :==, 0}, set: {0, {0x7000, 0x01}, 0x5A}}
+
+  setup do
+    :ok = EthercatEx.init(interface: "sim")
+    on_exit(fn -> EthercatEx.shutdown() end)
+
+    :ok = EthercatEx.configure_slave(0, @slave)
+    :ok = EthercatEx.activate(cycle_time: 1000, clock: :virtual)
+    :ok = EthercatEx.write_pdo(0, %{outputs: <<0x11>>})
+    :ok
+  end
+
+  defp sent_outputs, do: EthercatEx.read_pdo(0).outputs
+
+  defp eventually(expected, attempts \\ 100) do
+    cond do
+      sent_outputs() == expected -> :ok
+      attempts == 0 -> flunk("outputs stayed #{inspect(sent_outputs())}")
+      true ->
+        Process.sleep(5)
+        eventually(expected, attempts - 1)
+    end
+  end
+
+  test "a matching rule forces the outputs and reports it" do
+    :ok = EthercatEx.attach_monitor(self())
+    assert :ok = EthercatEx.set_reflexes([@force])
+
+    eventually(<<0x5A>>)
+    assert_receive {:ethercat, :reflex, 0}
+  end
+
+  test "forced outputs hold after the rule goes until they are written again" do
+    :ok = EthercatEx.set_reflexes([@force])
+    eventually(<<0x5A>>)
+
+    :ok = EthercatEx.set_reflexes([])
+    Process.sleep(50)
+    assert sent_outputs() == <<0x5A>>
+
+    :ok = EthercatEx.write_pdo(0, %{outputs: <<0x22>>})
+    eventually(<<0x22>>)
+  end
+
+  test "a rule that does not match leaves the outputs alone" do
+    :ok = EthercatEx.set_reflexes([%{@force | when: {0, {0x6000, 0x01}, :!=, 0}}])
+    Process.sleep(50)
+
+    assert sent_outputs() == <<0x11>>
+  end
+end
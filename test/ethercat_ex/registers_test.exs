@@ -0,0 +1,60 @@
+defmodule EthercatEx.RegistersTest do
+  use ExUnit.Case
+
+  alias EthercatEx.Nif
+
+  # Register batches over three configured but absent slaves, the last one
+  # without register request. The requests of absent slaves are never
+  # served, so a batch only ends at its deadline or on shutdown.
+  @moduletag :fake_bus
+
+  setup do
+    :ok = EthercatEx.init(interface: "sim")
+    on_exit(fn -> EthercatEx.shutdown() end)
+
+    :ok =
+      EthercatEx.configure_slaves([
+        {0, %{vendor_id: 0x2, product_code: 0x1, reg_size: 8}},
+        {1, %{vendor_id: 0x2, product_code: 0x1}},
+        {2, %{vendor_id: 0x2, product_code: 0x1, reg_size: 0}}
+      ])
+
+    :ok = EthercatEx.activate(cycle_time: 1000, clock: :virtual)
+    {:ok, master} = EthercatEx.fetch_master()
+    {:ok, master: master}
+  end
+
+  test "a batch gives up on absent slaves and lists them as failed" do
+    assert EthercatEx.read_registers(0x0130, 2, timeout: 50) == {:ok, [{0, :error}, {1, :error}]}
+    assert EthercatEx.write_registers(0x0300, <<0>>, timeout: 50) ==
+             {:error, {:register_failed, [0, 1]}}
+  end
+
+  test "a batch in flight is answered on shutdown", %{master: master} do
+    ref = make_ref()
+    assert Nif.register_read(master, 0x0130, 2, 60_000, ref) == :ok
+    :ok = EthercatEx.shutdown()
+
+    assert_receive {:register_done, ^ref, {:error, :closed}}
+  end
+
+  test "one batch runs at a time", %{master: master} do
+    ref = make_ref()
+    assert Nif.register_read(master, 0x0130, 2, 60_000, ref) == :ok
+    assert Nif.register_read(master, 0x0130, 2, 60_000, make_ref()) == {:error, :busy}
+  end
+
+  test "the size is bounded by the smallest request taking part" do
+    assert EthercatEx.read_registers(0x0130, 9) == {:error, :too_large}
+    assert EthercatEx.write_registers(0x0300, <<0::72>>) == {:error, :too_large}
+  end
+
+  test "a master without register requests has nothing to batch" do
+    :ok = EthercatEx.shutdown()
+    :ok = EthercatEx.init(interface: "sim")
+    :ok = EthercatEx.configure_slave(0, %{vendor_id: 0x2, product_code: 0x1, reg_size: 0})
+    :ok = EthercatEx.activate(cycle_time: 1000, clock: :virtual)
+
+    assert EthercatEx.read_registers(0x0130, 2) == {:error, :not_configured}
+  end
+end
@@ -0,0 +1,19 @@
+defmodule EthercatEx.RtCheckTest do
+  use ExUnit.Case, async: true
+
+  alias EthercatEx.Nif
+
+  # The trap aborts the VM, so it is sprung in a VM of its own.
+  @moduletag :fake_bus
+  @moduletag :rt_checks
+
+  test "an allocation on a real-time thread aborts the VM with a message" do
+    ebin = :code.which(Nif) |> Path.dirname()
+    args = ["-noshell", "-pa", ebin, "-eval", "'Elixir.EthercatEx.Nif':rt_check_trap(), halt(0)."]
+
+    {output, status} = System.cmd(System.find_executable("erl"), args, stderr_to_stdout: true)
+
+    assert status != 0
+    assert output =~ "ethercat_ex: operator new on the cyclic thread"
+  end
+end
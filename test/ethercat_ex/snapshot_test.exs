@@ -0,0 +1,36 @@
+defmodule EthercatEx.SnapshotTest do
+  use ExUnit.Case, async: true
+
+  alias EthercatEx.Snapshot
+
+  @snapshot %Snapshot{
+    slaves: [
+      {1, %{vendor_id: 0x2, product_code: 0x0C1E3052, sdos: [{0x8010, 0x01, {1500, 2}}]}}
+    ],
+    identities: %{1 => %{vendor_id: 0x2, product_code: 0x0C1E3052, revision: 0x00100000}},
+    layouts: %{1 => %{domain: 0, inputs: {0, 2}, outputs: {2, 2}, entries: []}}
+  }
+
+  @tag :tmp_dir
+  test "save/2 and load/1 round-trip a snapshot", %{tmp_dir: dir} do
+    path = Path.join(dir, "bus.snapshot")
+
+    assert :ok = Snapshot.save(path, @snapshot)
+    assert {:ok, @snapshot} = Snapshot.load(path)
+    refute File.exists?(path <> ".tmp")
+  end
+
+  test "decode/1 rejects corrupted and foreign binaries" do
+    <<head::binary-size(20), byte, rest::binary>> = Snapshot.encode(@snapshot)
+
+    assert {:error, :invalid} =
+             Snapshot.decode(<<head::binary, Bitwise.bxor(byte, 1), rest::binary>>)
+
+    assert {:error, :invalid} = Snapshot.decode("not a snapshot")
+    assert {:error, :invalid} = Snapshot.decode("ECATSNP1" <> <<0::32>>)
+  end
+
+  test "encode/1 is deterministic" do
+    assert Snapshot.encode(@snapshot) == Snapshot.encode(@snapshot)
+  end
+end
@@ -0,0 +1,58 @@
+defmodule EthercatEx.StatesTest do
+  use ExUnit.Case
+
+  alias EthercatEx.States
+
+  # Slaves 1 to 4 are absent from the simulated bus, so every transition
+  # times out. The `ethercat` tool is a script that logs its arguments,
+  # takes 200 ms per state request and fails the one for slave 4.
+  @moduletag :fake_bus
+  @moduletag :tmp_dir
+
+  setup %{tmp_dir: dir} do
+    log = Path.join(dir, "calls")
+    tool = Path.join(dir, "ethercat")
+
+    File.write!(tool, """
+    #!/bin/sh
+    case "$*" in
+      *states*) echo "${*##*states }" >> #{log} ;;
+    esac
+    case "$*" in
+      *"-p 4 OP") echo "No slave 4."; exit 1 ;;
+      *states*) sleep 0.2 ;;
+    esac
+    """)
+
+    File.chmod!(tool, 0o755)
+    start_supervised!({EthercatEx.Cli, master: "0", coprocess: false, binary_path: tool})
+
+    :ok = EthercatEx.init(interface: "sim")
+    on_exit(fn -> EthercatEx.shutdown() end)
+    :ok = EthercatEx.activate(cycle_time: 1000, clock: :virtual)
+    {:ok, log: log}
+  end
+
+  test "requests run in parallel and each slave gets its own timeout" do
+    started = System.monotonic_time(:millisecond)
+
+    assert {:error, errors} = States.request([1, 2, 3, 4], :operational, timeout: 300)
+    elapsed = System.monotonic_time(:millisecond) - started
+
+    assert %{1 => {:timeout, _}, 2 => {:timeout, _}, 3 => {:timeout, _}} = errors
+    assert errors[4] == {:error, {1, "No slave 4."}}
+    # 200 ms for the requests, side by side, then 300 ms of waiting. One
+    # after the other, the requests alone would take 600 ms.
+    assert elapsed >= 500 and elapsed < 800
+  end
+
+  test "a slave listed in several groups gets the state of the last one", %{log: log} do
+    groups = [{[1, 2], :operational}, {[2], :pre_operational}]
+
+    assert {:error, %{1 => {:timeout, _}, 2 => {:timeout, _}}} =
+             States.request_groups(groups, timeout: 100)
+
+    assert log |> File.read!() |> String.split("\n", trim: true) |> Enum.sort() ==
+             ["-p 1 OP", "-p 2 PREOP"]
+  end
+end
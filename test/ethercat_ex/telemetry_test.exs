@@ -0,0 +1,20 @@
+defmodule EthercatEx.TelemetryTest do
+  use ExUnit.Case, async: true
+
+  alias EthercatEx.Telemetry
+
+  describe "percentile/2" do
+    test "returns the upper bound of the bucket holding the rank" do
+      histogram = [{10, 900}, {20, 90}, {40, 9}, {1000, 1}]
+
+      assert Telemetry.percentile(histogram, 50) == 10
+      assert Telemetry.percentile(histogram, 99) == 20
+      assert Telemetry.percentile(histogram, 99.9) == 40
+      assert Telemetry.percentile(histogram, 100) == 1000
+    end
+
+    test "is zero for an empty histogram" do
+      assert Telemetry.percentile([], 99.9) == 0
+    end
+  end
+end
@@ -1,3 +1,84 @@
 defmodule EthercatExTest do
   use ExUnit.Case
+
+  alias EthercatEx.Nif
+
+  @moduletag :fake_bus
+
+  setup do
+    :ok = EthercatEx.init(interface: "sim")
+    on_exit(fn -> EthercatEx.shutdown() end)
+  end
+
+  test "runs cycles back to back on the virtual clock" do
+    :ok = EthercatEx.activate(cycle_time: 1000, clock: :virtual)
+    {:ok, master} = EthercatEx.fetch_master()
+
+    samples =
+      for _ <- 1..5 do
+        Process.sleep(20)
+        {:ok, stats} = Nif.cycle_stats(master)
+        stats
+      end
+
+    totals = samples |> Enum.map(& &1.cycles) |> Enum.scan(&+/2)
+
+    # Virtual time starts at zero and advances by exactly one period per
+    # cycle, so each deadline is the number of cycles run by then times
+    # 1 ms. A sample counts every cycle up to its deadline, and at most the
+    # one cycle past the next sample's deadline that was counted but not yet
+    # stamped.
+    for {%{time: time}, total} <- Enum.zip(samples, totals) do
+      assert rem(time, 1_000_000) == 0
+      assert div(time, 1_000_000) <= total
+    end
+
+    for {total, %{time: next}} <- Enum.zip(totals, tl(samples)) do
+      assert total <= div(next, 1_000_000) + 1
+    end
+
+    # 100 ms of wall time is 100 cycles at 1 kHz on the monotonic clock.
+    assert List.last(totals) > 1_000
+
+    for %{latency: latency} <- samples do
+      assert latency |> Enum.map(&elem(&1, 0)) |> Enum.max(fn -> 0 end) == 0
+    end
+  end
+
+  test "cycles on demand without a thread" do
+    :ok = EthercatEx.activate(cycle_time: nil)
+
+    for _ <- 1..10, do: assert(EthercatEx.cycle() == :ok)
+    assert %{link_up: _, slaves: []} = EthercatEx.status()
+  end
+
+  test "process data read without a thread outlives the master" do
+    :ok = EthercatEx.activate(cycle_time: nil)
+    :ok = EthercatEx.cycle()
+
+    {:ok, master} = EthercatEx.fetch_master()
+    {:ok, image} = Nif.domain_image(master, 0)
+    :ok = EthercatEx.shutdown()
+
+    assert :binary.referenced_byte_size(image) == byte_size(image)
+    assert :ok = EthercatEx.init(interface: "sim")
+  end
+
+  test "concurrent init/1 of one master holds it once" do
+    :ok = EthercatEx.shutdown()
+
+    results =
+      1..8
+      |> Enum.map(fn _ -> Task.async(fn -> EthercatEx.init(interface: "sim") end) end)
+      |> Enum.map(&Task.await/1)
+
+    assert Enum.sort(results) == [:ok | List.duplicate({:error, :already_initialized}, 7)]
+    assert [{0, _master}] = EthercatEx.masters()
+  end
+
+  test "rejects a second activation" do
+    :ok = EthercatEx.activate(cycle_time: 1000, clock: :virtual)
+
+    assert EthercatEx.activate(cycle_time: 1000, clock: :virtual) == {:error, :already_active}
+  end
 end
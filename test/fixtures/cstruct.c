@@ -0,0 +1,51 @@
+/* Master 0, Slave 1, "EL1004"
+ * Vendor ID:       0x00000002
+ * Product code:    0x03ec3052
+ * Revision number: 0x00100000
+ */
+
+ec_pdo_entry_info_t slave_1_pdo_entries[] = {
+    {0x6000, 0x01, 1}, /* Input */
+    {0x6010, 0x01, 1}, /* Input */
+    {0x6020, 0x01, 1}, /* Input */
+    {0x6030, 0x01, 1}, /* Input */
+};
+
+ec_pdo_info_t slave_1_pdos[] = {
+    {0x1a00, 1, slave_1_pdo_entries + 0}, /* Channel 1 */
+    {0x1a01, 1, slave_1_pdo_entries + 1}, /* Channel 2 */
+    {0x1a02, 1, slave_1_pdo_entries + 2}, /* Channel 3 */
+    {0x1a03, 1, slave_1_pdo_entries + 3}, /* Channel 4 */
+};
+
+ec_sync_info_t slave_1_syncs[] = {
+    {0, EC_DIR_INPUT, 4, slave_1_pdos + 0, EC_WD_DISABLE},
+    {0xff}
+};
+
+/* Master 0, Slave 2, "EL3102"
+ * Vendor ID:       0x00000002
+ * Product code:    0x0c1e3052
+ * Revision number: 0x00130000
+ */
+
+ec_pdo_entry_info_t slave_2_pdo_entries[] = {
+    {0x3101, 0x01, 8}, /* Status */
+    {0x3101, 0x02, 16}, /* Value */
+    {0x7000, 0x01, 1}, /* Enable */
+    {0x0000, 0x00, 3}, /* Gap */
+    {0x7000, 0x02, 4}, /* Mode */
+};
+
+ec_pdo_info_t slave_2_pdos[] = {
+    {0x1600, 3, slave_2_pdo_entries + 2}, /* Control */
+    {0x1a00, 2, slave_2_pdo_entries + 0}, /* AI Inputs Ch.1 */
+};
+
+ec_sync_info_t slave_2_syncs[] = {
+    {0, EC_DIR_OUTPUT, 0, NULL, EC_WD_DISABLE},
+    {1, EC_DIR_INPUT, 0, NULL, EC_WD_DISABLE},
+    {2, EC_DIR_OUTPUT, 1, slave_2_pdos + 0, EC_WD_ENABLE},
+    {3, EC_DIR_INPUT, 1, slave_2_pdos + 1, EC_WD_DISABLE},
+    {0xff}
+};
@@ -1 +1,7 @@
-ExUnit.start()
+# Tests tagged :fake_bus drive the NIF and only run against the simulated
+# backend, i.e. when built with ETHERCAT_BACKEND=fake. Tests tagged
+# :rt_checks also need a NIF built with ETHERCAT_RT_CHECKS=1.
+builds = [fake_bus: {"ETHERCAT_BACKEND", "fake"}, rt_checks: {"ETHERCAT_RT_CHECKS", "1"}]
+exclude = for {tag, {variable, value}} <- builds, System.get_env(variable) != value, do: tag
+
+ExUnit.start(exclude: exclude)